@@ -0,0 +1,12 @@
+@echo off
+setlocal
+
+rem Build solution
+for /f "usebackq tokens=3" %%i in (`reg query HKLM\Software\Microsoft\MSBuild\ToolsVersions\4.0 /v MSBuildToolsPath`) do set MSBUILDPATH=%%i
+%MSBUILDPATH%\msbuild meshopt.sln /nologo /verbosity:quiet /p:configuration=Release /p:platform=Win32 || exit %ERRORLEVEL%
+
+rem Copy results
+copy /y Release\meshopt.dll meshopt.dll
+
+rem Delete artefacts
+rmdir /s /q Release
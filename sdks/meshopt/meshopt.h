@@ -0,0 +1,40 @@
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Mesh optimization for the build pipeline. All functions work on triangle lists with 32-bit indices; destination
+// buffers must not overlap the source buffers.
+
+// Reorder triangles for the post-transform vertex cache with the linear-speed algorithm by Tom Forsyth
+// (http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html); the score table models an LRU cache of
+// cache_size entries (3..32). clusters receives the first triangle of each cluster of the output, where clusters are
+// separated by the dead ends at which no cached vertex had triangles left; it has to hold index_count / 3 entries and
+// can be NULL. Returns the number of clusters.
+int meshoptOptimizeVertexCache(int* destination, const int* indices, int index_count, int vertex_count, int cache_size, int* clusters);
+
+// Reorder triangles for a FIFO post-transform vertex cache of cache_size entries with the Tipsify algorithm by Sander,
+// Nehab and Barczak (same as PostTLOptimizerTipsify); usually gets lower ACMR than meshoptOptimizeVertexCache for
+// FIFO caches. clusters are the same as in meshoptOptimizeVertexCache. Returns the number of clusters.
+int meshoptOptimizeVertexCacheFifo(int* destination, const int* indices, int index_count, int vertex_count, int cache_size, int* clusters);
+
+// Reorder clusters of a vertex cache optimized index buffer so that clusters that face away from the mesh center are
+// drawn first and occlude the rest; clusters come from meshoptOptimizeVertexCacheFifo or meshoptOptimizeVertexCache.
+// Clusters are split further at the points where the ACMR of a FIFO cache of cache_size entries is within threshold
+// (i.e. 0.05 for 5%) of the ACMR of the whole buffer, so the cache efficiency loss is bounded; threshold 0 keeps the
+// input clusters. positions are 3 floats at position_stride bytes per vertex.
+void meshoptOptimizeOverdraw(int* destination, const int* indices, int index_count, const float* positions, int position_stride, int vertex_count,
+    const int* clusters, int cluster_count, int cache_size, float threshold);
+
+// Reorder vertices in the order of first use for the pre-transform (vertex fetch) cache and remap indices in place;
+// vertices that are not referenced are dropped. destination has to hold vertex_count vertices. Returns the number of
+// vertices written.
+int meshoptOptimizeVertexFetch(void* destination, int* indices, int index_count, const void* vertices, int vertex_count, int vertex_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
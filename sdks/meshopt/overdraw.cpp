@@ -0,0 +1,209 @@
+#include "meshopt.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    // Tag-based FIFO cache, same model as PostTLAnalyzer.analyzeFIFO
+    struct VertexCache
+    {
+        std::vector<unsigned int> tags;
+        unsigned int tag;
+        unsigned int size;
+
+        VertexCache(int vertexCount, int cacheSize): tags(vertexCount, 0), tag(cacheSize + 1), size(cacheSize)
+        {
+        }
+
+        // Make sure that no vertices are in cache
+        void invalidate()
+        {
+            tag += size + 1;
+        }
+
+        // Update cache with vertex; returns true on a miss
+        bool update(int vertex)
+        {
+            if (tag - tags[vertex] <= size)
+                return false;
+
+            tags[vertex] = tag++;
+            return true;
+        }
+    };
+
+    struct Vector3
+    {
+        float x, y, z;
+    };
+
+    // Sort key of a cluster: clusters with higher keys occlude more and are drawn first
+    struct ClusterOrder
+    {
+        const std::vector<float>* keys;
+
+        bool operator()(int lhs, int rhs) const
+        {
+            return (*keys)[lhs] > (*keys)[rhs];
+        }
+    };
+
+    int countMisses(const int* indices, int begin, int end, VertexCache& cache)
+    {
+        int misses = 0;
+
+        for (int i = begin * 3; i < end * 3; ++i)
+            misses += cache.update(indices[i]);
+
+        return misses;
+    }
+
+    // Split clusters at the points where the ACMR of the sub-cluster from a cold cache falls within the threshold of
+    // the ACMR of the whole buffer; these points cost little extra cache misses when clusters are reordered
+    void generateSoftBoundaries(std::vector<int>& result, const int* indices, int indexCount, int vertexCount, const int* clusters, int clusterCount,
+        int cacheSize, float threshold)
+    {
+        int triangleCount = indexCount / 3;
+
+        VertexCache cache(vertexCount, cacheSize);
+
+        float target = float(countMisses(indices, 0, triangleCount, cache)) / float(triangleCount) * (1 + threshold);
+
+        for (int i = 0; i < clusterCount; ++i)
+        {
+            int end = i + 1 < clusterCount ? clusters[i + 1] : triangleCount;
+
+            for (int start = clusters[i]; start < end; )
+            {
+                cache.invalidate();
+
+                int triangle = start;
+                int misses = 0;
+
+                do
+                {
+                    misses += countMisses(indices, triangle, triangle + 1, cache);
+                    ++triangle;
+                }
+                while (triangle < end && float(misses) / float(triangle - start) > target);
+
+                result.push_back(start);
+                start = triangle;
+            }
+        }
+    }
+}
+
+void meshoptOptimizeOverdraw(int* destination, const int* indices, int index_count, const float* positions, int position_stride, int vertex_count,
+    const int* clusters, int cluster_count, int cache_size, float threshold)
+{
+    assert(index_count % 3 == 0);
+    assert(cluster_count > 0 || index_count == 0);
+
+    int triangleCount = index_count / 3;
+
+    if (triangleCount == 0)
+        return;
+
+    std::vector<int> boundaries;
+
+    if (threshold > 0)
+        generateSoftBoundaries(boundaries, indices, index_count, vertex_count, clusters, cluster_count, cache_size, threshold);
+    else
+        boundaries.assign(clusters, clusters + cluster_count);
+
+    int count = int(boundaries.size());
+
+    // Area weighted centroid and normal of each cluster; triangle normals are not normalized, so their length is
+    // twice the area
+    std::vector<Vector3> centroids(count), normals(count);
+    std::vector<float> areas(count);
+
+    const char* vertices = reinterpret_cast<const char*>(positions);
+
+    for (int i = 0; i < count; ++i)
+    {
+        int end = i + 1 < count ? boundaries[i + 1] : triangleCount;
+        assert(boundaries[i] < end);
+
+        Vector3 centroid = {0, 0, 0}, normal = {0, 0, 0}, center = {0, 0, 0};
+        float area = 0;
+
+        for (int triangle = boundaries[i]; triangle < end; ++triangle)
+        {
+            const float* a = reinterpret_cast<const float*>(vertices + size_t(indices[triangle * 3 + 0]) * position_stride);
+            const float* b = reinterpret_cast<const float*>(vertices + size_t(indices[triangle * 3 + 1]) * position_stride);
+            const float* c = reinterpret_cast<const float*>(vertices + size_t(indices[triangle * 3 + 2]) * position_stride);
+
+            float e0[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+
+            Vector3 n = {e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0]};
+            float w = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+
+            Vector3 t = {(a[0] + b[0] + c[0]) / 3, (a[1] + b[1] + c[1]) / 3, (a[2] + b[2] + c[2]) / 3};
+
+            centroid.x += t.x * w, centroid.y += t.y * w, centroid.z += t.z * w;
+            center.x += t.x, center.y += t.y, center.z += t.z;
+            normal.x += n.x, normal.y += n.y, normal.z += n.z;
+            area += w;
+        }
+
+        // Degenerate clusters use the plain average of triangle centers
+        if (area > 0)
+            centroid.x /= area, centroid.y /= area, centroid.z /= area;
+        else
+            centroid.x = center.x / (end - boundaries[i]), centroid.y = center.y / (end - boundaries[i]), centroid.z = center.z / (end - boundaries[i]);
+
+        float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+
+        if (length > 0)
+            normal.x /= length, normal.y /= length, normal.z /= length;
+
+        centroids[i] = centroid;
+        normals[i] = normal;
+        areas[i] = area;
+    }
+
+    Vector3 meshCentroid = {0, 0, 0};
+    float meshArea = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        meshCentroid.x += centroids[i].x * areas[i], meshCentroid.y += centroids[i].y * areas[i], meshCentroid.z += centroids[i].z * areas[i];
+        meshArea += areas[i];
+    }
+
+    if (meshArea > 0)
+        meshCentroid.x /= meshArea, meshCentroid.y /= meshArea, meshCentroid.z /= meshArea;
+
+    // Occlusion potential is the distance of the cluster from the mesh center along the cluster normal
+    std::vector<float> keys(count);
+
+    for (int i = 0; i < count; ++i)
+        keys[i] = (centroids[i].x - meshCentroid.x) * normals[i].x + (centroids[i].y - meshCentroid.y) * normals[i].y + (centroids[i].z - meshCentroid.z) * normals[i].z;
+
+    std::vector<int> order(count);
+
+    for (int i = 0; i < count; ++i)
+        order[i] = i;
+
+    ClusterOrder compare = {&keys};
+    std::stable_sort(order.begin(), order.end(), compare);
+
+    int* output = destination;
+
+    for (int i = 0; i < count; ++i)
+    {
+        int cluster = order[i];
+        int begin = boundaries[cluster], end = cluster + 1 < count ? boundaries[cluster + 1] : triangleCount;
+
+        output = std::copy(indices + begin * 3, indices + end * 3, output);
+    }
+
+    assert(output == destination + index_count);
+}
@@ -0,0 +1,371 @@
+#include "meshopt.h"
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    const int kMaxCacheSize = 32;
+    const int kMaxValence = 64;
+
+    // Vertex scores by LRU cache position and by live triangle count; same constants as PostTLOptimizerLinear
+    struct VertexScoreTable
+    {
+        float cache[kMaxCacheSize];
+        float live[kMaxValence + 1];
+
+        explicit VertexScoreTable(int cacheSize)
+        {
+            const float kCacheDecayPower = 1.5f;
+            const float kLastTriangleScore = 0.75f;
+            const float kValenceBoostScale = 2.f;
+            const float kValenceBoostPower = 0.5f;
+
+            for (int i = 0; i < cacheSize; ++i)
+                cache[i] = i < 3 ? kLastTriangleScore : powf(1.f - float(i - 3) / float(cacheSize - 3), kCacheDecayPower);
+
+            live[0] = 0;
+
+            for (int i = 1; i <= kMaxValence; ++i)
+                live[i] = kValenceBoostScale * powf(float(i), -kValenceBoostPower);
+        }
+
+        // Vertices without live triangles don't affect any triangle scores
+        float get(int cachePosition, int liveTriangles) const
+        {
+            if (liveTriangles == 0)
+                return 0;
+
+            return (cachePosition < 0 ? 0 : cache[cachePosition]) + live[std::min(liveTriangles, kMaxValence)];
+        }
+    };
+
+    // Live triangles of each vertex; lists are packed into one array and shrink as triangles are emitted
+    struct Adjacency
+    {
+        std::vector<int> counts;
+        std::vector<int> offsets;
+        std::vector<int> triangles;
+
+        Adjacency(const int* indices, int indexCount, int vertexCount): counts(vertexCount), offsets(vertexCount), triangles(indexCount)
+        {
+            for (int i = 0; i < indexCount; ++i)
+            {
+                assert(indices[i] >= 0 && indices[i] < vertexCount);
+                counts[indices[i]]++;
+            }
+
+            for (int i = 0, offset = 0; i < vertexCount; ++i)
+            {
+                offsets[i] = offset;
+                offset += counts[i];
+            }
+
+            std::fill(counts.begin(), counts.end(), 0);
+
+            for (int i = 0; i < indexCount; ++i)
+            {
+                int vertex = indices[i];
+                triangles[offsets[vertex] + counts[vertex]++] = i / 3;
+            }
+        }
+
+        void remove(int vertex, int triangle)
+        {
+            int* list = &triangles[offsets[vertex]];
+            int& count = counts[vertex];
+
+            for (int i = 0; i < count; ++i)
+                if (list[i] == triangle)
+                {
+                    list[i] = list[--count];
+                    return;
+                }
+
+            assert(!"triangle is not in the vertex list");
+        }
+    };
+}
+
+int meshoptOptimizeVertexCache(int* destination, const int* indices, int index_count, int vertex_count, int cache_size, int* clusters)
+{
+    assert(index_count % 3 == 0);
+    assert(cache_size >= 3 && cache_size <= kMaxCacheSize);
+
+    int triangleCount = index_count / 3;
+
+    if (triangleCount == 0)
+        return 0;
+
+    VertexScoreTable table(cache_size);
+    Adjacency adjacency(indices, index_count, vertex_count);
+
+    std::vector<float> vertexScores(vertex_count);
+
+    for (int i = 0; i < vertex_count; ++i)
+        vertexScores[i] = table.get(-1, adjacency.counts[i]);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+
+    for (int i = 0; i < triangleCount; ++i)
+        triangleScores[i] = vertexScores[indices[i * 3 + 0]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+
+    // Cache holds the most recently used vertices first; the new cache has room for the 3 vertices that get pushed
+    // out by the triangle, so that their scores are updated as well
+    int cache[kMaxCacheSize + 3];
+    int cacheNew[kMaxCacheSize + 3];
+    int cacheCount = 0;
+
+    // Vertices of the emitted triangles, used to restart close to the last triangles at dead ends
+    std::vector<int> deadEnd;
+    deadEnd.reserve(index_count);
+
+    int current = int(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    int inputCursor = 0;
+    int clusterCount = 1;
+
+    if (clusters)
+        clusters[0] = 0;
+
+    for (int output = 0; output < triangleCount; ++output)
+    {
+        assert(current >= 0 && !emitted[current]);
+
+        int a = indices[current * 3 + 0], b = indices[current * 3 + 1], c = indices[current * 3 + 2];
+
+        destination[output * 3 + 0] = a;
+        destination[output * 3 + 1] = b;
+        destination[output * 3 + 2] = c;
+
+        emitted[current] = 1;
+
+        adjacency.remove(a, current);
+        adjacency.remove(b, current);
+        adjacency.remove(c, current);
+
+        deadEnd.push_back(a);
+        deadEnd.push_back(b);
+        deadEnd.push_back(c);
+
+        // Move triangle vertices to the front of the cache
+        int cacheNewCount = 0;
+
+        cacheNew[cacheNewCount++] = a;
+        cacheNew[cacheNewCount++] = b;
+        cacheNew[cacheNewCount++] = c;
+
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            int vertex = cache[i];
+
+            if (vertex != a && vertex != b && vertex != c)
+                cacheNew[cacheNewCount++] = vertex;
+        }
+
+        // Update vertex and triangle scores first, then pick the best triangle among the ones that use cached
+        // vertices, so that partially updated scores don't affect the choice
+        for (int i = 0; i < cacheNewCount; ++i)
+        {
+            int vertex = cacheNew[i];
+
+            float score = table.get(i < cache_size ? i : -1, adjacency.counts[vertex]);
+            float delta = score - vertexScores[vertex];
+
+            vertexScores[vertex] = score;
+
+            const int* list = &adjacency.triangles[adjacency.offsets[vertex]];
+
+            for (int j = 0; j < adjacency.counts[vertex]; ++j)
+                triangleScores[list[j]] += delta;
+        }
+
+        int best = -1;
+        float bestScore = 0;
+
+        for (int i = 0; i < cacheNewCount; ++i)
+        {
+            int vertex = cacheNew[i];
+            const int* list = &adjacency.triangles[adjacency.offsets[vertex]];
+
+            for (int j = 0; j < adjacency.counts[vertex]; ++j)
+                if (best < 0 || triangleScores[list[j]] > bestScore)
+                {
+                    best = list[j];
+                    bestScore = triangleScores[list[j]];
+                }
+        }
+
+        cacheCount = std::min(cacheNewCount, cache_size);
+        std::copy(cacheNew, cacheNew + cacheCount, cache);
+
+        // Dead end: restart from the best triangle of the most recently emitted vertex that has triangles left, or
+        // from the first triangle that is left in input order; searching all triangles for the best score would make
+        // the algorithm quadratic
+        if (best < 0 && output + 1 < triangleCount)
+        {
+            while (!deadEnd.empty() && adjacency.counts[deadEnd.back()] == 0)
+                deadEnd.pop_back();
+
+            if (!deadEnd.empty())
+            {
+                int vertex = deadEnd.back();
+                const int* list = &adjacency.triangles[adjacency.offsets[vertex]];
+
+                best = list[0];
+
+                for (int j = 1; j < adjacency.counts[vertex]; ++j)
+                    if (triangleScores[list[j]] > triangleScores[best])
+                        best = list[j];
+            }
+            else
+            {
+                while (emitted[inputCursor])
+                    ++inputCursor;
+
+                best = inputCursor;
+            }
+
+            if (clusters)
+                clusters[clusterCount] = output + 1;
+
+            clusterCount++;
+        }
+
+        current = best;
+    }
+
+    return clusterCount;
+}
+
+int meshoptOptimizeVertexCacheFifo(int* destination, const int* indices, int index_count, int vertex_count, int cache_size, int* clusters)
+{
+    assert(index_count % 3 == 0);
+    assert(cache_size >= 3);
+
+    int triangleCount = index_count / 3;
+
+    if (triangleCount == 0)
+        return 0;
+
+    // Adjacency lists stay complete; emitted triangles are skipped with flags
+    Adjacency adjacency(indices, index_count, vertex_count);
+
+    std::vector<int> liveTriangles(adjacency.counts);
+    std::vector<char> emitted(triangleCount, 0);
+
+    // Tag-based FIFO cache; tag difference is <= cache_size iff the vertex is in cache
+    std::vector<unsigned int> cacheTags(vertex_count, 0);
+    unsigned int tag = cache_size + 1;
+
+    std::vector<int> deadEnd;
+    deadEnd.reserve(index_count);
+
+    std::vector<int> candidates;
+
+    int output = 0;
+    int inputCursor = 0;
+    int clusterCount = 1;
+
+    if (clusters)
+        clusters[0] = 0;
+
+    // Start from the first vertex with triangles, so that the first cluster is not empty
+    while (liveTriangles[inputCursor] == 0)
+        ++inputCursor;
+
+    for (int current = inputCursor; current >= 0; )
+    {
+        candidates.clear();
+
+        // Emit all triangles around the vertex
+        const int* list = &adjacency.triangles[adjacency.offsets[current]];
+
+        for (int i = 0; i < adjacency.counts[current]; ++i)
+        {
+            int triangle = list[i];
+
+            if (emitted[triangle])
+                continue;
+
+            emitted[triangle] = 1;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                int vertex = indices[triangle * 3 + k];
+
+                destination[output * 3 + k] = vertex;
+
+                if (tag - cacheTags[vertex] > unsigned(cache_size))
+                    cacheTags[vertex] = tag++;
+
+                // Vertices with live triangles are the candidates for the next fan
+                if (--liveTriangles[vertex] > 0)
+                {
+                    deadEnd.push_back(vertex);
+                    candidates.push_back(vertex);
+                }
+            }
+
+            output++;
+        }
+
+        // Pick the candidate that stays in cache after its fan is emitted and is the oldest in cache
+        int best = -1, bestPriority = -1;
+
+        for (size_t i = 0; i < candidates.size(); ++i)
+        {
+            int vertex = candidates[i];
+
+            if (liveTriangles[vertex] == 0)
+                continue;
+
+            int position = int(tag - cacheTags[vertex]);
+            int priority = 2 * liveTriangles[vertex] + position <= cache_size ? position : 0;
+
+            if (priority > bestPriority)
+            {
+                best = vertex;
+                bestPriority = priority;
+            }
+        }
+
+        // Dead end: restart from the most recently emitted vertex with live triangles, or from the first such vertex in
+        // input order; this is a hard cluster boundary
+        if (best < 0)
+        {
+            while (!deadEnd.empty() && liveTriangles[deadEnd.back()] == 0)
+                deadEnd.pop_back();
+
+            if (!deadEnd.empty())
+            {
+                best = deadEnd.back();
+                deadEnd.pop_back();
+            }
+            else
+            {
+                while (inputCursor < vertex_count && liveTriangles[inputCursor] == 0)
+                    ++inputCursor;
+
+                best = inputCursor < vertex_count ? inputCursor : -1;
+            }
+
+            if (best >= 0)
+            {
+                if (clusters)
+                    clusters[clusterCount] = output;
+
+                clusterCount++;
+            }
+        }
+
+        current = best;
+    }
+
+    assert(output == triangleCount);
+
+    return clusterCount;
+}
@@ -0,0 +1,34 @@
+#include "meshopt.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include <vector>
+
+int meshoptOptimizeVertexFetch(void* destination, int* indices, int index_count, const void* vertices, int vertex_count, int vertex_size)
+{
+    assert(destination != vertices);
+
+    std::vector<int> remap(vertex_count, -1);
+    int next = 0;
+
+    char* output = static_cast<char*>(destination);
+    const char* input = static_cast<const char*>(vertices);
+
+    // Vertices are copied in the order of first use, so the index buffer walks the vertex buffer front to back
+    for (int i = 0; i < index_count; ++i)
+    {
+        int vertex = indices[i];
+        assert(vertex >= 0 && vertex < vertex_count);
+
+        if (remap[vertex] < 0)
+        {
+            memcpy(output + size_t(next) * vertex_size, input + size_t(vertex) * vertex_size, vertex_size);
+            remap[vertex] = next++;
+        }
+
+        indices[i] = remap[vertex];
+    }
+
+    return next;
+}
@@ -36,7 +36,12 @@
 
 #include <nvtt/nvtt_wrapper.h>
 
+#include "fastcompress.h"
+#include "surfacecompress.h"
+#include "taskpool.h"
+
 typedef void (__stdcall *NvttErrorCallback)(const char* message);
+typedef NvttBoolean (__stdcall *NvttOutputCallback)(const void* data, int size);
 
 __declspec(thread) NvttErrorCallback g_errorCallback;
 
@@ -68,22 +73,240 @@ struct MyMessageHandler: public nv::MessageHandler
 	}
 } g_messageHandler;
 
-extern "C" {
+// Sets the error callback for the current thread for the duration of the call; the previous callback is restored.
+struct ErrorCallbackScope
+{
+    ErrorCallbackScope(NvttErrorCallback errorCallback): previous(g_errorCallback)
+    {
+        g_errorCallback = errorCallback;
+    }
 
-NVTT_API NvttBoolean nvttCompressFile(const char* source, const char* target, const NvttInputOptions * inputOptionsP, const NvttCompressionOptions * compressionOptions, NvttErrorCallback errorCallback)
+    ~ErrorCallbackScope()
+    {
+        g_errorCallback = previous;
+    }
+
+    NvttErrorCallback previous;
+};
+
+// Forwards compressed data to the user callback; the callback gets the DDS stream in order, header first.
+struct CallbackOutputHandler: public nvtt::OutputHandler
 {
-    struct ErrorCallbackScope
+    CallbackOutputHandler(NvttOutputCallback callback): callback(callback)
     {
-        ErrorCallbackScope(NvttErrorCallback errorCallback)
-        {
-            g_errorCallback = errorCallback;
-        }
+    }
+
+    virtual void beginImage(int size, int width, int height, int depth, int face, int miplevel)
+    {
+    }
+
+    virtual bool writeData(const void * data, int size)
+    {
+        return callback(data, size) != NVTT_False;
+    }
+
+    virtual void endImage()
+    {
+    }
+
+    NvttOutputCallback callback;
+};
+
+// Writes compressed data to a file.
+struct FileOutputHandler: public nvtt::OutputHandler
+{
+    FileOutputHandler(const char * name): stream(name)
+    {
+    }
+
+    virtual void beginImage(int size, int width, int height, int depth, int face, int miplevel)
+    {
+    }
+
+    virtual bool writeData(const void * data, int size)
+    {
+        stream.serialize(const_cast<void *>(data), size);
+
+        return !stream.isError();
+    }
+
+    virtual void endImage()
+    {
+    }
+
+    nv::StdOutputStream stream;
+};
+
+// Read-only view of a file mapped into memory.
+struct MappedFile
+{
+    MappedFile(const char * name): file(INVALID_HANDLE_VALUE), mapping(NULL), data(NULL), size(0)
+    {
+        file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) return;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || fileSize.HighPart != 0) return;
+
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) return;
 
-        ~ErrorCallbackScope()
+        data = static_cast<const uint8 *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data) size = fileSize.LowPart;
+    }
+
+    ~MappedFile()
+    {
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    }
+
+    HANDLE file;
+    HANDLE mapping;
+    const uint8 * data;
+    uint size;
+};
+
+// Get surface data from DDS data if it contains uncompressed 32-bit BGRA surfaces, which have the same layout as
+// nv::Image pixels; returns NULL for other formats.
+static const uint8 * getBGRASurfaceData(const uint8 * data, uint size, uint width, uint height, uint faceCount, uint mipmapCount)
+{
+    const uint DDPF_ALPHAPIXELS = 0x1;
+    const uint DDPF_FOURCC = 0x4;
+    const uint DDPF_RGB = 0x40;
+
+    if (!data || size < 128)
+        return NULL;
+
+    const uint * header = reinterpret_cast<const uint *>(data);
+    uint flags = header[20];
+
+    if ((flags & DDPF_FOURCC) || !(flags & DDPF_RGB) || !(flags & DDPF_ALPHAPIXELS) || header[22] != 32 ||
+        header[23] != 0xFF0000 || header[24] != 0xFF00 || header[25] != 0xFF || header[26] != 0xFF000000)
+        return NULL;
+
+    // Make sure that all surfaces are there
+    uint64 dataSize = 0;
+
+    for (uint m = 0; m < mipmapCount; m++)
+    {
+        uint w = width >> m, h = height >> m;
+
+        dataSize += uint64(w ? w : 1) * (h ? h : 1) * 4 * faceCount;
+    }
+
+    return 128 + dataSize <= size ? data + 128 : NULL;
+}
+
+// Set input options from a DDS surface; if DDS data is available in memory, uncompressed surfaces are passed to nvtt
+// directly, otherwise mipmaps are decoded one at a time.
+static bool setupInput(nv::DirectDrawSurface & dds, const char * name, NvttInputOptions & inputOptions, const uint8 * data = NULL, uint size = 0)
+{
+    if (!dds.isValid())
+    {
+        nvDebug("The file '%s' is not a valid DDS file.\n", name);
+        return false;
+    }
+
+    if (!dds.isSupported() || dds.isTexture3D())
+    {
+        nvDebug("The file '%s' is not a supported DDS file.\n", name);
+        return false;
+    }
+
+    uint faceCount;
+    if (dds.isTexture2D())
+    {
+        inputOptions.setTextureLayout(nvtt::TextureType_2D, dds.width(), dds.height());
+        faceCount = 1;
+    }
+    else 
+    {
+        nvDebugCheck(dds.isTextureCube());
+        inputOptions.setTextureLayout(nvtt::TextureType_Cube, dds.width(), dds.height());
+        faceCount = 6;
+    }
+
+    uint mipmapCount = dds.mipmapCount();
+
+    const uint8 * pixels = getBGRASurfaceData(data, size, dds.width(), dds.height(), faceCount, mipmapCount);
+
+    nv::Image mipmap;
+
+    for (uint f = 0; f < faceCount; f++)
+    {
+        for (uint m = 0; m < mipmapCount; m++)
         {
-            g_errorCallback = NULL;
+            if (pixels)
+            {
+                uint w = dds.width() >> m, h = dds.height() >> m;
+                if (w == 0) w = 1;
+                if (h == 0) h = 1;
+
+                inputOptions.setMipmapData(pixels, w, h, 1, f, m);
+                pixels += w * h * 4;
+            }
+            else
+            {
+                dds.mipmap(&mipmap, f, m); // @@ Load as float.
+
+                inputOptions.setMipmapData(mipmap.pixels(), mipmap.width(), mipmap.height(), 1, f, m);
+            }
         }
-    } errorCallbackScope(errorCallback);
+    }
+
+    return true;
+}
+
+// Set input options from a regular image.
+static bool setupInput(nv::Image * image, const char * name, NvttInputOptions & inputOptions)
+{
+    if (!image)
+    {
+        nvDebug("The file '%s' is not a supported image type.\n", name);
+        return false;
+    }
+
+    inputOptions.setTextureLayout(nvtt::TextureType_2D, image->width(), image->height());
+    inputOptions.setMipmapData(image->pixels(), image->width(), image->height());
+
+    return true;
+}
+
+// Compress the texture described by input options; blocks are compressed on the shared worker pool. If fast is set, the
+// fast block encoder is used for the quality levels and formats that it supports.
+static NvttBoolean compress(const NvttInputOptions & inputOptions, const NvttCompressionOptions & compressionOptions, bool fast, nvtt::OutputHandler & outputHandler)
+{
+    nvtt::Context context;
+    context.enableCudaAcceleration(false);
+    context.setTaskDispatcher(&TaskPool::instance());
+
+    nvtt::OutputOptions outputOptions;
+
+    // nvtt produces RGBA surfaces that the fast encoder encodes in parallel across all faces and mipmaps
+    if (fast && SurfaceCompressOutputHandler::isSupported(compressionOptions))
+    {
+        nvtt::CompressionOptions rgbaOptions;
+        SurfaceCompressOutputHandler::setupInputOptions(compressionOptions, rgbaOptions);
+
+        SurfaceCompressOutputHandler surfaceOutputHandler(compressionOptions, outputHandler);
+        outputOptions.setOutputHandler(&surfaceOutputHandler);
+
+        return (context.process(inputOptions, rgbaOptions, outputOptions) && surfaceOutputHandler.finish()) ? NVTT_True : NVTT_False;
+    }
+
+    outputOptions.setOutputHandler(&outputHandler);
+
+    return context.process(inputOptions, compressionOptions, outputOptions) ? NVTT_True : NVTT_False;
+}
+
+extern "C" {
+
+// Compress the file with the choice of the block encoder; fast selects the fast encoder for Fastest and Normal quality.
+NVTT_API NvttBoolean nvttCompressFileEx(const char* source, const char* target, const NvttInputOptions * inputOptionsP, const NvttCompressionOptions * compressionOptions, NvttBoolean fast, NvttErrorCallback errorCallback)
+{
+    ErrorCallbackScope errorCallbackScope(errorCallback);
 
     nv::Path input = source;
 
@@ -99,69 +322,99 @@ NVTT_API NvttBoolean nvttCompressFile(const char* source, const char* target, co
 
     if (nv::strCaseCmp(input.extension(), ".dds") == 0)
     {
-        // Load surface.
-        nv::DirectDrawSurface dds(input.str());
-        
-        if (!dds.isValid())
-        {
-            nvDebug("The file '%s' is not a valid DDS file.\n", input.str());
-            return NVTT_False;
-        }
+        // Map the file instead of reading it, so that surface data does not have to be copied around.
+        MappedFile file(input.str());
 
-        if (!dds.isSupported() || dds.isTexture3D())
+        if (!file.data)
         {
-            nvDebug("The file '%s' is not a supported DDS file.\n", input.str());
+            nvDebug("The file '%s' can not be read.\n", input.str());
             return NVTT_False;
         }
 
-        uint faceCount;
-        if (dds.isTexture2D())
-        {
-            inputOptions.setTextureLayout(nvtt::TextureType_2D, dds.width(), dds.height());
-            faceCount = 1;
-        }
-        else 
-        {
-            nvDebugCheck(dds.isTextureCube());
-            inputOptions.setTextureLayout(nvtt::TextureType_Cube, dds.width(), dds.height());
-            faceCount = 6;
-        }
-
-        uint mipmapCount = dds.mipmapCount();
-
-        nv::Image mipmap;
-
-        for (uint f = 0; f < faceCount; f++)
-        {
-            for (uint m = 0; m < mipmapCount; m++)
-            {
-                dds.mipmap(&mipmap, f, m); // @@ Load as float.
+        // Load surface; surface takes ownership of the stream.
+        nv::DirectDrawSurface dds(new nv::MemoryInputStream(file.data, file.size));
 
-                inputOptions.setMipmapData(mipmap.pixels(), mipmap.width(), mipmap.height(), 1, f, m);
-            }
-        }
+        if (!setupInput(dds, input.str(), inputOptions, file.data, file.size))
+            return NVTT_False;
     }
     else
 	{
         // Regular image.
         nv::Image image;
-        if (!image.load(input.str()))
-        {
-            nvDebug("The file '%s' is not a supported image type.\n", input.str());
+
+        if (!setupInput(image.load(input.str()) ? &image : NULL, input.str(), inputOptions))
             return NVTT_False;
-        }
+    }
+
+    FileOutputHandler outputHandler(target);
+
+    return compress(inputOptions, *compressionOptions, fast != NVTT_False, outputHandler);
+}
+
+NVTT_API NvttBoolean nvttCompressFile(const char* source, const char* target, const NvttInputOptions * inputOptionsP, const NvttCompressionOptions * compressionOptions, NvttErrorCallback errorCallback)
+{
+    return nvttCompressFileEx(source, target, inputOptionsP, compressionOptions, NVTT_False, errorCallback);
+}
+
+// Compress an encoded image (any format nvimage can read, including DDS) from memory; type is the file extension
+// that identifies the format, i.e. ".png". Resulting DDS data is passed to the output callback.
+NVTT_API NvttBoolean nvttCompressBuffer(const void* data, unsigned int size, const char* type, const NvttInputOptions * inputOptionsP, const NvttCompressionOptions * compressionOptions, NvttBoolean fast, NvttOutputCallback outputCallback, NvttErrorCallback errorCallback)
+{
+    ErrorCallbackScope errorCallbackScope(errorCallback);
+
+    // Set input options.
+    NvttInputOptions& inputOptions = *const_cast<NvttInputOptions*>(inputOptionsP);
+
+    if (nv::strCaseCmp(type, ".dds") == 0)
+    {
+        // Load surface; surface takes ownership of the stream.
+        nv::DirectDrawSurface dds(new nv::MemoryInputStream(static_cast<const uint8*>(data), size));
+
+        if (!setupInput(dds, type, inputOptions, static_cast<const uint8*>(data), size))
+            return NVTT_False;
+    }
+    else
+    {
+        // Regular image; the extension is used to select the decoder.
+        nv::MemoryInputStream stream(static_cast<const uint8*>(data), size);
+        nv::AutoPtr<nv::Image> image(nv::ImageIO::load(type, stream));
 
-        inputOptions.setTextureLayout(nvtt::TextureType_2D, image.width(), image.height());
-        inputOptions.setMipmapData(image.pixels(), image.width(), image.height());
+        if (!setupInput(image.ptr(), type, inputOptions))
+            return NVTT_False;
     }
 
-    nvtt::Context context;
-    context.enableCudaAcceleration(false);
+    CallbackOutputHandler outputHandler(outputCallback);
 
-    nvtt::OutputOptions outputOptions;
-    outputOptions.setFileName(target);
+    return compress(inputOptions, *compressionOptions, fast != NVTT_False, outputHandler);
+}
+
+// Compress raw 32-bit pixels from memory; pixels are in BGRA order (same as nv::Image), rows are tightly packed.
+// Resulting DDS data is passed to the output callback.
+NVTT_API NvttBoolean nvttCompressImage(const void* pixels, int width, int height, const NvttInputOptions * inputOptionsP, const NvttCompressionOptions * compressionOptions, NvttBoolean fast, NvttOutputCallback outputCallback, NvttErrorCallback errorCallback)
+{
+    ErrorCallbackScope errorCallbackScope(errorCallback);
+
+    // Set input options.
+    NvttInputOptions& inputOptions = *const_cast<NvttInputOptions*>(inputOptionsP);
+
+    inputOptions.setTextureLayout(nvtt::TextureType_2D, width, height);
+    inputOptions.setMipmapData(pixels, width, height);
+
+    CallbackOutputHandler outputHandler(outputCallback);
+
+    return compress(inputOptions, *compressionOptions, fast != NVTT_False, outputHandler);
+}
+
+// Encode raw 32-bit BGRA pixels with the fast block encoder directly, using either SIMD or scalar code path.
+// Output receives compressed blocks without DDS header; returns false if format or quality is not supported.
+NVTT_API NvttBoolean nvttFastCompressBlocks(const void* pixels, int width, int height, int format, int quality, void* output, NvttBoolean simd)
+{
+    if (!fastCompressIsSupported(static_cast<nvtt::Format>(format), static_cast<nvtt::Quality>(quality)) || (simd && !fastCompressHasSIMD()))
+        return NVTT_False;
+
+    fastCompressImage(static_cast<nvtt::Format>(format), static_cast<nvtt::Quality>(quality), static_cast<const unsigned char *>(pixels), width, height, static_cast<unsigned char *>(output), simd != NVTT_False);
 
-    return context.process(inputOptions, *compressionOptions, outputOptions) ? NVTT_True : NVTT_False;
+    return NVTT_True;
 }
 
 }
@@ -0,0 +1,811 @@
+#include "fastcompress.h"
+
+#include <nvcore/Debug.h>
+
+#include <emmintrin.h>
+#include <intrin.h>
+
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+    // Scalar implementation of a 4-wide float vector; operation order matches the SSE2 version exactly, so both
+    // produce bit-identical blocks.
+    struct Float4Scalar
+    {
+        float v[4];
+
+        Float4Scalar()
+        {
+        }
+
+        explicit Float4Scalar(float s)
+        {
+            v[0] = v[1] = v[2] = v[3] = s;
+        }
+
+        void store(float * p) const
+        {
+            for (int i = 0; i < 4; ++i) p[i] = v[i];
+        }
+
+        // Load 4 BGRA pixels into planar vectors
+        static void loadPixels(const unsigned char * p, Float4Scalar & b, Float4Scalar & g, Float4Scalar & r, Float4Scalar & a)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                b.v[i] = p[i * 4 + 0];
+                g.v[i] = p[i * 4 + 1];
+                r.v[i] = p[i * 4 + 2];
+                a.v[i] = p[i * 4 + 3];
+            }
+        }
+
+        friend Float4Scalar operator+(const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] + b.v[i];
+            return r;
+        }
+
+        friend Float4Scalar operator-(const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] - b.v[i];
+            return r;
+        }
+
+        friend Float4Scalar operator*(const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i];
+            return r;
+        }
+
+        // Same semantics as minps/maxps: the second operand is returned unless the first one is strictly smaller/larger
+        friend Float4Scalar vmin(const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+            return r;
+        }
+
+        friend Float4Scalar vmax(const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+            return r;
+        }
+
+        // Masks are represented with 1/0 values
+        friend Float4Scalar less(const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = a.v[i] < b.v[i] ? 1.f : 0.f;
+            return r;
+        }
+
+        friend Float4Scalar select(const Float4Scalar & mask, const Float4Scalar & a, const Float4Scalar & b)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = mask.v[i] != 0 ? a.v[i] : b.v[i];
+            return r;
+        }
+
+        friend Float4Scalar truncate(const Float4Scalar & a)
+        {
+            Float4Scalar r;
+            for (int i = 0; i < 4; ++i) r.v[i] = static_cast<float>(static_cast<int>(a.v[i]));
+            return r;
+        }
+
+        friend float hsum(const Float4Scalar & a)
+        {
+            return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]);
+        }
+
+        friend float hmin(const Float4Scalar & a)
+        {
+            float x = a.v[0] < a.v[2] ? a.v[0] : a.v[2];
+            float y = a.v[1] < a.v[3] ? a.v[1] : a.v[3];
+            return x < y ? x : y;
+        }
+
+        friend float hmax(const Float4Scalar & a)
+        {
+            float x = a.v[0] > a.v[2] ? a.v[0] : a.v[2];
+            float y = a.v[1] > a.v[3] ? a.v[1] : a.v[3];
+            return x > y ? x : y;
+        }
+    };
+
+    // SSE2 implementation of a 4-wide float vector.
+    struct Float4SSE2
+    {
+        __m128 v;
+
+        Float4SSE2()
+        {
+        }
+
+        explicit Float4SSE2(float s): v(_mm_set1_ps(s))
+        {
+        }
+
+        Float4SSE2(__m128 v): v(v)
+        {
+        }
+
+        void store(float * p) const
+        {
+            _mm_storeu_ps(p, v);
+        }
+
+        static void loadPixels(const unsigned char * p, Float4SSE2 & b, Float4SSE2 & g, Float4SSE2 & r, Float4SSE2 & a)
+        {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            __m128i mask = _mm_set1_epi32(0xff);
+
+            b = _mm_cvtepi32_ps(_mm_and_si128(data, mask));
+            g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(data, 8), mask));
+            r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(data, 16), mask));
+            a = _mm_cvtepi32_ps(_mm_srli_epi32(data, 24));
+        }
+
+        friend Float4SSE2 operator+(const Float4SSE2 & a, const Float4SSE2 & b) { return _mm_add_ps(a.v, b.v); }
+        friend Float4SSE2 operator-(const Float4SSE2 & a, const Float4SSE2 & b) { return _mm_sub_ps(a.v, b.v); }
+        friend Float4SSE2 operator*(const Float4SSE2 & a, const Float4SSE2 & b) { return _mm_mul_ps(a.v, b.v); }
+
+        friend Float4SSE2 vmin(const Float4SSE2 & a, const Float4SSE2 & b) { return _mm_min_ps(a.v, b.v); }
+        friend Float4SSE2 vmax(const Float4SSE2 & a, const Float4SSE2 & b) { return _mm_max_ps(a.v, b.v); }
+
+        friend Float4SSE2 less(const Float4SSE2 & a, const Float4SSE2 & b) { return _mm_cmplt_ps(a.v, b.v); }
+
+        friend Float4SSE2 select(const Float4SSE2 & mask, const Float4SSE2 & a, const Float4SSE2 & b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+        }
+
+        friend Float4SSE2 truncate(const Float4SSE2 & a)
+        {
+            return _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        }
+
+        friend float hsum(const Float4SSE2 & a)
+        {
+            __m128 t = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+            return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+        }
+
+        friend float hmin(const Float4SSE2 & a)
+        {
+            __m128 t = _mm_min_ps(a.v, _mm_movehl_ps(a.v, a.v));
+            return _mm_cvtss_f32(_mm_min_ss(t, _mm_shuffle_ps(t, t, 1)));
+        }
+
+        friend float hmax(const Float4SSE2 & a)
+        {
+            __m128 t = _mm_max_ps(a.v, _mm_movehl_ps(a.v, a.v));
+            return _mm_cvtss_f32(_mm_max_ss(t, _mm_shuffle_ps(t, t, 1)));
+        }
+    };
+
+    // Block pixels in planar layout, a row per vector; values are in [0..255]
+    template <typename F4> struct Block
+    {
+        F4 r[4], g[4], b[4], a[4];
+    };
+
+    struct Color
+    {
+        float r, g, b;
+    };
+
+    template <typename F4> inline float sum16(const F4 v[4])
+    {
+        return hsum((v[0] + v[1]) + (v[2] + v[3]));
+    }
+
+    template <typename F4> inline float min16(const F4 v[4])
+    {
+        return hmin(vmin(vmin(v[0], v[1]), vmin(v[2], v[3])));
+    }
+
+    template <typename F4> inline float max16(const F4 v[4])
+    {
+        return hmax(vmax(vmax(v[0], v[1]), vmax(v[2], v[3])));
+    }
+
+    inline float clamp255(float v)
+    {
+        return std::min(std::max(v, 0.f), 255.f);
+    }
+
+    inline int expand5(int v)
+    {
+        return (v << 3) | (v >> 2);
+    }
+
+    inline int expand6(int v)
+    {
+        return (v << 2) | (v >> 4);
+    }
+
+    inline int quantize(float v, int max)
+    {
+        return std::min(std::max(static_cast<int>(v * max / 255.f + 0.5f), 0), max);
+    }
+
+    inline unsigned short pack565(const Color & c)
+    {
+        return static_cast<unsigned short>((quantize(c.r, 31) << 11) | (quantize(c.g, 63) << 5) | quantize(c.b, 31));
+    }
+
+    inline Color unpack565(unsigned short c)
+    {
+        Color result = { float(expand5(c >> 11)), float(expand6((c >> 5) & 63)), float(expand5(c & 31)) };
+        return result;
+    }
+
+    // Interpolated palette entry, rounded like the reference decoder does
+    inline Color lerp13(const Color & c0, const Color & c1)
+    {
+        Color result = { float((2 * int(c0.r) + int(c1.r)) / 3), float((2 * int(c0.g) + int(c1.g)) / 3), float((2 * int(c0.b) + int(c1.b)) / 3) };
+        return result;
+    }
+
+    // Endpoint pairs that reproduce every 8-bit value most accurately with the 1/3 palette entry
+    struct SingleColorTables
+    {
+        unsigned char match5[256][2];
+        unsigned char match6[256][2];
+
+        SingleColorTables()
+        {
+            build(match5, 5);
+            build(match6, 6);
+        }
+
+        static void build(unsigned char table[256][2], int bits)
+        {
+            int count = 1 << bits;
+
+            for (int v = 0; v < 256; ++v)
+            {
+                int bestCost = INT_MAX;
+
+                for (int e0 = 0; e0 < count; ++e0)
+                    for (int e1 = 0; e1 < count; ++e1)
+                    {
+                        int c0 = bits == 5 ? expand5(e0) : expand6(e0);
+                        int c1 = bits == 5 ? expand5(e1) : expand6(e1);
+
+                        // prefer close endpoints since decoders are allowed to deviate in interpolation precision
+                        int cost = abs((2 * c0 + c1) / 3 - v) * 256 + abs(c0 - c1);
+
+                        if (cost < bestCost)
+                        {
+                            bestCost = cost;
+                            table[v][0] = static_cast<unsigned char>(e0);
+                            table[v][1] = static_cast<unsigned char>(e1);
+                        }
+                    }
+            }
+        }
+    } g_singleColorTables;
+
+    // Write BC1 color block; endpoints are swapped if necessary so that the block uses four color mode
+    void writeColorBlock(unsigned short c0, unsigned short c1, const float indices[16], unsigned char * output)
+    {
+        unsigned int bits = 0;
+
+        // equal endpoints decode in three color mode, where index 3 is transparent; index 0 is exact anyway
+        if (c0 != c1)
+        {
+            unsigned int flip = 0;
+
+            if (c0 < c1)
+            {
+                std::swap(c0, c1);
+                flip = 1;
+            }
+
+            for (int i = 0; i < 16; ++i)
+                bits |= (static_cast<unsigned int>(indices[i]) ^ flip) << (2 * i);
+        }
+
+        output[0] = static_cast<unsigned char>(c0);
+        output[1] = static_cast<unsigned char>(c0 >> 8);
+        output[2] = static_cast<unsigned char>(c1);
+        output[3] = static_cast<unsigned char>(c1 >> 8);
+
+        for (int i = 0; i < 4; ++i)
+            output[4 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+
+    template <typename F4> inline F4 distance(const F4 & r, const F4 & g, const F4 & b, const Color & c)
+    {
+        F4 dr = r - F4(c.r), dg = g - F4(c.g), db = b - F4(c.b);
+
+        return (dr * dr + dg * dg) + db * db;
+    }
+
+    // Select the closest palette entry for every pixel; returns the total squared error
+    template <typename F4> float selectColorIndices(const F4 r[4], const F4 g[4], const F4 b[4], unsigned short c0, unsigned short c1, F4 indices[4])
+    {
+        Color palette[4];
+        palette[0] = unpack565(c0);
+        palette[1] = unpack565(c1);
+        palette[2] = lerp13(palette[0], palette[1]);
+        palette[3] = lerp13(palette[1], palette[0]);
+
+        F4 error(0.f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            F4 best = distance(r[i], g[i], b[i], palette[0]);
+            F4 index(0.f);
+
+            for (int k = 1; k < 4; ++k)
+            {
+                F4 d = distance(r[i], g[i], b[i], palette[k]);
+
+                index = select(less(d, best), F4(float(k)), index);
+                best = vmin(d, best);
+            }
+
+            indices[i] = index;
+            error = error + best;
+        }
+
+        return hsum(error);
+    }
+
+    // Endpoints along the principal axis of the colors, through the extreme projections
+    template <typename F4> void computePrincipalEndpoints(const F4 r[4], const F4 g[4], const F4 b[4], Color & c0, Color & c1)
+    {
+        Color mean = { sum16(r) / 16, sum16(g) / 16, sum16(b) / 16 };
+
+        F4 dr[4], dg[4], db[4];
+        F4 rr(0.f), rg(0.f), rb(0.f), gg(0.f), gb(0.f), bb(0.f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            dr[i] = r[i] - F4(mean.r);
+            dg[i] = g[i] - F4(mean.g);
+            db[i] = b[i] - F4(mean.b);
+
+            rr = rr + dr[i] * dr[i];
+            rg = rg + dr[i] * dg[i];
+            rb = rb + dr[i] * db[i];
+            gg = gg + dg[i] * dg[i];
+            gb = gb + dg[i] * db[i];
+            bb = bb + db[i] * db[i];
+        }
+
+        float crr = hsum(rr), crg = hsum(rg), crb = hsum(rb), cgg = hsum(gg), cgb = hsum(gb), cbb = hsum(bb);
+
+        // power iteration, starting from the covariance matrix column with the largest variance
+        float vr, vg, vb;
+
+        if (crr >= cgg && crr >= cbb) vr = crr, vg = crg, vb = crb;
+        else if (cgg >= cbb) vr = crg, vg = cgg, vb = cgb;
+        else vr = crb, vg = cgb, vb = cbb;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            float nr = crr * vr + crg * vg + crb * vb;
+            float ng = crg * vr + cgg * vg + cgb * vb;
+            float nb = crb * vr + cgb * vg + cbb * vb;
+
+            float scale = std::max(std::max(fabsf(nr), fabsf(ng)), fabsf(nb));
+            if (scale == 0) break;
+
+            vr = nr / scale, vg = ng / scale, vb = nb / scale;
+        }
+
+        float length2 = vr * vr + vg * vg + vb * vb;
+
+        if (length2 < 1e-8f)
+        {
+            c0 = c1 = mean;
+            return;
+        }
+
+        F4 projection[4];
+
+        for (int i = 0; i < 4; ++i)
+            projection[i] = (dr[i] * F4(vr) + dg[i] * F4(vg)) + db[i] * F4(vb);
+
+        float tmax = max16(projection) / length2;
+        float tmin = min16(projection) / length2;
+
+        c0.r = clamp255(mean.r + vr * tmax);
+        c0.g = clamp255(mean.g + vg * tmax);
+        c0.b = clamp255(mean.b + vb * tmax);
+
+        c1.r = clamp255(mean.r + vr * tmin);
+        c1.g = clamp255(mean.g + vg * tmin);
+        c1.b = clamp255(mean.b + vb * tmin);
+    }
+
+    // Bounding box endpoints; the box diagonal follows the color covariance and is inset to account for the
+    // interpolated entries (same as nvtt QuickCompress)
+    template <typename F4> void computeBoxEndpoints(const F4 r[4], const F4 g[4], const F4 b[4], const Color & lo, const Color & hi, Color & c0, Color & c1)
+    {
+        Color center = { (lo.r + hi.r) * 0.5f, (lo.g + hi.g) * 0.5f, (lo.b + hi.b) * 0.5f };
+
+        F4 covr(0.f), covg(0.f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            F4 db = b[i] - F4(center.b);
+
+            covr = covr + (r[i] - F4(center.r)) * db;
+            covg = covg + (g[i] - F4(center.g)) * db;
+        }
+
+        c0 = hi;
+        c1 = lo;
+
+        if (hsum(covr) < 0) std::swap(c0.r, c1.r);
+        if (hsum(covg) < 0) std::swap(c0.g, c1.g);
+
+        Color inset = { (c0.r - c1.r) / 16 - 0.5f, (c0.g - c1.g) / 16 - 0.5f, (c0.b - c1.b) / 16 - 0.5f };
+
+        c0.r = clamp255(c0.r - inset.r);
+        c0.g = clamp255(c0.g - inset.g);
+        c0.b = clamp255(c0.b - inset.b);
+
+        c1.r = clamp255(c1.r + inset.r);
+        c1.g = clamp255(c1.g + inset.g);
+        c1.b = clamp255(c1.b + inset.b);
+    }
+
+    // Least squares endpoints for the selected indices; returns false if the system is degenerate
+    template <typename F4> bool computeLeastSquaresEndpoints(const F4 r[4], const F4 g[4], const F4 b[4], const F4 indices[4], Color & c0, Color & c1)
+    {
+        F4 aa(0.f), ab(0.f), bb(0.f);
+        F4 alphaR(0.f), alphaG(0.f), alphaB(0.f), betaR(0.f), betaG(0.f), betaB(0.f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            // palette weight of the first endpoint: 1, 0, 2/3, 1/3
+            F4 alpha =
+                select(less(indices[i], F4(0.5f)), F4(1.f),
+                select(less(indices[i], F4(1.5f)), F4(0.f),
+                select(less(indices[i], F4(2.5f)), F4(2.f / 3.f), F4(1.f / 3.f))));
+            F4 beta = F4(1.f) - alpha;
+
+            aa = aa + alpha * alpha;
+            ab = ab + alpha * beta;
+            bb = bb + beta * beta;
+
+            alphaR = alphaR + alpha * r[i];
+            alphaG = alphaG + alpha * g[i];
+            alphaB = alphaB + alpha * b[i];
+
+            betaR = betaR + beta * r[i];
+            betaG = betaG + beta * g[i];
+            betaB = betaB + beta * b[i];
+        }
+
+        float saa = hsum(aa), sab = hsum(ab), sbb = hsum(bb);
+        float det = saa * sbb - sab * sab;
+
+        if (fabsf(det) < 1e-6f)
+            return false;
+
+        float inv = 1.f / det;
+
+        Color sa = { hsum(alphaR), hsum(alphaG), hsum(alphaB) };
+        Color sb = { hsum(betaR), hsum(betaG), hsum(betaB) };
+
+        c0.r = clamp255((sbb * sa.r - sab * sb.r) * inv);
+        c0.g = clamp255((sbb * sa.g - sab * sb.g) * inv);
+        c0.b = clamp255((sbb * sa.b - sab * sb.b) * inv);
+
+        c1.r = clamp255((saa * sb.r - sab * sa.r) * inv);
+        c1.g = clamp255((saa * sb.g - sab * sa.g) * inv);
+        c1.b = clamp255((saa * sb.b - sab * sa.b) * inv);
+
+        return true;
+    }
+
+    // Encode BC1 color block (always in four color mode, so the block is also valid for BC3)
+    template <typename F4> void encodeColor(const Block<F4> & block, bool refine, unsigned char * output)
+    {
+        const F4 * r = block.r;
+        const F4 * g = block.g;
+        const F4 * b = block.b;
+
+        Color lo = { min16(r), min16(g), min16(b) };
+        Color hi = { max16(r), max16(g), max16(b) };
+
+        float indices[16];
+
+        // single color blocks use the interpolated palette entry to get closer to the exact color
+        if (lo.r == hi.r && lo.g == hi.g && lo.b == hi.b)
+        {
+            int cr = static_cast<int>(lo.r), cg = static_cast<int>(lo.g), cb = static_cast<int>(lo.b);
+
+            unsigned short c0 = static_cast<unsigned short>((g_singleColorTables.match5[cr][0] << 11) | (g_singleColorTables.match6[cg][0] << 5) | g_singleColorTables.match5[cb][0]);
+            unsigned short c1 = static_cast<unsigned short>((g_singleColorTables.match5[cr][1] << 11) | (g_singleColorTables.match6[cg][1] << 5) | g_singleColorTables.match5[cb][1]);
+
+            std::fill(indices, indices + 16, 2.f);
+            writeColorBlock(c0, c1, indices, output);
+            return;
+        }
+
+        Color c0, c1;
+
+        if (refine)
+            computePrincipalEndpoints(r, g, b, c0, c1);
+        else
+            computeBoxEndpoints(r, g, b, lo, hi, c0, c1);
+
+        unsigned short e0 = pack565(c0), e1 = pack565(c1);
+
+        F4 best[4];
+        float error = selectColorIndices(r, g, b, e0, e1, best);
+
+        for (int iteration = 0; refine && iteration < 2; ++iteration)
+        {
+            if (!computeLeastSquaresEndpoints(r, g, b, best, c0, c1))
+                break;
+
+            unsigned short n0 = pack565(c0), n1 = pack565(c1);
+            if (n0 == e0 && n1 == e1)
+                break;
+
+            F4 candidate[4];
+            float candidateError = selectColorIndices(r, g, b, n0, n1, candidate);
+            if (candidateError >= error)
+                break;
+
+            e0 = n0;
+            e1 = n1;
+            error = candidateError;
+
+            for (int i = 0; i < 4; ++i)
+                best[i] = candidate[i];
+        }
+
+        for (int i = 0; i < 4; ++i)
+            best[i].store(indices + 4 * i);
+
+        writeColorBlock(e0, e1, indices, output);
+    }
+
+    // Write BC4 block given the palette positions between a1 (0) and a0 (7); a0 > a1 selects eight value mode
+    void writeChannelBlock(int a0, int a1, const float positions[16], unsigned char * output)
+    {
+        unsigned long long bits = 0;
+
+        if (a0 != a1)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                int position = static_cast<int>(positions[i]);
+                int index = position == 7 ? 0 : position == 0 ? 1 : 8 - position;
+
+                bits |= static_cast<unsigned long long>(index) << (3 * i);
+            }
+        }
+
+        output[0] = static_cast<unsigned char>(a0);
+        output[1] = static_cast<unsigned char>(a1);
+
+        for (int i = 0; i < 6; ++i)
+            output[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+
+    // Select the closest palette position for every value; returns the total squared error
+    template <typename F4> float selectChannelPositions(const F4 v[4], int a0, int a1, F4 positions[4])
+    {
+        F4 base(static_cast<float>(a1));
+        F4 scale(7.f / (a0 - a1));
+        F4 step((a0 - a1) / 7.f);
+
+        F4 error(0.f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            F4 t = vmin(vmax((v[i] - base) * scale, F4(0.f)), F4(7.f));
+
+            positions[i] = truncate(t + F4(0.5f));
+
+            F4 d = v[i] - (base + positions[i] * step);
+            error = error + d * d;
+        }
+
+        return hsum(error);
+    }
+
+    // Least squares endpoints for the selected positions; returns false if the system is degenerate
+    template <typename F4> bool computeLeastSquaresEndpoints(const F4 v[4], const F4 positions[4], float & a0, float & a1)
+    {
+        F4 aa(0.f), ab(0.f), bb(0.f), av(0.f), bv(0.f);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            F4 alpha = positions[i] * F4(1.f / 7.f);
+            F4 beta = F4(1.f) - alpha;
+
+            aa = aa + alpha * alpha;
+            ab = ab + alpha * beta;
+            bb = bb + beta * beta;
+            av = av + alpha * v[i];
+            bv = bv + beta * v[i];
+        }
+
+        float saa = hsum(aa), sab = hsum(ab), sbb = hsum(bb);
+        float det = saa * sbb - sab * sab;
+
+        if (fabsf(det) < 1e-6f)
+            return false;
+
+        float inv = 1.f / det;
+        float sav = hsum(av), sbv = hsum(bv);
+
+        a0 = clamp255((sbb * sav - sab * sbv) * inv);
+        a1 = clamp255((saa * sbv - sab * sav) * inv);
+
+        return true;
+    }
+
+    // Encode BC4 block (also used for BC3 alpha and BC5 channels)
+    template <typename F4> void encodeChannel(const F4 v[4], bool refine, unsigned char * output)
+    {
+        int a0 = static_cast<int>(max16(v));
+        int a1 = static_cast<int>(min16(v));
+
+        float positions[16] = {};
+
+        if (a0 == a1)
+        {
+            writeChannelBlock(a0, a1, positions, output);
+            return;
+        }
+
+        F4 best[4];
+        float error = selectChannelPositions(v, a0, a1, best);
+
+        for (int iteration = 0; refine && iteration < 2; ++iteration)
+        {
+            float f0, f1;
+            if (!computeLeastSquaresEndpoints(v, best, f0, f1))
+                break;
+
+            int n0 = static_cast<int>(f0 + 0.5f), n1 = static_cast<int>(f1 + 0.5f);
+            if (n0 <= n1 || (n0 == a0 && n1 == a1))
+                break;
+
+            F4 candidate[4];
+            float candidateError = selectChannelPositions(v, n0, n1, candidate);
+            if (candidateError >= error)
+                break;
+
+            a0 = n0;
+            a1 = n1;
+            error = candidateError;
+
+            for (int i = 0; i < 4; ++i)
+                best[i] = candidate[i];
+        }
+
+        for (int i = 0; i < 4; ++i)
+            best[i].store(positions + 4 * i);
+
+        writeChannelBlock(a0, a1, positions, output);
+    }
+
+    // Fetch 4x4 block at (x, y); pixels outside of the image are clamped to the edge
+    template <typename F4> void fetchBlock(const unsigned char * pixels, int width, int height, int x, int y, Block<F4> & block)
+    {
+        if (x + 4 <= width && y + 4 <= height)
+        {
+            for (int j = 0; j < 4; ++j)
+                F4::loadPixels(pixels + ((y + j) * width + x) * 4, block.b[j], block.g[j], block.r[j], block.a[j]);
+        }
+        else
+        {
+            unsigned char edge[64];
+
+            for (int j = 0; j < 4; ++j)
+                for (int i = 0; i < 4; ++i)
+                    memcpy(edge + (j * 4 + i) * 4, pixels + (std::min(y + j, height - 1) * width + std::min(x + i, width - 1)) * 4, 4);
+
+            for (int j = 0; j < 4; ++j)
+                F4::loadPixels(edge + j * 16, block.b[j], block.g[j], block.r[j], block.a[j]);
+        }
+    }
+
+    int blockSize(nvtt::Format format)
+    {
+        return (format == nvtt::Format_DXT1 || format == nvtt::Format_BC4) ? 8 : 16;
+    }
+
+    // Encode a row of blocks that starts at pixel row y
+    template <typename F4> void encodeRow(nvtt::Format format, bool refine, const unsigned char * pixels, int width, int height, int y, unsigned char * output)
+    {
+        Block<F4> block;
+
+        for (int x = 0; x < width; x += 4)
+        {
+            fetchBlock(pixels, width, height, x, y, block);
+
+            switch (format)
+            {
+            case nvtt::Format_DXT1:
+                encodeColor<F4>(block, refine, output);
+                break;
+
+            case nvtt::Format_DXT5:
+                encodeChannel<F4>(block.a, refine, output);
+                encodeColor<F4>(block, refine, output + 8);
+                break;
+
+            case nvtt::Format_BC4:
+                encodeChannel<F4>(block.r, refine, output);
+                break;
+
+            case nvtt::Format_BC5:
+                encodeChannel<F4>(block.r, refine, output);
+                encodeChannel<F4>(block.g, refine, output + 8);
+                break;
+
+            default:
+                nvDebugCheck(false);
+            }
+
+            output += blockSize(format);
+        }
+    }
+
+    typedef void EncodeRowFunction(nvtt::Format format, bool refine, const unsigned char * pixels, int width, int height, int y, unsigned char * output);
+
+    bool detectSSE2()
+    {
+        int info[4];
+        __cpuid(info, 1);
+
+        return (info[3] & (1 << 26)) != 0;
+    }
+
+    const bool g_hasSSE2 = detectSSE2();
+
+    EncodeRowFunction * getEncoder(bool simd)
+    {
+        return simd ? &encodeRow<Float4SSE2> : &encodeRow<Float4Scalar>;
+    }
+}
+
+bool fastCompressIsSupported(nvtt::Format format, nvtt::Quality quality)
+{
+    return (quality == nvtt::Quality_Fastest || quality == nvtt::Quality_Normal) &&
+        (format == nvtt::Format_DXT1 || format == nvtt::Format_DXT5 || format == nvtt::Format_BC4 || format == nvtt::Format_BC5);
+}
+
+void fastCompressRow(nvtt::Format format, nvtt::Quality quality, const unsigned char * pixels, int width, int height, int y, unsigned char * output)
+{
+    getEncoder(g_hasSSE2)(format, quality != nvtt::Quality_Fastest, pixels, width, height, y, output);
+}
+
+void fastCompressImage(nvtt::Format format, nvtt::Quality quality, const unsigned char * pixels, int width, int height, unsigned char * output, bool simd)
+{
+    EncodeRowFunction * encode = getEncoder(simd);
+    int rowSize = ((width + 3) / 4) * blockSize(format);
+
+    for (int y = 0; y < height; y += 4)
+        encode(format, quality != nvtt::Quality_Fastest, pixels, width, height, y, output + (y / 4) * rowSize);
+}
+
+bool fastCompressHasSIMD()
+{
+    return g_hasSSE2;
+}
@@ -0,0 +1,24 @@
+#ifndef FASTCOMPRESS_H
+#define FASTCOMPRESS_H
+
+#include <nvtt/nvtt.h>
+
+// Fast block encoder for BC1, BC3, BC4 and BC5 that replaces nvtt compressors for Fastest and Normal quality.
+// nvtt still does all image processing (mipmap generation, gamma, normal maps); the encoder works on the resulting
+// RGBA surfaces (see SurfaceCompressOutputHandler).
+
+// Check if the fast encoder supports the format and quality.
+bool fastCompressIsSupported(nvtt::Format format, nvtt::Quality quality);
+
+// Encode a row of blocks that starts at pixel row y; pixels are in BGRA order, rows are tightly packed. Uses the SIMD
+// path if the CPU supports it.
+void fastCompressRow(nvtt::Format format, nvtt::Quality quality, const unsigned char * pixels, int width, int height, int y, unsigned char * output);
+
+// Encode the image on the calling thread; pixels are in BGRA order, rows are tightly packed, blocks are written in row
+// order. The scalar path produces the same output as the SIMD one and is used on CPUs without SSE2.
+void fastCompressImage(nvtt::Format format, nvtt::Quality quality, const unsigned char * pixels, int width, int height, unsigned char * output, bool simd);
+
+// Check if the CPU supports the SIMD path.
+bool fastCompressHasSIMD();
+
+#endif
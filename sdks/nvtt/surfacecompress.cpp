@@ -0,0 +1,171 @@
+#include "surfacecompress.h"
+#include "fastcompress.h"
+#include "taskpool.h"
+
+#include <nvtt/CompressionOptions.h>
+#include <nvcore/Debug.h>
+
+#include <algorithm>
+
+namespace
+{
+    // DDS header fields
+    const unsigned int DDSD_PITCH = 0x8;
+    const unsigned int DDSD_LINEARSIZE = 0x80000;
+    const unsigned int DDPF_FOURCC = 0x4;
+    const unsigned int DDPF_NORMAL = 0x80000000U;
+
+    unsigned int makeFourCC(char a, char b, char c, char d)
+    {
+        return static_cast<unsigned char>(a) | (static_cast<unsigned char>(b) << 8) | (static_cast<unsigned char>(c) << 16) | (static_cast<unsigned int>(static_cast<unsigned char>(d)) << 24);
+    }
+
+    unsigned int getFourCC(nvtt::Format format)
+    {
+        switch (format)
+        {
+        case nvtt::Format_DXT1: return makeFourCC('D', 'X', 'T', '1');
+        case nvtt::Format_DXT3: return makeFourCC('D', 'X', 'T', '3');
+        case nvtt::Format_DXT5: return makeFourCC('D', 'X', 'T', '5');
+        case nvtt::Format_DXT5n: return makeFourCC('D', 'X', 'T', '5');
+        case nvtt::Format_BC4: return makeFourCC('A', 'T', 'I', '1');
+        case nvtt::Format_BC5: return makeFourCC('A', 'T', 'I', '2');
+        default: return 0;
+        }
+    }
+
+    int getRowSize(nvtt::Format format, int width)
+    {
+        return ((width + 3) / 4) * ((format == nvtt::Format_DXT1 || format == nvtt::Format_BC4) ? 8 : 16);
+    }
+
+    int getCompressedSize(nvtt::Format format, int width, int height)
+    {
+        return getRowSize(format, width) * ((height + 3) / 4);
+    }
+}
+
+SurfaceCompressOutputHandler::SurfaceCompressOutputHandler(const nvtt::CompressionOptions & options, nvtt::OutputHandler & target):
+    target(target), format(options.m.format), quality(options.m.quality), failed(false)
+{
+}
+
+bool SurfaceCompressOutputHandler::isSupported(const nvtt::CompressionOptions & options)
+{
+    return fastCompressIsSupported(options.m.format, options.m.quality);
+}
+
+void SurfaceCompressOutputHandler::setupInputOptions(const nvtt::CompressionOptions & options, nvtt::CompressionOptions & rgbaOptions)
+{
+    rgbaOptions.setFormat(nvtt::Format_RGBA);
+    rgbaOptions.setPixelFormat(32, 0xFF0000, 0xFF00, 0xFF, 0xFF000000);
+    rgbaOptions.setQuality(options.m.quality);
+}
+
+void SurfaceCompressOutputHandler::beginImage(int size, int width, int height, int depth, int face, int miplevel)
+{
+    Surface surface;
+    surface.width = width;
+    surface.height = height;
+    surface.depth = depth;
+    surface.face = face;
+    surface.miplevel = miplevel;
+
+    surfaces.push_back(surface);
+    surfaces.back().pixels.reserve(size);
+}
+
+bool SurfaceCompressOutputHandler::writeData(const void * data, int size)
+{
+    const unsigned char * bytes = static_cast<const unsigned char *>(data);
+
+    // nvtt writes the header before the first image
+    std::vector<unsigned char> & buffer = surfaces.empty() ? header : surfaces.back().pixels;
+    buffer.insert(buffer.end(), bytes, bytes + size);
+
+    return true;
+}
+
+void SurfaceCompressOutputHandler::endImage()
+{
+}
+
+bool SurfaceCompressOutputHandler::finish()
+{
+    for (size_t i = 0; i < surfaces.size(); ++i)
+    {
+        const Surface & surface = surfaces[i];
+
+        if (surface.depth != 1 || surface.pixels.size() != static_cast<size_t>(surface.width) * surface.height * 4)
+        {
+            nvDebug("Unexpected image layout for surface compression: %dx%dx%d, %d bytes.\n", surface.width, surface.height, surface.depth, static_cast<int>(surface.pixels.size()));
+            return false;
+        }
+    }
+
+    // Every block row of every surface is a separate task
+    rowOffsets.assign(1, 0);
+
+    for (size_t i = 0; i < surfaces.size(); ++i)
+    {
+        surfaces[i].blocks.resize(getCompressedSize(format, surfaces[i].width, surfaces[i].height));
+        rowOffsets.push_back(rowOffsets.back() + (surfaces[i].height + 3) / 4);
+    }
+
+    TaskPool::instance().dispatch(encodeRowTask, this, rowOffsets.back());
+
+    if (!writeHeader())
+        return false;
+
+    for (size_t i = 0; i < surfaces.size() && !failed; ++i)
+    {
+        const Surface & surface = surfaces[i];
+        int size = static_cast<int>(surface.blocks.size());
+
+        target.beginImage(size, surface.width, surface.height, surface.depth, surface.face, surface.miplevel);
+
+        if (!target.writeData(&surface.blocks[0], size))
+            failed = true;
+
+        target.endImage();
+    }
+
+    return !failed;
+}
+
+void SurfaceCompressOutputHandler::encodeRowTask(void * handlerP, int id)
+{
+    SurfaceCompressOutputHandler & handler = *static_cast<SurfaceCompressOutputHandler *>(handlerP);
+
+    // Find the surface that contains the row
+    size_t index = std::upper_bound(handler.rowOffsets.begin(), handler.rowOffsets.end(), id) - handler.rowOffsets.begin() - 1;
+    int row = id - handler.rowOffsets[index];
+
+    Surface & surface = handler.surfaces[index];
+
+    fastCompressRow(handler.format, handler.quality, &surface.pixels[0], surface.width, surface.height, row * 4, &surface.blocks[row * getRowSize(handler.format, surface.width)]);
+}
+
+bool SurfaceCompressOutputHandler::writeHeader()
+{
+    // nvtt writes a plain DX9 header for RGBA data; patch the pixel format to describe compressed data
+    if (header.size() != 128)
+    {
+        nvDebug("Unexpected DDS header size for surface compression: %d bytes.\n", static_cast<int>(header.size()));
+        return false;
+    }
+
+    unsigned int * fields = reinterpret_cast<unsigned int *>(&header[0]);
+
+    fields[2] = (fields[2] & ~DDSD_PITCH) | DDSD_LINEARSIZE;
+    fields[5] = getCompressedSize(format, fields[4], fields[3]);
+
+    fields[20] = DDPF_FOURCC | (fields[20] & DDPF_NORMAL);
+    fields[21] = getFourCC(format);
+    std::fill(fields + 22, fields + 27, 0);
+
+    if (!target.writeData(&header[0], static_cast<int>(header.size())))
+        failed = true;
+
+    return !failed;
+}
@@ -0,0 +1,58 @@
+#ifndef SURFACECOMPRESS_H
+#define SURFACECOMPRESS_H
+
+#include <nvtt/nvtt.h>
+
+#include <vector>
+
+// Compresses all faces and mipmaps of a texture with the fast encoder in parallel. nvtt does the image processing (mipmap
+// generation, gamma, normal maps) in an RGBA pass; the handler collects the resulting surfaces and encodes their block
+// rows with a single dispatch that covers all of them, so small mipmaps and the other cube faces do not wait for the top
+// level one by one. The DDS data is forwarded to the target handler in the usual order once all surfaces are encoded.
+class SurfaceCompressOutputHandler: public nvtt::OutputHandler
+{
+public:
+    SurfaceCompressOutputHandler(const nvtt::CompressionOptions & options, nvtt::OutputHandler & target);
+
+    // Check if the fast encoder supports the compression options.
+    static bool isSupported(const nvtt::CompressionOptions & options);
+
+    // Setup options for the RGBA pass that produces the encoder input.
+    static void setupInputOptions(const nvtt::CompressionOptions & options, nvtt::CompressionOptions & rgbaOptions);
+
+    virtual void beginImage(int size, int width, int height, int depth, int face, int miplevel);
+    virtual bool writeData(const void * data, int size);
+    virtual void endImage();
+
+    // Encode all surfaces and write the DDS data; returns false if the input was malformed, a surface failed to encode
+    // or the target failed to write the data.
+    bool finish();
+
+private:
+    struct Surface
+    {
+        int width, height, depth, face, miplevel;
+
+        std::vector<unsigned char> pixels;
+        std::vector<unsigned char> blocks;
+    };
+
+    // Encoder task; encodes a row of blocks, rows of all surfaces are numbered consecutively.
+    static void encodeRowTask(void * handler, int id);
+
+    bool writeHeader();
+
+    nvtt::OutputHandler & target;
+
+    nvtt::Format format;
+    nvtt::Quality quality;
+
+    std::vector<unsigned char> header;
+    std::vector<Surface> surfaces;
+
+    std::vector<int> rowOffsets; // first block row of each surface
+
+    bool failed;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "taskpool.h"
+
+#include <algorithm>
+
+// Job that the current thread runs tasks of; nested dispatches become children of this job
+static __declspec(thread) void * t_currentJob;
+
+TaskPool::TaskPool(int workerCount): stop(false)
+{
+    InitializeCriticalSection(&lock);
+    InitializeConditionVariable(&jobAdded);
+    InitializeConditionVariable(&jobReleased);
+
+    for (int i = 0; i < workerCount; ++i)
+    {
+        HANDLE thread = CreateThread(NULL, 0, workerThread, this, 0, NULL);
+
+        if (thread)
+            workers.push_back(thread);
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    EnterCriticalSection(&lock);
+    stop = true;
+    WakeAllConditionVariable(&jobAdded);
+    LeaveCriticalSection(&lock);
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        WaitForSingleObject(workers[i], INFINITE);
+        CloseHandle(workers[i]);
+    }
+
+    DeleteCriticalSection(&lock);
+}
+
+void TaskPool::dispatch(nvtt::Task * task, void * context, int count)
+{
+    if (count <= 0)
+        return;
+
+    // Don't bother with synchronization for trivial jobs
+    if (count == 1 || workers.empty())
+    {
+        for (int i = 0; i < count; ++i)
+            task(context, i);
+
+        return;
+    }
+
+    // Block compressors dispatch one task per block, so take several blocks at a time to keep the overhead low
+    // while leaving enough chunks for load balancing
+    int threadCount = static_cast<int>(workers.size()) + 1;
+
+    Job job;
+    job.task = task;
+    job.context = context;
+    job.count = count;
+    job.grain = std::max(1, count / (threadCount * 16));
+    job.parent = static_cast<Job *>(t_currentJob);
+    job.next = 0;
+    job.users = 0;
+
+    EnterCriticalSection(&lock);
+    jobs.push_back(&job);
+    WakeAllConditionVariable(&jobAdded);
+
+    // Threads that wait for the parent job can help with this one
+    if (job.parent)
+        WakeAllConditionVariable(&jobReleased);
+
+    LeaveCriticalSection(&lock);
+
+    run(job);
+
+    // All indices are taken, but other threads might still be working on the job; help with the jobs that they
+    // dispatch meanwhile. Other jobs can take arbitrarily long, so picking them up would delay the return.
+    EnterCriticalSection(&lock);
+
+    while (job.users > 0)
+    {
+        if (Job * other = acquire(&job))
+        {
+            LeaveCriticalSection(&lock);
+            run(*other);
+            EnterCriticalSection(&lock);
+
+            release(other);
+        }
+        else
+        {
+            SleepConditionVariableCS(&jobReleased, &lock, INFINITE);
+        }
+    }
+
+    // The job can still be in the list if nobody looked at it after it was exhausted
+    std::vector<Job *>::iterator it = std::find(jobs.begin(), jobs.end(), &job);
+    if (it != jobs.end())
+        jobs.erase(it);
+
+    LeaveCriticalSection(&lock);
+}
+
+TaskPool & TaskPool::instance()
+{
+    static TaskPool * volatile pool;
+
+    if (!pool)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+
+        TaskPool * instance = new TaskPool(std::max(1, static_cast<int>(info.dwNumberOfProcessors) - 1));
+
+        // Another thread could have created the pool concurrently; note that the pool is never destroyed, since
+        // joining worker threads from DLL unload would deadlock on the loader lock.
+        if (InterlockedCompareExchangePointer(reinterpret_cast<void * volatile *>(&pool), instance, NULL) != NULL)
+            delete instance;
+    }
+
+    return *pool;
+}
+
+DWORD WINAPI TaskPool::workerThread(void * pool)
+{
+    static_cast<TaskPool *>(pool)->worker();
+
+    return 0;
+}
+
+void TaskPool::worker()
+{
+    EnterCriticalSection(&lock);
+
+    for (;;)
+    {
+        Job * job = NULL;
+
+        while (!stop && (job = acquire(NULL)) == NULL)
+            SleepConditionVariableCS(&jobAdded, &lock, INFINITE);
+
+        if (stop)
+            break;
+
+        LeaveCriticalSection(&lock);
+        run(*job);
+        EnterCriticalSection(&lock);
+
+        release(job);
+    }
+
+    LeaveCriticalSection(&lock);
+}
+
+void TaskPool::run(Job & job)
+{
+    void * previous = t_currentJob;
+    t_currentJob = &job;
+
+    for (;;)
+    {
+        LONG begin = InterlockedExchangeAdd(&job.next, job.grain);
+        if (begin >= job.count)
+            break;
+
+        LONG end = std::min(begin + job.grain, static_cast<LONG>(job.count));
+
+        for (LONG i = begin; i < end; ++i)
+            job.task(job.context, i);
+    }
+
+    t_currentJob = previous;
+}
+
+bool TaskPool::isNested(const Job * job, const Job * root)
+{
+    for (const Job * parent = job->parent; parent; parent = parent->parent)
+        if (parent == root)
+            return true;
+
+    return false;
+}
+
+TaskPool::Job * TaskPool::acquire(const Job * root)
+{
+    // Prefer the most recent job: it is likely to be a nested dispatch that some other job waits for
+    for (size_t i = jobs.size(); i > 0; --i)
+    {
+        Job * job = jobs[i - 1];
+
+        if (job->next >= job->count)
+        {
+            // All work is taken, nobody else needs to see the job
+            jobs.erase(jobs.begin() + (i - 1));
+        }
+        else if (!root || isNested(job, root))
+        {
+            job->users++;
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+void TaskPool::release(Job * job)
+{
+    if (--job->users == 0)
+        WakeAllConditionVariable(&jobReleased);
+}
@@ -0,0 +1,72 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <nvtt/nvtt.h>
+
+#include <vector>
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+// Persistent worker pool that implements nvtt task dispatching.
+// The dispatching thread takes part in the work, and while waiting for its own job it only helps with jobs that were
+// dispatched from the tasks of that job (i.e. blocks of a surface that is compressed by one of its tasks), so dispatch
+// can be called concurrently from several threads and from inside other tasks without deadlocks, and a waiting thread
+// never gets stuck in an unrelated job.
+class TaskPool: public nvtt::TaskDispatcher
+{
+public:
+    explicit TaskPool(int workerCount);
+    ~TaskPool();
+
+    virtual void dispatch(nvtt::Task * task, void * context, int count);
+
+    // Shared pool with a worker per core (minus one for the dispatching thread); it lives until process exit.
+    static TaskPool & instance();
+
+private:
+    struct Job
+    {
+        nvtt::Task * task;
+        void * context;
+        int count;
+        int grain;
+
+        Job * parent;       // job whose task dispatched this one, NULL for top-level dispatches
+
+        volatile LONG next; // first index that is not taken yet
+        int users;          // number of threads other than the owner that are working on the job
+    };
+
+    TaskPool(const TaskPool &);
+    TaskPool & operator=(const TaskPool &);
+
+    static DWORD WINAPI workerThread(void * pool);
+
+    void worker();
+
+    // Execute job tasks until all indices are taken.
+    static void run(Job & job);
+
+    // Check if the job was dispatched from the tasks of the root job, directly or through other nested jobs.
+    static bool isNested(const Job * job, const Job * root);
+
+    // Get a job that has unclaimed work; if root is not NULL, only jobs nested in root are considered. Must be called
+    // with the lock held.
+    Job * acquire(const Job * root);
+
+    // Release the job acquired with acquire(); must be called with the lock held.
+    void release(Job * job);
+
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE jobAdded;
+    CONDITION_VARIABLE jobReleased;
+
+    std::vector<Job *> jobs;
+    std::vector<HANDLE> workers;
+
+    bool stop;
+};
+
+#endif
@@ -3,13 +3,16 @@ namespace Asset
 open System
 open System.Collections.Generic
 open System.IO
+open System.Runtime.InteropServices
 open System.Threading
 
 // asset loaders
 type LoaderMap = IDictionary<string, string -> Loader -> obj>
 
-// asset loader
-and Loader(database: Database, loaders: LoaderMap) =
+// asset loader; packs are searched in order before the file system, unless the file is newer than the pack
+and Loader(database: Database, loaders: LoaderMap, ?packs: Pack array) =
+    let packs = defaultArg packs [||]
+
     // background loading agent
     let agent =
         MailboxProcessor.Start(fun inbox ->
@@ -38,6 +41,22 @@ and Loader(database: Database, loaders: LoaderMap) =
         | _ ->
             protectOp path data (fun () -> failwithf "Unknown asset type %s" ext)
 
+    // invoke the function with asset file data in native memory; the data is only valid during the call
+    // files that are newer than a pack (i.e. rebuilt after the pack was written) take precedence over its entries
+    member this.Read(path: string, f: nativeint -> int -> 'T) =
+        let timestamp = File.GetLastWriteTimeUtc(path)
+
+        match packs |> Array.tryPick (fun p -> if p.Timestamp >= timestamp then p.TryRead(path, f) else None) with
+        | Some result -> result
+        | None ->
+            let data = File.ReadAllBytes(path)
+            let gch = GCHandle.Alloc(data, GCHandleType.Pinned)
+
+            try
+                f (gch.AddrOfPinnedObject()) data.Length
+            finally
+                gch.Free()
+
     // load asset data by path
     member internal this.LoadDataAsync path =
         let mutable data = null
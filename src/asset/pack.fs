@@ -0,0 +1,148 @@
+namespace Asset
+
+open System
+open System.IO
+open System.IO.MemoryMappedFiles
+open System.Runtime.InteropServices
+open System.Text
+
+open Microsoft.FSharp.NativeInterop
+
+#nowarn "9" // Uses of this construct may result in the generation of unverifiable .NET IL code
+
+// asset pack file; consists of a header (magic, version, entry count), an index sorted by path hash and entry data
+// index entries are (path hash, data offset, stored size, size); entries are snappy-compressed unless compression does
+// not reduce the size, in which case the stored size is equal to the size
+// paths are relative to the build root; the packer rejects hash collisions, so paths are not stored
+type Pack(path: string) =
+    static let magic = 0x4b415046 // FPAK
+    static let version = 1
+    static let headerSize = 16
+    static let entrySize = 24
+
+    let file = MemoryMappedFile.CreateFromFile(path, FileMode.Open, null, 0L, MemoryMappedFileAccess.Read)
+    let view = file.CreateViewAccessor(0L, 0L, MemoryMappedFileAccess.Read)
+    let fileSize = FileInfo(path).Length
+    let timestamp = File.GetLastWriteTimeUtc(path)
+
+    // get view pointer; it stays valid until the pack is disposed
+    let data =
+        let mutable ptr = NativePtr.ofNativeInt 0n
+        view.SafeMemoryMappedViewHandle.AcquirePointer(&ptr)
+        NativePtr.toNativeInt ptr + nativeint view.PointerOffset
+
+    // validate header
+    let count =
+        if fileSize < int64 headerSize || Marshal.ReadInt32(data) <> magic || Marshal.ReadInt32(data, 4) <> version then failwithf "Invalid pack file %s" path
+
+        let count = Marshal.ReadInt32(data, 8)
+        if count < 0 || int64 headerSize + int64 count * int64 entrySize > fileSize then failwithf "Invalid pack file %s" path
+
+        count
+
+    // read index entry
+    let entry index =
+        let offset = headerSize + index * entrySize
+        uint64 (Marshal.ReadInt64(data, offset)), Marshal.ReadInt64(data, offset + 8), Marshal.ReadInt32(data, offset + 16), Marshal.ReadInt32(data, offset + 20)
+
+    // find entry by path hash
+    let find name =
+        let hash = Pack.Hash name
+
+        let rec search low high =
+            if low >= high then None
+            else
+                let mid = low + (high - low) / 2
+                let h, offset, csize, size = entry mid
+
+                if h = hash then Some (offset, csize, size)
+                elif h < hash then search (mid + 1) high
+                else search low mid
+
+        match search 0 count with
+        | Some (offset, csize, size) as e when offset >= 0L && csize >= 0 && size >= 0 && offset + int64 csize <= fileSize -> e
+        | Some _ -> failwithf "Invalid pack file %s" path
+        | None -> None
+
+    // normalize path so that it matches build node ids
+    static member private Normalize (path: string) =
+        let result = path.Replace('\\', '/').ToLowerInvariant()
+        if result.StartsWith("./") then result.Substring(2) else result
+
+    // get path hash (64-bit FNV-1a of the normalized path)
+    static member Hash path =
+        Encoding.UTF8.GetBytes(Pack.Normalize path) |> Array.fold (fun h b -> (h ^^^ uint64 b) * 1099511628211UL) 14695981039346656037UL
+
+    // write pack file with the specified (path, source file) entries
+    static member Write(path, entries: (string * string) array) =
+        // sort entries by hash and reject collisions; equal paths are collisions too
+        let sorted = entries |> Array.map (fun (key, source) -> Pack.Hash key, key, source) |> Array.sortBy (fun (h, _, _) -> h)
+
+        for i in 1 .. sorted.Length - 1 do
+            let (h0, key0, _), (h1, key1, _) = sorted.[i - 1], sorted.[i]
+            if h0 = h1 then failwithf "Pack path hash collision: %s and %s" key0 key1
+
+        use file = File.Create(path)
+        use writer = new BinaryWriter(file)
+
+        writer.Write(magic)
+        writer.Write(version)
+        writer.Write(sorted.Length)
+        writer.Write(0)
+
+        // reserve index space
+        writer.Write(Array.zeroCreate<byte> (sorted.Length * entrySize))
+
+        // write entry data
+        let index =
+            sorted |> Array.map (fun (hash, _, source) ->
+                let data = File.ReadAllBytes(source)
+                let compressed = Core.Compression.compress data
+                let stored = if compressed.Length < data.Length then compressed else data
+                let offset = file.Position
+
+                writer.Write(stored)
+                hash, offset, stored.Length, data.Length)
+
+        // write index
+        file.Position <- int64 headerSize
+
+        for (hash, offset, csize, size) in index do
+            writer.Write(hash)
+            writer.Write(offset)
+            writer.Write(csize)
+            writer.Write(size)
+
+    // pack file path
+    member this.Path = path
+
+    // pack file modification time (UTC)
+    member this.Timestamp = timestamp
+
+    // entry count
+    member this.Count = count
+
+    // check if the pack has the entry
+    member this.Contains name = (find name).IsSome
+
+    // invoke the function with entry data in native memory and return the result, or return None if the entry is not
+    // found; uncompressed entries are passed directly from the mapped view, so the data is only valid during the call
+    member this.TryRead(name, f: nativeint -> int -> 'T) =
+        match find name with
+        | Some (offset, csize, size) when csize = size ->
+            Some (f (data + nativeint offset) size)
+        | Some (offset, csize, size) ->
+            let memory = Marshal.AllocHGlobal(max 1 size)
+
+            try
+                if Core.Compression.decompressTo (data + nativeint offset) csize memory size <> size then failwithf "Invalid pack file %s" path
+                Some (f memory size)
+            finally
+                Marshal.FreeHGlobal(memory)
+        | None -> None
+
+    interface IDisposable with
+        override this.Dispose() =
+            view.SafeMemoryMappedViewHandle.ReleasePointer()
+            view.Dispose()
+            file.Dispose()
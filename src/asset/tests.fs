@@ -0,0 +1,87 @@
+module Asset.Tests
+
+open System
+open System.IO
+open System.Runtime.InteropServices
+
+// run the function with a pack that contains the specified (path, data) entries
+let private withPack (entries: (string * byte array) array) f =
+    let folder = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString("N"))
+    Directory.CreateDirectory(folder) |> ignore
+
+    try
+        let files = entries |> Array.mapi (fun i (key, data) ->
+            let file = Path.Combine(folder, string i)
+            File.WriteAllBytes(file, data)
+            key, file)
+
+        let path = Path.Combine(folder, "test.pack")
+        Pack.Write(path, files)
+
+        use pack = new Pack(path)
+        f pack
+    finally
+        Directory.Delete(folder, true)
+
+// read entry data from pack
+let private read (pack: Pack) path =
+    pack.TryRead(path, fun data size ->
+        let result: byte array = Array.zeroCreate size
+        Marshal.Copy(data, result, 0, size)
+        result)
+
+let testPackRoundtrip () =
+    let random = Random(42)
+    let entries =
+        [| for i in 0 .. 99 ->
+            let data = if i % 2 = 0 then Array.create (i * 100) (byte i) else Array.init (i * 100) (fun _ -> byte (random.Next(256)))
+            sprintf ".build/art/mesh%d.mesh" i, data |]
+
+    withPack entries (fun pack ->
+        assert (pack.Count = entries.Length)
+
+        for (key, data) in entries do
+            assert (read pack key = Some data)
+
+        // lookup normalizes path separators and case
+        assert (read pack @".\.BUILD\art\mesh5.mesh" = Some (snd entries.[5]))
+        assert (read pack ".build/art/missing.mesh" = None)
+        assert (not (pack.Contains "mesh5.mesh")))
+
+let testPackEmpty () =
+    withPack [||] (fun pack ->
+        assert (pack.Count = 0)
+        assert (read pack "foo" = None))
+
+let testPackDuplicates () =
+    // paths that only differ in case map to the same entry
+    let failed =
+        try
+            withPack [| "foo", [|1uy|]; "FOO", [|2uy|] |] ignore
+            false
+        with e -> true
+
+    assert failed
+
+let testLoaderReadsNewerFiles () =
+    let folder = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString("N"))
+    let file = Path.Combine(folder, "asset.mesh")
+    Directory.CreateDirectory(folder) |> ignore
+
+    try
+        withPack [| file, [|1uy|] |] (fun pack ->
+            let loader = Loader(Database(), dict [], [| pack |])
+            let read path = loader.Read(path, fun data size -> Marshal.ReadByte(data))
+
+            // pack entry is used if there is no file or the file is older than the pack
+            assert (read file = 1uy)
+
+            File.WriteAllBytes(file, [|2uy|])
+            File.SetLastWriteTimeUtc(file, pack.Timestamp.AddMinutes(-1.0))
+            assert (read file = 1uy)
+
+            // file that was rebuilt after the pack replaces the entry
+            File.SetLastWriteTimeUtc(file, pack.Timestamp.AddMinutes(1.0))
+            assert (read file = 2uy))
+    finally
+        Directory.Delete(folder, true)
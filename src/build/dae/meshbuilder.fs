@@ -97,22 +97,24 @@ let private mergeMeshBounds (bounds: Render.MeshBoundsInfo array array) =
 
         Render.MeshBoundsInfo(bone, box))
 
-// build packed & optimized meshes from document
-let private buildPackedMeshes (doc: Document) conv skeleton =
-    // use a constant FVF for now
-    let fvf = [|Position; Tangent; Bitangent; Normal; TexCoord 0; SkinningInfo 4|]
-    let format = Render.VertexFormat.Pos_TBN_Tex1_Bone4_Packed
+// use a constant FVF for now
+let private fvf = [|Position; Tangent; Bitangent; Normal; TexCoord 0; SkinningInfo 4|]
+let private format = Render.VertexFormat.Pos_TBN_Tex1_Bone4_Packed
 
+// build fat meshes for all instances from document
+let private buildFatMeshes (doc: Document) conv skeleton =
     // get all instance nodes
     let instances = doc.Root.Select("/COLLADA/library_visual_scenes//node/instance_geometry | /COLLADA/library_visual_scenes//node/instance_controller")
 
     // get all meshes
-    let fatMeshes = instances |> Array.collect (fun i ->
+    instances |> Array.collect (fun i ->
         FatMeshBuilder.build doc conv i fvf skeleton
         |> Array.map (fun (mesh, material) -> i, mesh, material))
 
+// build packed & optimized meshes from document
+let private buildPackedMeshes (doc: Document) conv skeleton =
     // build packed & optimized meshes
-    fatMeshes
+    buildFatMeshes doc conv skeleton
     |> Array.map (fun (inst, mesh, material) ->
         inst, buildOptimizedMesh mesh format, material, buildMeshBounds mesh)
 
@@ -185,6 +187,17 @@ let private build source target =
     // return texture list
     allTextures.Pairs |> Seq.map (fun p -> p.Value)
 
+// get packed meshes from .dae file before Post/Pre T&L optimization, with vertex positions; used to benchmark the
+// optimizers on art
+let loadPackedMeshes path =
+    let doc = Document(path)
+    let conv = BasisConverter(doc)
+    let skeleton = SkeletonBuilder.build doc conv
+
+    buildFatMeshes doc conv skeleton |> Array.map (fun (_, fatMesh, _) ->
+        let mesh, vertexRemap = MeshPacker.pack fatMesh format
+        mesh, vertexRemap |> Array.map (fun v -> fatMesh.vertices.[v].position))
+
 // .dae -> .mesh builder object
 let builder = { new Builder("Mesh") with
     // build mesh
@@ -0,0 +1,63 @@
+module Build.Geometry.Benchmarks
+
+open Build.Geometry
+
+// noisy sphere with the triangles in random order, like the output of a scanner
+let private scan segments =
+    let random = System.Random(42)
+    let rings = segments / 2
+
+    let positions =
+        Array.init ((rings + 1) * segments) (fun i ->
+            let theta, phi = float32 (i / segments) / float32 rings * float32 System.Math.PI, float32 (i % segments) / float32 segments * 2.f * float32 System.Math.PI
+            let radius = 1.f + float32 (random.NextDouble()) * 0.01f
+            Vector3(sin theta * cos phi, cos theta, sin theta * sin phi) * radius)
+
+    let vertex ring segment = ring * segments + segment % segments
+
+    let indices =
+        Array.init (rings * segments) (fun i ->
+            let r, s = i / segments, i % segments
+            [| [| vertex r s; vertex r (s + 1); vertex (r + 1) s |]; [| vertex r (s + 1); vertex (r + 1) (s + 1); vertex (r + 1) s |] |])
+        |> Array.concat
+        |> Array.sortBy (fun _ -> random.Next())
+        |> Array.concat
+
+    indices, positions
+
+// Post T&L optimizers on the meshes from art/ and on synthetic scans; ACMR and ATVR are for a 16-entry FIFO cache,
+// which is what the optimizers target in the mesh builder (ATVR 1 is optimal); the F# linear optimizer is quadratic
+// on meshes with many dead ends, so it's skipped on large meshes
+let benchmarkPostTLOptimizers () =
+    let art =
+        if System.IO.Directory.Exists "art" then
+            BuildSystem.Node.Glob "art/**.dae"
+            |> Array.collect (fun node ->
+                Build.Dae.MeshBuilder.loadPackedMeshes node.Path
+                |> Array.mapi (fun i (mesh, positions) -> sprintf "%s#%d" node.Path i, mesh.indices, positions))
+        else
+            [||]
+
+    let scans = [| for segments in [256; 1024; 2048] -> let indices, positions = scan segments in sprintf "scan %d" segments, indices, positions |]
+
+    let optimizers: (string * (int array -> Vector3 array -> int array) * int) array =
+        Array.append
+            [| "input", (fun indices _ -> indices), System.Int32.MaxValue
+               "tipsify", (fun indices _ -> PostTLOptimizerTipsify.optimize indices 16), System.Int32.MaxValue
+               "linear", (fun indices _ -> PostTLOptimizerLinear.optimize indices), 100000 |]
+            (if MeshOptimizer.isSupported.Value then
+                [| "native", (fun indices _ -> MeshOptimizer.optimizeVertexCache indices 16), System.Int32.MaxValue
+                   "native fifo", (fun indices _ -> MeshOptimizer.optimizeVertexCacheFifo indices 16), System.Int32.MaxValue
+                   "native overdraw", (fun indices positions -> MeshOptimizer.optimizeOverdraw indices positions 16 0.05f), System.Int32.MaxValue |]
+             else [||])
+
+    printfn "%-40s %10s %-16s %12s %8s %8s" "mesh" "triangles" "optimizer" "ms" "ACMR" "ATVR"
+
+    for name, indices, positions in Array.append art scans do
+        for optimizer, optimize, limit in optimizers do
+            if indices.Length / 3 <= limit then
+                let result = optimize indices positions
+                let time = Core.Test.measure (fun () -> optimize indices positions)
+                let analysis = PostTLAnalyzer.analyzeFIFO result 16
+
+                printfn "%-40s %10d %-16s %12.2f %8.3f %8.3f" name (indices.Length / 3) optimizer time analysis.acmr analysis.atvr
@@ -0,0 +1,71 @@
+module Build.Geometry.MeshOptimizer
+
+open System.Runtime.InteropServices
+
+[<DllImport("meshopt", CallingConvention = CallingConvention.Cdecl)>]
+extern int private meshoptOptimizeVertexCache([<Out>] int[] destination, int[] indices, int indexCount, int vertexCount, int cacheSize, [<Out>] int[] clusters)
+
+[<DllImport("meshopt", CallingConvention = CallingConvention.Cdecl)>]
+extern int private meshoptOptimizeVertexCacheFifo([<Out>] int[] destination, int[] indices, int indexCount, int vertexCount, int cacheSize, [<Out>] int[] clusters)
+
+[<DllImport("meshopt", CallingConvention = CallingConvention.Cdecl)>]
+extern void private meshoptOptimizeOverdraw([<Out>] int[] destination, int[] indices, int indexCount, Vector3[] positions, int positionStride, int vertexCount, int[] clusters, int clusterCount, int cacheSize, float32 threshold)
+
+[<DllImport("meshopt", CallingConvention = CallingConvention.Cdecl)>]
+extern int private meshoptOptimizeVertexFetch([<Out>] byte[] destination, [<In; Out>] int[] indices, int indexCount, byte[] vertices, int vertexCount, int vertexSize)
+
+// meshopt.dll is built by sdks/meshopt/build.bat and is not part of the tree, so the native optimizers may be missing
+let isSupported =
+    lazy (
+        let exports = System.Reflection.Assembly.GetExecutingAssembly().GetType("Build.Geometry.MeshOptimizer")
+
+        try
+            for name in [| "meshoptOptimizeVertexCache"; "meshoptOptimizeVertexCacheFifo"; "meshoptOptimizeOverdraw"; "meshoptOptimizeVertexFetch" |] do
+                Marshal.Prelink(exports.GetMethod(name, System.Reflection.BindingFlags.Static ||| System.Reflection.BindingFlags.NonPublic))
+            true
+        with
+        | :? System.DllNotFoundException
+        | :? System.EntryPointNotFoundException -> false)
+
+// get vertex count referenced by index list
+let private getVertexCount (indices: int array) =
+    if indices.Length = 0 then 0 else 1 + Array.max indices
+
+// run native Post T&L optimizer, return indices and the first triangle of each cluster
+let private optimizeClusters optimizer (indices: int array) vertexCount cacheSize =
+    let result = Array.zeroCreate indices.Length
+    let clusters = Array.zeroCreate (indices.Length / 3)
+
+    let count = optimizer(result, indices, indices.Length, vertexCount, cacheSize, clusters)
+
+    result, Array.sub clusters 0 count
+
+// optimize indices for Post T&L cache with linear-speed vertex cache optimization algorithm (LRU cache model); cache
+// size is 3..32
+let optimizeVertexCache indices cacheSize =
+    optimizeClusters meshoptOptimizeVertexCache indices (getVertexCount indices) cacheSize |> fst
+
+// optimize indices for FIFO Post T&L cache of specified size with Tipsify algorithm
+let optimizeVertexCacheFifo indices cacheSize =
+    optimizeClusters meshoptOptimizeVertexCacheFifo indices (getVertexCount indices) cacheSize |> fst
+
+// optimize indices for Post T&L cache with overdraw-aware cluster reordering (with no more than specified ACMR penalty)
+let optimizeOverdraw indices (positions: Vector3 array) cacheSize acmrThreshold =
+    let vertexCount = getVertexCount indices
+    assert (positions.Length >= vertexCount)
+
+    let optimized, clusters = optimizeClusters meshoptOptimizeVertexCacheFifo indices vertexCount cacheSize
+    let result = Array.zeroCreate indices.Length
+
+    meshoptOptimizeOverdraw(result, optimized, optimized.Length, positions, sizeof<Vector3>, vertexCount, clusters, clusters.Length, cacheSize, acmrThreshold)
+
+    result
+
+// optimize vertices and indices for Pre T&L cache efficiency; vertices that are not referenced are removed
+let optimizeVertexFetch (vertices: byte array) (indices: int array) vertexSize =
+    let remappedVertices = Array.zeroCreate vertices.Length
+    let remappedIndices = Array.copy indices
+
+    let vertexCount = meshoptOptimizeVertexFetch(remappedVertices, remappedIndices, remappedIndices.Length, vertices, vertices.Length / vertexSize, vertexSize)
+
+    Array.sub remappedVertices 0 (vertexCount * vertexSize), remappedIndices
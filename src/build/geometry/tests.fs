@@ -0,0 +1,101 @@
+module Build.GeometryTests
+
+open Build.Geometry
+
+// wavy grid mesh with size x size quads; triangles are shuffled, like in scanned meshes
+let private grid size =
+    let random = System.Random(42)
+    let vertex x y = y * (size + 1) + x
+
+    let triangles =
+        Array.init (size * size) (fun i ->
+            let x, y = i % size, i / size
+            [| [| vertex x y; vertex (x + 1) y; vertex x (y + 1) |]; [| vertex (x + 1) y; vertex (x + 1) (y + 1); vertex x (y + 1) |] |])
+        |> Array.concat
+        |> Array.sortBy (fun _ -> random.Next())
+
+    let positions = Array.init ((size + 1) * (size + 1)) (fun i ->
+        let x, y = float32 (i % (size + 1)), float32 (i / (size + 1))
+        Vector3(x, y, 3.f * sin (x * 0.3f) * cos (y * 0.2f)))
+
+    Array.concat triangles, positions
+
+// get sorted triangle list with the winding preserved
+let private getTriangles (indices: int array) =
+    Array.init (indices.Length / 3) (fun i ->
+        let t = Array.sub indices (i * 3) 3
+        let first = Array.findIndex ((=) (Array.min t)) t
+        t.[first], t.[(first + 1) % 3], t.[(first + 2) % 3])
+    |> Array.sort
+
+// native optimizer tests need meshopt.dll, which is not part of the tree (see MeshOptimizer.isSupported)
+let testVertexCache () =
+    if MeshOptimizer.isSupported.Value then
+        let indices, _ = grid 64
+        let result = MeshOptimizer.optimizeVertexCache indices 16
+
+        // triangles are reordered, not changed
+        assert (getTriangles result = getTriangles indices)
+
+        // the result is close to the optimal 0.5 ACMR of a regular grid
+        let acmr = (PostTLAnalyzer.analyzeFIFO result 16).acmr
+
+        assert (acmr < 0.75)
+        assert (acmr < (PostTLAnalyzer.analyzeFIFO indices 16).acmr / 2.0)
+
+let testVertexCacheFifo () =
+    if MeshOptimizer.isSupported.Value then
+        let indices, _ = grid 64
+
+        // native Tipsify makes the same choices as the F# version
+        assert (MeshOptimizer.optimizeVertexCacheFifo indices 16 = PostTLOptimizerTipsify.optimize indices 16)
+
+let testUnreferencedVertex () =
+    if MeshOptimizer.isSupported.Value then
+        // vertex 0 is not referenced, so the optimizer can't start from it; the first cluster used to be empty, which
+        // produced more clusters than triangles
+        let indices = [| 1; 2; 3; 4; 5; 6 |]
+        let positions = Array.init 7 (fun i -> Vector3(float32 i, float32 (i * i % 7), float32 (i % 2)))
+
+        let result = MeshOptimizer.optimizeVertexCacheFifo indices 16
+
+        assert (result = PostTLOptimizerTipsify.optimize indices 16)
+        assert (getTriangles (MeshOptimizer.optimizeOverdraw indices positions 16 0.f) = getTriangles indices)
+        assert (getTriangles (MeshOptimizer.optimizeOverdraw indices positions 16 0.05f) = getTriangles indices)
+
+let testOverdraw () =
+    if MeshOptimizer.isSupported.Value then
+        let indices, positions = grid 64
+
+        let acmr = (PostTLAnalyzer.analyzeFIFO (MeshOptimizer.optimizeVertexCacheFifo indices 16) 16).acmr
+
+        // clusters are only split at the points where ACMR from a cold cache is within the threshold, so reordering them
+        // costs about as much
+        let result = MeshOptimizer.optimizeOverdraw indices positions 16 0.05f
+
+        assert (getTriangles result = getTriangles indices)
+        assert ((PostTLAnalyzer.analyzeFIFO result 16).acmr < acmr * 1.1)
+
+        // hard boundaries are dead ends, where the cache has nothing to reuse
+        let hard = MeshOptimizer.optimizeOverdraw indices positions 16 0.f
+
+        assert (getTriangles hard = getTriangles indices)
+        assert ((PostTLAnalyzer.analyzeFIFO hard 16).acmr < acmr * 1.02)
+
+let testVertexFetch () =
+    if MeshOptimizer.isSupported.Value then
+        let vertexSize = 8
+        let vertices = Array.init (5 * vertexSize) byte
+        let indices = [| 3; 1; 4; 1; 3; 0 |]
+
+        let remappedVertices, remappedIndices = MeshOptimizer.optimizeVertexFetch vertices indices vertexSize
+
+        // vertices are in the order of first use, unused vertex 2 is removed
+        assert (remappedIndices = [| 0; 1; 2; 1; 0; 3 |])
+        assert (remappedVertices.Length = 4 * vertexSize)
+
+        for i in 0 .. indices.Length - 1 do
+            assert (Array.sub remappedVertices (remappedIndices.[i] * vertexSize) vertexSize = Array.sub vertices (indices.[i] * vertexSize) vertexSize)
+
+        // indices are not modified
+        assert (indices = [| 3; 1; 4; 1; 3; 0 |])
@@ -0,0 +1,9 @@
+module Build.Pack
+
+open BuildSystem
+
+// pack builder object; entries are keyed by source node ids, which are build root-relative paths
+let builder = ActionBuilder("Pack", fun task ->
+    let entries = task.Sources |> Array.map (fun n -> n.Uid, n.Path)
+
+    Asset.Pack.Write(task.Targets.[0].Path, entries))
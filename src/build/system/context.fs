@@ -6,7 +6,7 @@ open System.Diagnostics
 open System.IO
 
 // build context
-type Context(rootPath, buildPath, ?jobs) =
+type Context(rootPath, buildPath, ?jobs, ?cache) =
     static let mutable current: Context option = None
 
     // setup node root so that DB paths are stable
@@ -16,9 +16,18 @@ type Context(rootPath, buildPath, ?jobs) =
     let scheduler = TaskScheduler(db)
     let jobs = defaultArg jobs Environment.ProcessorCount
 
+    // build results are shared between all working copies of the current user by default
+    let cache = defaultArg cache (ResultCache(Path.Combine(Environment.GetFolderPath(Environment.SpecialFolder.LocalApplicationData), "fungine/cache"), 4L <<< 30))
+
     // get build path
     member this.BuildPath = buildPath
 
+    // get result cache
+    member this.Cache = cache
+
+    // get content signature of the node
+    member this.ContentSignature node = db.ContentSignature node
+
     // get target
     member this.Target (source: Node) ext =
         if Path.IsPathRooted(source.Path) || source.Path.StartsWith("../") then failwithf "Out-of-source paths are not supported: %s" source.Path
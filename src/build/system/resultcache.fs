@@ -0,0 +1,96 @@
+namespace BuildSystem
+
+open System
+open System.IO
+open System.Threading
+
+// content-addressed store of build results; entries are files named by the signature of everything that affects
+// the result (source contents, build options, tool version)
+// the store can be shared by concurrent builds: entries are written to a temporary file and renamed into place, and
+// readers treat entries that disappear because of eviction as misses
+type ResultCache(path: string, maxSize: int64) =
+    // temporary files that are older than this are leftovers from interrupted builds
+    static let staleTime = TimeSpan.FromHours(1.0)
+
+    // approximate total size of the cache entries; computed on first use
+    let mutable size = -1L
+    let trimLock = obj()
+
+    // get entry path; entries are spread across subfolders to keep folder sizes manageable
+    let entryPath (key: Signature) =
+        let name = key.ToString()
+        Path.Combine(path, name.Substring(0, 2), name)
+
+    // remove least recently used entries until the cache fits in the size limit
+    let trim () =
+        lock trimLock (fun _ ->
+            let now = DateTime.UtcNow
+            let files = if Directory.Exists(path) then DirectoryInfo(path).GetFiles("*", SearchOption.AllDirectories) else [||]
+            let temps, entries = files |> Array.partition (fun f -> f.Extension = ".tmp")
+
+            // remove temporary files from interrupted builds
+            for f in temps do
+                if now - f.LastWriteTimeUtc > staleTime then
+                    try f.Delete() with _ -> ()
+
+            // remove entries in LRU order; trim a bit more than necessary so that next insertions do not trigger a trim
+            let mutable total = entries |> Array.sumBy (fun f -> f.Length)
+
+            for f in entries |> Array.sortBy (fun f -> f.LastWriteTimeUtc) do
+                if total > maxSize / 10L * 9L then
+                    let length = f.Length
+
+                    try
+                        f.Delete()
+                        total <- total - length
+                    with _ -> ()
+
+            size <- total)
+
+    // get cache path
+    member this.Path = path
+
+    // copy the result with the specified key to target; returns false on a cache miss
+    member this.TryGet(key: Signature, target: string) =
+        let entry = entryPath key
+
+        try
+            File.Copy(entry, target, true)
+
+            // update the access time for LRU eviction; last access time is not reliably updated by the file system
+            try File.SetLastWriteTimeUtc(entry, DateTime.UtcNow) with _ -> ()
+
+            true
+        with
+        | :? FileNotFoundException
+        | :? DirectoryNotFoundException -> false
+        | :? IOException
+        | :? UnauthorizedAccessException ->
+            // entry is being evicted by another build
+            false
+
+    // store the result with the specified key
+    member this.Put(key: Signature, source: string) =
+        let entry = entryPath key
+        let temp = sprintf "%s.%s.tmp" entry (Guid.NewGuid().ToString("N"))
+
+        // compute the initial cache size before adding anything to it
+        if size < 0L then trim ()
+
+        Directory.CreateDirectory(Path.GetDirectoryName(entry)) |> ignore
+        File.Copy(source, temp)
+
+        // copy preserves the source time, but the entry has to count as recently used
+        File.SetLastWriteTimeUtc(temp, DateTime.UtcNow)
+
+        // the entry might have been added by another worker; since the entries are content-addressed, keep either one
+        let added =
+            try
+                File.Move(temp, entry)
+                true
+            with _ ->
+                try File.Delete(temp) with _ -> ()
+                false
+
+        // account for the new entry; rescan the cache if it might be over the limit
+        if added && Interlocked.Add(&size, FileInfo(source).Length) > maxSize then trim ()
@@ -0,0 +1,59 @@
+module BuildSystem.Tests
+
+open System
+open System.IO
+
+open BuildSystem
+
+// run the function with a temporary folder that is removed afterwards
+let private withFolder f =
+    let path = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString("N"))
+    Directory.CreateDirectory(path) |> ignore
+
+    try
+        f path
+    finally
+        Directory.Delete(path, true)
+
+// write file with the specified size and return its path
+let private writeFile folder name size =
+    let path = Path.Combine(folder, name)
+    File.WriteAllBytes(path, Array.create size (byte name.[0]))
+    path
+
+let testResultCacheRoundtrip () =
+    withFolder (fun folder ->
+        let cache = ResultCache(Path.Combine(folder, "cache"), 1L <<< 20)
+        let key = Signature.FromString "a"
+        let target = Path.Combine(folder, "target")
+
+        let miss = cache.TryGet(key, target)
+        assert (not miss && not (File.Exists target))
+
+        cache.Put(key, writeFile folder "a" 100)
+
+        // second put of the same entry is a no-op
+        cache.Put(key, writeFile folder "a" 100)
+
+        let hit = cache.TryGet(key, target)
+        assert (hit && File.ReadAllBytes target = Array.create 100 (byte 'a')))
+
+let testResultCacheEviction () =
+    withFolder (fun folder ->
+        let cache = ResultCache(Path.Combine(folder, "cache"), 1000L)
+        let target = Path.Combine(folder, "target")
+
+        // use entries in order a, b, c, then access a so that b becomes least recently used
+        for name in ["a"; "b"; "c"] do
+            cache.Put(Signature.FromString name, writeFile folder name 300)
+            Threading.Thread.Sleep(20)
+
+        let hit = cache.TryGet(Signature.FromString "a", target)
+        assert hit
+
+        // adding d exceeds the limit, so b has to go
+        Threading.Thread.Sleep(20)
+        cache.Put(Signature.FromString "d", writeFile folder "d" 300)
+
+        let present = ["a"; "b"; "c"; "d"] |> List.filter (fun name -> cache.TryGet(Signature.FromString name, target))
+        assert (present = ["a"; "c"; "d"]))
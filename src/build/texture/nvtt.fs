@@ -44,8 +44,14 @@ type AlphaMode =
     | Transparency = 1
     | Premultiplied = 2
 
+type TextureType =
+    | Texture2D = 0
+    | Cube = 1
+
 type NvttInputOptions = nativeint
 type NvttCompressionOptions = nativeint
+type NvttOutputOptions = nativeint
+type NvttCompressor = nativeint
 
 [<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
 extern NvttInputOptions nvttCreateInputOptions()
@@ -53,6 +59,12 @@ extern NvttInputOptions nvttCreateInputOptions()
 [<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
 extern void nvttDestroyInputOptions(NvttInputOptions)
 
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern void nvttSetInputOptionsTextureLayout(NvttInputOptions, TextureType textureType, int w, int h, int d)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern bool nvttSetInputOptionsMipmapData(NvttInputOptions, nativeint data, int w, int h, int d, int face, int mipmap)
+
 [<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
 extern void nvttSetInputOptionsAlphaMode(NvttInputOptions, AlphaMode alphaMode)
 
@@ -113,7 +125,61 @@ extern void nvttSetCompressionOptionsPixelFormat(NvttCompressionOptions, uint32
 [<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
 extern void nvttSetCompressionOptionsQuantization(NvttCompressionOptions, bool colorDithering, bool alphaDithering, bool binaryAlpha, int alphaThreshold)
 
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern NvttOutputOptions nvttCreateOutputOptions()
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern void nvttDestroyOutputOptions(NvttOutputOptions)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern void nvttSetOutputOptionsFileName(NvttOutputOptions, string fileName)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern NvttCompressor nvttCreateCompressor()
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern void nvttDestroyCompressor(NvttCompressor)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern bool nvttCompress(NvttCompressor, NvttInputOptions inputOptions, NvttCompressionOptions compressionOptions, NvttOutputOptions outputOptions)
+
 type NvttErrorCallback = delegate of string -> unit
 
 [<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
-extern bool nvttCompressFile(string source, string target, NvttInputOptions inputOptions, NvttCompressionOptions compressionOptions, NvttErrorCallback errorCallback)
\ No newline at end of file
+extern bool nvttCompressFile(string source, string target, NvttInputOptions inputOptions, NvttCompressionOptions compressionOptions, NvttErrorCallback errorCallback)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern bool nvttCompressFileEx(string source, string target, NvttInputOptions inputOptions, NvttCompressionOptions compressionOptions, bool fast, NvttErrorCallback errorCallback)
+
+type NvttOutputCallback = delegate of nativeint * int -> bool
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern bool nvttCompressBuffer(byte[] data, uint32 size, string extension, NvttInputOptions inputOptions, NvttCompressionOptions compressionOptions, bool fast, NvttOutputCallback outputCallback, NvttErrorCallback errorCallback)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern bool nvttCompressImage(byte[] pixels, int width, int height, NvttInputOptions inputOptions, NvttCompressionOptions compressionOptions, bool fast, NvttOutputCallback outputCallback, NvttErrorCallback errorCallback)
+
+[<DllImport("nvtt", CallingConvention = CallingConvention.Cdecl)>]
+extern bool nvttFastCompressBlocks(byte[] pixels, int width, int height, Format format, Quality quality, byte[] output, bool simd)
+
+// fast block encoder is only exported by nvtt builds that include it (see sdks/nvtt/fastcompress.cpp)
+let fastCompressionSupported =
+    lazy (
+        let exports = typeof<NvttOutputCallback>.DeclaringType
+
+        try
+            for name in [| "nvttCompressFileEx"; "nvttCompressImage"; "nvttFastCompressBlocks" |] do
+                Marshal.Prelink(exports.GetMethod(name))
+            true
+        with :? System.EntryPointNotFoundException -> false)
+
+// signature of the native library; compressed data depends on the compressor code, so cached results have to be keyed by it
+let librarySignature =
+    lazy (
+        // make sure the library is loaded
+        nvttDestroyInputOptions(nvttCreateInputOptions())
+
+        let modules = System.Diagnostics.Process.GetCurrentProcess().Modules |> Seq.cast<System.Diagnostics.ProcessModule>
+        let library = modules |> Seq.find (fun m -> System.String.Equals(m.ModuleName, "nvtt.dll", System.StringComparison.OrdinalIgnoreCase))
+
+        BuildSystem.Signature.FromFile library.FileName)
\ No newline at end of file
@@ -0,0 +1,152 @@
+module Build.TextureTests
+
+open Build.NvTextureTools
+open Build.Texture
+
+// test image size (pixels)
+let private size = 128
+
+// create 32-bit BGRA image from the function that returns RGBA values for a pixel
+let private image f =
+    let data = Array.zeroCreate (size * size * 4)
+    let clamp v = byte (max 0.0 (min 255.0 v))
+
+    for y in 0 .. size - 1 do
+        for x in 0 .. size - 1 do
+            let (r, g, b, a) = f (float x) (float y)
+            let offset = (y * size + x) * 4
+            data.[offset + 0] <- clamp b
+            data.[offset + 1] <- clamp g
+            data.[offset + 2] <- clamp r
+            data.[offset + 3] <- clamp a
+
+    data
+
+// image corpus that covers typical texture content
+let private corpus =
+    let random = System.Random(42)
+    let tiles = [| 200.0, 30.0, 40.0; 20.0, 180.0, 60.0; 240.0, 240.0, 10.0; 10.0, 10.0, 200.0 |]
+
+    [| "gradient", image (fun x y -> x * 2.0, y * 2.0, x + y, 255.0 - x * 2.0)
+       "noise", image (fun x y -> float (random.Next(256)), float (random.Next(256)), float (random.Next(256)), float (random.Next(256)))
+       "waves", image (fun x y -> 128.0 + 100.0 * sin (x * 0.05) * cos (y * 0.07), 128.0 + 90.0 * sin (x * 0.11 + y * 0.03), 128.0 + 120.0 * cos (x * 0.02 - y * 0.09), 128.0 + 127.0 * sin (x * 0.3))
+       "tiles", image (fun x y ->
+            let index = (int x / 8 + int y / 8) % tiles.Length
+            let (r, g, b) = tiles.[index]
+            r, g, b, float index * 80.0)
+       "normals", image (fun x y ->
+            let dx, dy = cos (x * 0.1) * 0.5, sin (y * 0.13) * 0.5
+            let scale = 127.5 / sqrt (dx * dx + dy * dy + 1.0)
+            127.5 + dx * scale, 127.5 + dy * scale, 127.5 + scale, 255.0) |]
+
+// formats with pixel byte offsets of the channels that they store
+let private formats = [| Format.BC1, [|0; 1; 2|]; Format.BC3, [|0; 1; 2; 3|]; Format.BC4, [|2|]; Format.BC5, [|1; 2|] |]
+
+// quality levels that use fast encoder
+let private qualities = [| Quality.Fastest; Quality.Normal |]
+
+// get block size in bytes
+let private getBlockSize format =
+    match format with
+    | Format.BC1 | Format.BC4 -> 8
+    | _ -> 16
+
+// decode BC1 color block to BGRA pixels
+let private decodeColorBlock (data: byte array) offset (pixels: byte array) =
+    let value index = int data.[offset + index * 2] ||| (int data.[offset + index * 2 + 1] <<< 8)
+    let color index =
+        let c = value index
+        let expand v bits = (v <<< (8 - bits)) ||| (v >>> (2 * bits - 8))
+        [| expand (c &&& 31) 5; expand ((c >>> 5) &&& 63) 6; expand (c >>> 11) 5 |]
+
+    let c0, c1 = color 0, color 1
+    let palette =
+        if value 0 > value 1 then [| c0; c1; Array.map2 (fun a b -> (2 * a + b) / 3) c0 c1; Array.map2 (fun a b -> (a + 2 * b) / 3) c0 c1 |]
+        else [| c0; c1; Array.map2 (fun a b -> (a + b) / 2) c0 c1; [| 0; 0; 0 |] |]
+    let bits = System.BitConverter.ToUInt32(data, offset + 4)
+
+    for i in 0 .. 15 do
+        let entry = palette.[int (bits >>> (2 * i)) &&& 3]
+        for c in 0 .. 2 do pixels.[i * 4 + c] <- byte entry.[c]
+
+// decode BC4 block to the specified channel of BGRA pixels
+let private decodeChannelBlock (data: byte array) offset (pixels: byte array) channel =
+    let a0, a1 = int data.[offset], int data.[offset + 1]
+    let palette =
+        if a0 > a1 then Array.append [| a0; a1 |] (Array.init 6 (fun i -> ((6 - i) * a0 + (i + 1) * a1) / 7))
+        else Array.append [| a0; a1 |] (Array.append (Array.init 4 (fun i -> ((4 - i) * a0 + (i + 1) * a1) / 5)) [| 0; 255 |])
+    let bits = Array.init 6 (fun i -> uint64 data.[offset + 2 + i] <<< (8 * i)) |> Array.reduce (|||)
+
+    for i in 0 .. 15 do
+        pixels.[i * 4 + channel] <- byte palette.[int (bits >>> (3 * i)) &&& 7]
+
+// decode compressed blocks to BGRA image
+let private decode format (data: byte array) offset =
+    let result = Array.zeroCreate (size * size * 4)
+    let pixels = Array.zeroCreate 64
+
+    for by in 0 .. size / 4 - 1 do
+        for bx in 0 .. size / 4 - 1 do
+            let block = offset + (by * (size / 4) + bx) * getBlockSize format
+
+            match format with
+            | Format.BC1 -> decodeColorBlock data block pixels
+            | Format.BC3 -> decodeChannelBlock data block pixels 3; decodeColorBlock data (block + 8) pixels
+            | Format.BC4 -> decodeChannelBlock data block pixels 2
+            | Format.BC5 -> decodeChannelBlock data block pixels 2; decodeChannelBlock data (block + 8) pixels 1
+            | _ -> failwithf "Unsupported format %A" format
+
+            for i in 0 .. 15 do
+                Array.blit pixels (i * 4) result (((by * 4 + i / 4) * size + bx * 4 + i % 4) * 4) 4
+
+    result
+
+// compute peak signal-to-noise ratio for the specified channels
+let private psnr (expected: byte array) (actual: byte array) channels =
+    let error = Array.init (expected.Length / 4) (fun i -> channels |> Array.sumBy (fun c -> let d = float expected.[i * 4 + c] - float actual.[i * 4 + c] in d * d)) |> Array.sum
+    let mse = error / float (expected.Length / 4 * channels.Length)
+
+    if mse = 0.0 then infinity else 10.0 * log10 (255.0 * 255.0 / mse)
+
+// compress image without mipmaps, return DDS data
+let private compress pixels format quality fast =
+    let settings = { new Settings with profile = Some Profile.Generic and quality = Some quality and format = Some format and maxmip = Some 0 and fast = Some fast }
+
+    compressImage pixels size size settings
+
+// fast encoder tests need an nvtt build that exports the encoder
+let private fastCorpus () =
+    if fastCompressionSupported.Value then corpus else [||]
+
+let testSimdMatchesScalar () =
+    for (_, pixels) in fastCorpus () do
+        for (format, _) in formats do
+            for quality in qualities do
+                let simd = Array.zeroCreate (size * size / 16 * getBlockSize format)
+                let scalar = Array.zeroCreate simd.Length
+
+                let scalarResult = nvttFastCompressBlocks(pixels, size, size, format, quality, scalar, false)
+                assert scalarResult
+
+                // SIMD path is not available on old CPUs
+                if nvttFastCompressBlocks(pixels, size, size, format, quality, simd, true) then
+                    assert (simd = scalar)
+
+// fast encoder has to be within 1 dB of nvtt encoders; images that are above 40 dB are good enough regardless
+let testFastQuality () =
+    for (_, pixels) in fastCorpus () do
+        for (format, channels) in formats do
+            for quality in qualities do
+                let reference = compress pixels format quality false
+                let fast = compress pixels format quality true
+
+                // DDS headers have to describe the same texture; compare size, mip count and FourCC
+                assert (fast.Length = reference.Length)
+                assert (Array.sub fast 12 8 = Array.sub reference 12 8)
+                assert (Array.sub fast 28 4 = Array.sub reference 28 4)
+                assert (Array.sub fast 84 4 = Array.sub reference 84 4)
+
+                let referencePsnr = psnr pixels (decode format reference 128) channels
+                let fastPsnr = psnr pixels (decode format fast 128) channels
+
+                assert (fastPsnr >= 40.0 || fastPsnr >= referencePsnr - 1.0)
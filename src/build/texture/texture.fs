@@ -4,6 +4,13 @@ open BuildSystem
 open Build.NvTextureTools
 
 open System.Collections.Generic
+open System.IO
+open System.IO.MemoryMappedFiles
+open System.Runtime.InteropServices
+
+open Microsoft.FSharp.NativeInterop
+
+#nowarn "9" // Uses of this construct may result in the generation of unverifiable .NET IL code
 
 // texture compression profile
 type Profile =
@@ -18,6 +25,7 @@ type Settings =
       mutable quality: Quality option
       mutable format: Format option
       mutable maxmip: int option
+      mutable fast: bool option
     }
 
 // set compression options from texture settings
@@ -60,15 +68,111 @@ type private Handle(handle, dtor) =
     interface System.IDisposable with
         override this.Dispose () = dtor(handle)
 
-// convert the texture with specified options
-let private build source target settings =
+// compress the texture with specified options, return DDS data; run invokes compression with options and callbacks
+let private compressWith settings run =
     use input = new Handle(nvttCreateInputOptions(), nvttDestroyInputOptions)
     use compress = new Handle(nvttCreateCompressionOptions(), nvttDestroyCompressionOptions)
+    use output = new MemoryStream()
     let callback = NvttErrorCallback(fun msg -> Output.echo (msg.Trim()))
 
+    // append compressed data to output
+    let buffer = ref ([||]: byte array)
+    let outputCallback = NvttOutputCallback(fun data size ->
+        if (!buffer).Length < size then buffer := Array.zeroCreate size
+        Marshal.Copy(data, !buffer, 0, size)
+        output.Write(!buffer, 0, size)
+        true)
+
     setupOptions input.Value compress.Value settings
 
-    let result = nvttCompressFile(source, target, input.Value, compress.Value, callback)
+    let result = run input.Value compress.Value outputCallback callback
+    if not result then failwith "compression failed"
+
+    output.ToArray()
+
+// compress raw 32-bit BGRA pixels with specified options, return DDS data; needs an nvtt build with the fast encoder
+let compressImage (pixels: byte array) width height settings =
+    compressWith settings (fun input compress outputCallback callback ->
+        nvttCompressImage(pixels, width, height, input, compress, settings.fast.Value, outputCallback, callback))
+
+// fast block encoder is opt-in; textures that request it use nvtt encoders if the library does not have it
+let private isFast settings =
+    settings.fast.Value && fastCompressionSupported.Value
+
+// get layout (face count, width, height, mipmap count) of DDS data with uncompressed 32-bit BGRA surfaces, which nvtt
+// accepts as is; returns None for other formats and for truncated data
+let private getBGRALayout (data: nativeint) size =
+    let field index = Marshal.ReadInt32(data, index * 4)
+
+    if size < 128L || field 0 <> 0x20534444 || field 1 <> 124 then None
+    else
+        let width, height = field 4, field 3
+        let mipmaps = if field 2 &&& 0x20000 <> 0 then max 1 (field 7) else 1
+
+        // cubemaps have to contain all faces; volume textures are not supported
+        let faces =
+            if field 28 &&& 0x200 <> 0 then (if field 28 &&& 0xfc00 = 0xfc00 then 6 else 0)
+            elif field 28 &&& 0x200000 <> 0 then 0
+            else 1
+
+        // pixel format has to be A8R8G8B8 without FourCC
+        let bgra = field 20 &&& 0x45 = 0x41 && field 22 = 32 && field 23 = 0xff0000 && field 24 = 0xff00 && field 25 = 0xff && field 26 = 0xff000000
+        let surfaces = Seq.init mipmaps (fun m -> int64 (max 1 (width >>> m)) * int64 (max 1 (height >>> m)) * 4L) |> Seq.sum
+
+        if bgra && faces > 0 && width > 0 && height > 0 && 128L + surfaces * int64 faces <= size then Some (faces, width, height, mipmaps)
+        else None
+
+// set input surfaces from the memory-mapped DDS file if it has uncompressed 32-bit BGRA surfaces; nvtt copies the
+// surfaces from the view, so they are not read and decoded into intermediate images first
+let private setupMappedInput input (source: string) =
+    let info = FileInfo(source)
+
+    if not info.Exists || info.Extension.ToLowerInvariant() <> ".dds" || info.Length < 128L then false
+    else
+        use file = MemoryMappedFile.CreateFromFile(source, FileMode.Open, null, 0L, MemoryMappedFileAccess.Read)
+        use view = file.CreateViewAccessor(0L, 0L, MemoryMappedFileAccess.Read)
+
+        let mutable ptr = NativePtr.ofNativeInt 0n
+        view.SafeMemoryMappedViewHandle.AcquirePointer(&ptr)
+
+        try
+            let data = NativePtr.toNativeInt ptr + nativeint view.PointerOffset
+
+            match getBGRALayout data info.Length with
+            | Some (faces, width, height, mipmaps) ->
+                nvttSetInputOptionsTextureLayout(input, (if faces = 6 then TextureType.Cube else TextureType.Texture2D), width, height, 1)
+
+                // surfaces are stored face by face, each face has the full mipmap chain
+                let mutable offset = data + 128n
+
+                for face in 0 .. faces - 1 do
+                    for mipmap in 0 .. mipmaps - 1 do
+                        let w, h = max 1 (width >>> mipmap), max 1 (height >>> mipmap)
+                        if not (nvttSetInputOptionsMipmapData(input, offset, w, h, 1, face, mipmap)) then failwith "compression failed"
+                        offset <- offset + nativeint (w * h * 4)
+
+                true
+            | None -> false
+        finally
+            view.SafeMemoryMappedViewHandle.ReleasePointer()
+
+// compress the texture described by input options to the target file
+let private compressMapped (target: string) input compress =
+    use output = new Handle(nvttCreateOutputOptions(), nvttDestroyOutputOptions)
+    use compressor = new Handle(nvttCreateCompressor(), nvttDestroyCompressor)
+    nvttSetOutputOptionsFileName(output.Value, target)
+    nvttCompress(compressor.Value, input, compress, output.Value)
+
+// convert the texture with specified options
+let private build source target settings =
+    use input = new Handle(nvttCreateInputOptions(), nvttDestroyInputOptions)
+    use compress = new Handle(nvttCreateCompressionOptions(), nvttDestroyCompressionOptions)
+    let callback = NvttErrorCallback(fun msg -> Output.echo (msg.Trim()))
+    setupOptions input.Value compress.Value settings
+    let result =
+        if isFast settings then nvttCompressFileEx(source, target, input.Value, compress.Value, true, callback)
+        elif setupMappedInput input.Value source then compressMapped target input.Value compress.Value
+        else nvttCompressFile(source, target, input.Value, compress.Value, callback)
     if not result then failwith "compression failed"
 
 // texture setting database
@@ -99,19 +203,26 @@ let getSettings path =
         with profile = select (fun s -> s.profile) Profile.Generic
         and quality = select (fun s -> s.quality) Quality.Normal
         and format = select (fun s -> s.format) Format.Unknown
-        and maxmip = select (fun s -> s.maxmip) -1 }
+        and maxmip = select (fun s -> s.maxmip) -1
+        and fast = select (fun s -> s.fast) false }
         
 // texture builder object
 let builder =
     { new Builder("Texture") with
-        // build texture using database-specified settings
+        // build texture using database-specified settings; results are shared via the result cache
         override this.Build task =
-            let settings = getSettings task.Sources.[0].Uid
-            build task.Sources.[0].Path task.Targets.[0].Path settings
+            let source, target = task.Sources.[0], task.Targets.[0]
+            let context = Context.Current
+            let key = Signature.Combine [| context.ContentSignature source; Signature.FromString (this.Version task); librarySignature.Value |]
+
+            if not (context.Cache.TryGet(key, target.Path)) then
+                build source.Path target.Path (getSettings source.Uid)
+                context.Cache.Put(key, target.Path)
+
             None
 
         // version is a combination of static builder version and database-specified settings
         override this.Version task =
             let settings = getSettings task.Sources.[0].Uid
-            System.String.Format("{0}({1},{2},{3},{4})", base.Version task, settings.profile.Value, settings.quality.Value, settings.format.Value, settings.maxmip.Value)
+            System.String.Format("{0}({1},{2},{3},{4},{5})", base.Version task, settings.profile.Value, settings.quality.Value, settings.format.Value, settings.maxmip.Value, isFast settings)
     }
@@ -0,0 +1,730 @@
+module Core.Compression
+
+open System
+open System.Collections.Generic
+open System.IO
+open System.IO.Compression
+open System.Runtime.InteropServices
+
+open Microsoft.FSharp.NativeInterop
+
+#nowarn "9" // Uses of this construct may result in the generation of unverifiable .NET IL code
+
+// snappy.dll binding module
+module private Snappy =
+    [<DllImport("snappy", CallingConvention = CallingConvention.Cdecl)>]
+    extern int snappy_compress(byte[] input, nativeint input_length, byte[] output, nativeint& compressed_length);
+
+    [<DllImport("snappy", CallingConvention = CallingConvention.Cdecl)>]
+    extern int snappy_uncompress(byte[] compressed, nativeint compressed_length, byte[] uncompressed, nativeint& uncompressed_length);
+
+    [<DllImport("snappy", CallingConvention = CallingConvention.Cdecl)>]
+    extern nativeint snappy_max_compressed_length(nativeint source_length);
+
+    [<DllImport("snappy", CallingConvention = CallingConvention.Cdecl)>]
+    extern int snappy_uncompressed_length(byte[] compressed, nativeint compressed_length, nativeint& result);
+
+    // pointer variants for pinned and unmanaged memory
+    [<DllImport("snappy", EntryPoint = "snappy_compress", CallingConvention = CallingConvention.Cdecl)>]
+    extern int snappy_compress_ptr(nativeint input, nativeint input_length, nativeint output, nativeint& compressed_length);
+
+    [<DllImport("snappy", EntryPoint = "snappy_uncompress", CallingConvention = CallingConvention.Cdecl)>]
+    extern int snappy_uncompress_ptr(nativeint compressed, nativeint compressed_length, nativeint uncompressed, nativeint& uncompressed_length);
+
+    [<DllImport("snappy", EntryPoint = "snappy_uncompressed_length", CallingConvention = CallingConvention.Cdecl)>]
+    extern int snappy_uncompressed_length_ptr(nativeint compressed, nativeint compressed_length, nativeint& result);
+
+// check result, raise exception on error
+let private check error result =
+    if result <> 0 then failwith error
+
+// compress buffer
+let compress (data: byte array) =
+    // get maximum resulting length
+    let mutable clength = Snappy.snappy_max_compressed_length(nativeint data.Length)
+
+    // compress data
+    let compressed = Array.zeroCreate (int clength)
+    Snappy.snappy_compress(data, nativeint data.Length, compressed, &clength) |> check "Internal error during compression"
+    assert (int clength <= compressed.Length)
+
+    // return compressed chunk
+    Array.sub compressed 0 (int clength)
+
+// decompress buffer
+let decompress (data: byte array) =
+    // get original length
+    let mutable length = 0n
+    Snappy.snappy_uncompressed_length(data, nativeint data.Length, &length) |> check "Invalid compressed data"
+
+    // decompress data
+    let result = Array.zeroCreate (int length)
+    Snappy.snappy_uncompress(data, nativeint data.Length, result, &length) |> check "Invalid compressed data"
+    assert (int length = result.Length)
+
+    // return decompressed chunk
+    result
+
+// get maximum compressed length for the data of the specified length
+let getMaxCompressedLength (length: int) =
+    int (Snappy.snappy_max_compressed_length(nativeint length))
+
+// compress native memory to the destination that has at least getMaxCompressedLength bytes, return compressed length
+let compressTo (data: nativeint) (length: int) (output: nativeint) (capacity: int) =
+    if capacity < getMaxCompressedLength length then raise (ArgumentOutOfRangeException("capacity"))
+
+    let mutable clength = nativeint capacity
+    Snappy.snappy_compress_ptr(data, nativeint length, output, &clength) |> check "Internal error during compression"
+
+    int clength
+
+// get decompressed length of the compressed native memory
+let getDecompressedLength (data: nativeint) (length: int) =
+    let mutable result = 0n
+    Snappy.snappy_uncompressed_length_ptr(data, nativeint length, &result) |> check "Invalid compressed data"
+
+    int result
+
+// decompress native memory to the destination (i.e. DataStream.DataPointer or a mapped upload buffer), return
+// decompressed length
+let decompressTo (data: nativeint) (length: int) (output: nativeint) (capacity: int) =
+    if capacity < getDecompressedLength data length then raise (ArgumentOutOfRangeException("capacity"))
+
+    let mutable result = nativeint capacity
+    Snappy.snappy_uncompress_ptr(data, nativeint length, output, &result) |> check "Invalid compressed data"
+
+    int result
+
+// run the function with the pinned array
+let private withPinned (data: byte array) f =
+    let gch = GCHandle.Alloc(data, GCHandleType.Pinned)
+
+    try
+        f (gch.AddrOfPinnedObject())
+    finally
+        gch.Free()
+
+// copy native memory
+let private copyMemory (source: nativeint) (target: nativeint) length =
+    let source = NativePtr.ofNativeInt<byte> source
+    let target = NativePtr.ofNativeInt<byte> target
+
+    for i in 0 .. length - 1 do
+        NativePtr.set target i (NativePtr.get source i)
+
+// framed format: every frame consists of a 12-byte little-endian header followed by the payload; the header contains the
+// payload length with the highest bit set if the payload is stored uncompressed, the uncompressed length and the masked
+// CRC-32C of the uncompressed data (same masking as in the snappy framing format); frames are self-contained, so any
+// sequence of frames is a valid stream
+let private frameHeaderLength = 12
+let private frameStoredFlag = 0x80000000u
+
+// CRC-32C lookup tables for slice-by-8 computation
+let private crcTable =
+    let table = Array.init 8 (fun _ -> Array.zeroCreate 256)
+
+    for i in 0 .. 255 do
+        let mutable crc = uint32 i
+        for _ in 1 .. 8 do crc <- (crc >>> 1) ^^^ (0x82f63b78u &&& (0u - (crc &&& 1u)))
+        table.[0].[i] <- crc
+
+    for i in 0 .. 255 do
+        for k in 1 .. 7 do
+            table.[k].[i] <- (table.[k - 1].[i] >>> 8) ^^^ table.[0].[int (table.[k - 1].[i] &&& 0xffu)]
+
+    table
+
+// get masked CRC-32C of native memory
+let private crc32c (data: nativeint) length =
+    let t = crcTable
+    let mutable crc = 0xffffffffu
+    let mutable offset = 0
+
+    while length - offset >= 8 do
+        let low = uint32 (Marshal.ReadInt32(data, offset)) ^^^ crc
+        let high = uint32 (Marshal.ReadInt32(data, offset + 4))
+
+        crc <- t.[7].[int (low &&& 0xffu)] ^^^ t.[6].[int ((low >>> 8) &&& 0xffu)] ^^^ t.[5].[int ((low >>> 16) &&& 0xffu)] ^^^ t.[4].[int (low >>> 24)] ^^^
+               t.[3].[int (high &&& 0xffu)] ^^^ t.[2].[int ((high >>> 8) &&& 0xffu)] ^^^ t.[1].[int ((high >>> 16) &&& 0xffu)] ^^^ t.[0].[int (high >>> 24)]
+        offset <- offset + 8
+
+    while offset < length do
+        crc <- (crc >>> 8) ^^^ t.[0].[int ((crc ^^^ uint32 (Marshal.ReadByte(data, offset))) &&& 0xffu)]
+        offset <- offset + 1
+
+    // masking makes checksums of data that contains embedded checksums less regular
+    let crc = ~~~crc
+    ((crc >>> 15) ||| (crc <<< 17)) + 0xa282ead8u
+
+// get maximum frame length for the block of the specified size
+let private getMaxFrameLength length =
+    frameHeaderLength + getMaxCompressedLength length
+
+// compress the block into a single frame; output has to be at least getMaxFrameLength bytes, return frame length
+let private compressFrame (input: nativeint) (length: int) (output: nativeint) (capacity: int) =
+    let payload = output + nativeint frameHeaderLength
+    let clength = compressTo input length payload (capacity - frameHeaderLength)
+
+    // incompressible data is stored as is, so that decompression is a plain copy
+    let plength, flags =
+        if clength >= length then
+            copyMemory input payload length
+            length, frameStoredFlag
+        else
+            clength, 0u
+
+    Marshal.WriteInt32(output, int (uint32 plength ||| flags))
+    Marshal.WriteInt32(output, 4, length)
+    Marshal.WriteInt32(output, 8, int (crc32c input length))
+
+    frameHeaderLength + plength
+
+// parse the frame header, return total frame length (including the header) and uncompressed block length
+let private readFrameHeader (frame: nativeint) =
+    let header = uint32 (Marshal.ReadInt32(frame))
+    let payload = int (header &&& ~~~frameStoredFlag)
+    let length = Marshal.ReadInt32(frame, 4)
+
+    // stored payload has to match the block size; compressed payload can't exceed the snappy bound
+    if length < 0 || (if header &&& frameStoredFlag <> 0u then payload <> length else payload > getMaxCompressedLength length) then
+        failwith "Invalid compressed data"
+
+    frameHeaderLength + payload, length
+
+// decompress the frame to the destination and validate the checksum, return uncompressed block length
+let private decompressFrame (frame: nativeint) (length: int) (output: nativeint) (capacity: int) =
+    let fail () = failwith "Invalid compressed data"
+
+    if length < frameHeaderLength then fail ()
+
+    let flength, ulength = readFrameHeader frame
+    if flength <> length || ulength > capacity then fail ()
+
+    let payload = frame + nativeint frameHeaderLength
+    let plength = length - frameHeaderLength
+
+    if uint32 (Marshal.ReadInt32(frame)) &&& frameStoredFlag <> 0u then
+        copyMemory payload output ulength
+    else
+        // check the length recorded in the snappy stream so that corrupted data can't overrun the block
+        if getDecompressedLength payload plength <> ulength then fail ()
+        decompressTo payload plength output ulength |> ignore
+
+    if crc32c output ulength <> uint32 (Marshal.ReadInt32(frame, 8)) then fail ()
+
+    ulength
+
+// read exactly count bytes unless the stream ends, return the number of bytes read
+let private readFully (stream: Stream) (buffer: byte array) offset count =
+    let rec loop read =
+        if read = count then read
+        else
+            match stream.Read(buffer, offset + read, count - read) with
+            | 0 -> read
+            | n -> loop (read + n)
+
+    loop 0
+
+// framed snappy stream; data is compressed in independent blocks, so memory usage does not depend on the data size,
+// and decompression can start before the entire compressed stream is available
+type SnappyStream(stream: Stream, mode: CompressionMode, ?blockSize: int, ?leaveOpen: bool) =
+    inherit Stream()
+
+    // stream header: magic followed by the uncompressed block size
+    static let magic = "SNPF"B
+    static let maxBlockSize = 64 <<< 20
+
+    let leaveOpen = defaultArg leaveOpen false
+
+    // write or read stream header
+    let blockSize =
+        match mode with
+        | CompressionMode.Compress ->
+            let size = defaultArg blockSize (64 <<< 10)
+            if size <= 0 || size > maxBlockSize then raise (ArgumentOutOfRangeException("blockSize"))
+
+            stream.Write(magic, 0, magic.Length)
+            stream.Write(BitConverter.GetBytes(size), 0, 4)
+            size
+        | _ ->
+            let header = Array.zeroCreate 8
+            if readFully stream header 0 header.Length <> header.Length || Array.sub header 0 4 <> magic then failwith "Invalid compressed stream header"
+
+            let size = BitConverter.ToInt32(header, 4)
+            if size <= 0 || size > maxBlockSize then failwith "Invalid compressed stream header"
+            size
+
+    // uncompressed block; in compression mode position is the amount of buffered data, in decompression mode it is the
+    // read position in the current block
+    let block = Array.zeroCreate blockSize
+    let mutable position = 0
+    let mutable length = 0
+    let mutable disposed = false
+
+    // compressed frame
+    let frame = Array.zeroCreate (getMaxFrameLength blockSize)
+
+    // compress buffered data to a frame
+    let writeFrame () =
+        let flength = withPinned block (fun input -> withPinned frame (fun output -> compressFrame input position output frame.Length))
+
+        stream.Write(frame, 0, flength)
+        position <- 0
+
+    // read and decompress next frame, return false at the end of stream
+    let readFrame () =
+        match readFully stream frame 0 frameHeaderLength with
+        | 0 -> false
+        | n when n < frameHeaderLength -> failwith "Truncated compressed stream"
+        | _ ->
+            let flength, ulength = withPinned frame readFrameHeader
+            if flength > frame.Length || ulength > blockSize then failwith "Invalid compressed data"
+
+            let payload = flength - frameHeaderLength
+            if readFully stream frame frameHeaderLength payload <> payload then failwith "Truncated compressed stream"
+
+            position <- 0
+            length <- withPinned frame (fun input -> withPinned block (fun output -> decompressFrame input flength output blockSize))
+            true
+
+    // get uncompressed block size
+    member this.BlockSize = blockSize
+
+    override this.CanRead = mode = CompressionMode.Decompress
+    override this.CanWrite = mode = CompressionMode.Compress
+    override this.CanSeek = false
+
+    override this.Length = raise (NotSupportedException())
+    override this.Position with get () = raise (NotSupportedException()) and set _ = raise (NotSupportedException())
+    override this.Seek(_, _) = raise (NotSupportedException())
+    override this.SetLength(_) = raise (NotSupportedException())
+
+    override this.Read(buffer, offset, count) =
+        if not this.CanRead then raise (NotSupportedException())
+
+        // skip empty frames
+        let rec next () = position < length || (readFrame () && next ())
+
+        if count > 0 && next () then
+            let size = min count (length - position)
+            Buffer.BlockCopy(block, position, buffer, offset, size)
+            position <- position + size
+            size
+        else
+            0
+
+    override this.Write(buffer, offset, count) =
+        if not this.CanWrite then raise (NotSupportedException())
+
+        let mutable offset = offset
+        let mutable count = count
+
+        while count > 0 do
+            let size = min count (blockSize - position)
+            Buffer.BlockCopy(buffer, offset, block, position, size)
+            position <- position + size
+            offset <- offset + size
+            count <- count - size
+
+            if position = blockSize then writeFrame ()
+
+    // write buffered data as a partial block so that the reader can decompress everything written so far
+    override this.Flush() =
+        if this.CanWrite then
+            if position > 0 then writeFrame ()
+            stream.Flush()
+
+    override this.Dispose(disposing) =
+        try
+            if disposing && not disposed then
+                disposed <- true
+                this.Flush()
+                if not leaveOpen then stream.Dispose()
+        finally
+            base.Dispose(disposing)
+
+// block-parallel container: header (magic, block size, block count, uncompressed length) is followed by the block index
+// (offsets of all frames from the container start, plus the end offset) and by the frames in the framed format;
+// blocks are independent, so compression and decompression use all cores and any block can be decompressed alone
+let private blockMagic = "SNPB"B
+let private blockHeaderLength = 20
+
+// parse container header and validate the block index, return block size, uncompressed length and frame offsets
+let private readBlockIndex (data: nativeint) (size: int) =
+    let fail () = failwith "Invalid compressed data"
+
+    if size < blockHeaderLength || Marshal.ReadInt32(data) <> BitConverter.ToInt32(blockMagic, 0) then fail ()
+
+    let blockSize = Marshal.ReadInt32(data, 4)
+    let count = Marshal.ReadInt32(data, 8)
+    let length = Marshal.ReadInt64(data, 12)
+
+    // all blocks except the last one are full
+    if blockSize <= 0 || count < 0 || length < 0L || length > int64 Int32.MaxValue || int64 count <> (length + int64 blockSize - 1L) / int64 blockSize then fail ()
+    if int64 blockHeaderLength + 8L * (int64 count + 1L) > int64 size then fail ()
+
+    let offsets = Array.init (count + 1) (fun i -> Marshal.ReadInt64(data, blockHeaderLength + 8 * i))
+
+    if offsets.[0] <> int64 (blockHeaderLength + 8 * (count + 1)) || offsets.[count] <> int64 size then fail ()
+    if Seq.pairwise offsets |> Seq.exists (fun (a, b) -> a > b) then fail ()
+
+    blockSize, int length, offsets
+
+// decompress the block from the container to the destination
+let private decompressBlockTo (data: nativeint) (offsets: int64 array) index (output: nativeint) size =
+    let length = decompressFrame (data + nativeint offsets.[index]) (int (offsets.[index + 1] - offsets.[index])) output size
+    if length <> size then failwith "Invalid compressed data"
+
+// compress buffer to block-parallel container
+let compressBlocks (data: byte array) blockSize =
+    if blockSize <= 0 then raise (ArgumentOutOfRangeException("blockSize"))
+
+    let count = (data.Length + blockSize - 1) / blockSize
+
+    // compress all blocks in parallel
+    let frames =
+        withPinned data (fun input ->
+            Array.Parallel.init count (fun i ->
+                let offset = i * blockSize
+                let size = min blockSize (data.Length - offset)
+                let frame = Array.zeroCreate (getMaxFrameLength size)
+                frame, withPinned frame (fun output -> compressFrame (input + nativeint offset) size output frame.Length)))
+
+    // write header, index and frames
+    let indexLength = blockHeaderLength + 8 * (count + 1)
+    let result: byte array = Array.zeroCreate (indexLength + (frames |> Array.sumBy snd))
+    let write offset (bytes: byte array) = Buffer.BlockCopy(bytes, 0, result, offset, bytes.Length)
+
+    write 0 blockMagic
+    write 4 (BitConverter.GetBytes(blockSize))
+    write 8 (BitConverter.GetBytes(count))
+    write 12 (BitConverter.GetBytes(int64 data.Length))
+
+    let mutable offset = indexLength
+
+    for i in 0 .. count - 1 do
+        let frame, length = frames.[i]
+        write (blockHeaderLength + 8 * i) (BitConverter.GetBytes(int64 offset))
+        Buffer.BlockCopy(frame, 0, result, offset, length)
+        offset <- offset + length
+
+    write (blockHeaderLength + 8 * count) (BitConverter.GetBytes(int64 offset))
+
+    result
+
+// get decompressed length of block-parallel container in native memory
+let getBlocksDecompressedLength (data: nativeint) (length: int) =
+    let _, result, _ = readBlockIndex data length
+    result
+
+// decompress block-parallel container from native memory to the destination, return decompressed length
+let decompressBlocksTo (data: nativeint) (length: int) (output: nativeint) (capacity: int) =
+    let blockSize, result, offsets = readBlockIndex data length
+    if capacity < result then raise (ArgumentOutOfRangeException("capacity"))
+
+    // decompress all blocks in parallel directly to the destination
+    Array.Parallel.iter (fun i ->
+        let offset = i * blockSize
+        decompressBlockTo data offsets i (output + nativeint offset) (min blockSize (result - offset)))
+        (Array.init (offsets.Length - 1) id)
+
+    result
+
+// decompress block-parallel container
+let decompressBlocks (data: byte array) =
+    withPinned data (fun input ->
+        let result = Array.zeroCreate (getBlocksDecompressedLength input data.Length)
+        withPinned result (fun output -> decompressBlocksTo input data.Length output result.Length) |> ignore
+        result)
+
+// get uncompressed block size of block-parallel container
+let getBlockSize (data: byte array) =
+    let blockSize, _, _ = withPinned data (fun input -> readBlockIndex input data.Length)
+    blockSize
+
+// get block count of block-parallel container
+let getBlockCount (data: byte array) =
+    let _, _, offsets = withPinned data (fun input -> readBlockIndex input data.Length)
+    offsets.Length - 1
+
+// decompress a single block of block-parallel container
+let decompressBlock (data: byte array) index =
+    withPinned data (fun input ->
+        let blockSize, length, offsets = readBlockIndex input data.Length
+        if index < 0 || index >= offsets.Length - 1 then raise (ArgumentOutOfRangeException("index"))
+
+        let result = Array.zeroCreate (min blockSize (length - index * blockSize))
+        withPinned result (fun output -> decompressBlockTo input offsets index output result.Length)
+        result)
+
+// dictionary codec: snappy has no preset dictionary support, so records are encoded in the snappy format by a managed
+// codec whose copies can reach past the start of the output into the dictionary; without a dictionary, the output is
+// plain snappy data
+let private dictionaryTableBits = 15
+let private maxInputTableBits = 14
+
+// load 4 bytes at the offset
+let private load32 (data: byte array) offset =
+    BitConverter.ToUInt32(data, offset)
+
+// hash 4 bytes at the offset to a table index
+let private hash4 (data: byte array) offset bits =
+    int ((load32 data offset * 0x1e35a7bdu) >>> (32 - bits))
+
+// get length of the common prefix of two ranges; second range ends at the limit
+let private matchLength (a: byte array) aOffset (b: byte array) bOffset limit =
+    let mutable length = 0
+
+    while bOffset + length < limit && a.[aOffset + length] = b.[bOffset + length] do
+        length <- length + 1
+
+    length
+
+// write varint at the position, return the position after it
+let private writeVarint (output: byte array) position (value: int) =
+    let mutable position = position
+    let mutable value = uint32 value
+
+    while value >= 128u do
+        output.[position] <- byte (value ||| 128u)
+        position <- position + 1
+        value <- value >>> 7
+
+    output.[position] <- byte value
+    position + 1
+
+// write literal at the position, return the position after it
+let private writeLiteral (output: byte array) position (data: byte array) offset length =
+    if length = 0 then position
+    else
+        let n = length - 1
+
+        let position =
+            if n < 60 then
+                output.[position] <- byte (n <<< 2)
+                position + 1
+            else
+                // tags 60..63 are followed by 1..4 bytes of length
+                let count = if n < (1 <<< 8) then 1 elif n < (1 <<< 16) then 2 elif n < (1 <<< 24) then 3 else 4
+
+                output.[position] <- byte ((59 + count) <<< 2)
+                for i in 0 .. count - 1 do output.[position + 1 + i] <- byte (n >>> (i * 8))
+                position + 1 + count
+
+        Buffer.BlockCopy(data, offset, output, position, length)
+        position + length
+
+// write copy at the position, return the position after it
+let rec private writeCopy (output: byte array) position offset length =
+    // long copies are split so that the remainder is at least 4 bytes and can use any copy tag
+    if length >= 68 then
+        writeCopy output (writeCopy output position offset 64) offset (length - 64)
+    elif length > 64 then
+        writeCopy output (writeCopy output position offset 60) offset (length - 60)
+    elif length < 12 && offset < 2048 then
+        output.[position] <- byte (1 ||| ((length - 4) <<< 2) ||| ((offset >>> 8) <<< 5))
+        output.[position + 1] <- byte offset
+        position + 2
+    elif offset < 65536 then
+        output.[position] <- byte (2 ||| ((length - 1) <<< 2))
+        output.[position + 1] <- byte offset
+        output.[position + 2] <- byte (offset >>> 8)
+        position + 3
+    else
+        output.[position] <- byte (3 ||| ((length - 1) <<< 2))
+        for i in 0 .. 3 do output.[position + 1 + i] <- byte (offset >>> (i * 8))
+        position + 5
+
+// shared dictionary for compressing many small records; data compressed with a dictionary can only be decompressed with
+// the same dictionary
+type CompressionDictionary(data: byte array) =
+    // positions of 4-byte sequences in the dictionary; later positions win, so that offsets are as short as possible
+    let table =
+        let table = Array.create (1 <<< dictionaryTableBits) -1
+        for i in 0 .. data.Length - 4 do table.[hash4 data i dictionaryTableBits] <- i
+        table
+
+    // get dictionary data
+    member this.Data = data
+
+    // get dictionary hash table
+    member internal this.Table = table
+
+// compress buffer with the dictionary
+let compressWith (dictionary: CompressionDictionary) (data: byte array) =
+    let dict = dictionary.Data
+    let dictTable = dictionary.Table
+
+    // input table is sized to the input, so that small records don't pay for clearing a large table
+    let mutable bits = 8
+    while bits < maxInputTableBits && (1 <<< bits) < data.Length do bits <- bits + 1
+
+    let table = Array.create (1 <<< bits) -1
+
+    let output = Array.zeroCreate (getMaxCompressedLength data.Length)
+    let mutable op = writeVarint output 0 data.Length
+    let mutable ip = 0
+    let mutable literal = 0
+    let mutable misses = 32
+
+    while ip + 4 <= data.Length do
+        let slot = hash4 data ip bits
+        let candidate = table.[slot]
+        table.[slot] <- ip
+
+        let mutable offset = 0
+        let mutable length = 0
+
+        if candidate >= 0 && load32 data candidate = load32 data ip then
+            offset <- ip - candidate
+            length <- 4 + matchLength data (candidate + 4) data (ip + 4) data.Length
+        elif dict.Length >= 4 then
+            let dictCandidate = dictTable.[hash4 data ip dictionaryTableBits]
+
+            // dictionary matches stop at the dictionary end
+            if dictCandidate >= 0 && load32 dict dictCandidate = load32 data ip then
+                offset <- ip + dict.Length - dictCandidate
+                length <- 4 + matchLength dict (dictCandidate + 4) data (ip + 4) (ip + min (data.Length - ip) (dict.Length - dictCandidate))
+
+        // long copies only pay off if they are not shorter than their encoding plus the split literal overhead
+        if offset >= 65536 && length < 8 then length <- 0
+
+        if length = 0 then
+            // skip faster through incompressible data
+            ip <- ip + (misses >>> 5)
+            misses <- misses + 1
+        else
+            op <- writeLiteral output op data literal (ip - literal)
+            op <- writeCopy output op offset length
+            ip <- ip + length
+            literal <- ip
+            misses <- 32
+
+    op <- writeLiteral output op data literal (data.Length - literal)
+
+    // return compressed chunk
+    Array.sub output 0 op
+
+// decompress buffer with the dictionary
+let decompressWith (dictionary: CompressionDictionary) (data: byte array) =
+    let fail () = failwith "Invalid compressed data"
+    let dict = dictionary.Data
+
+    // get original length
+    let mutable ip = 0
+    let mutable length = 0L
+    let mutable shift = 0
+
+    let mutable more = true
+
+    while more do
+        if ip >= data.Length || shift >= 35 then fail ()
+
+        length <- length ||| (int64 (data.[ip] &&& 127uy) <<< shift)
+        more <- data.[ip] >= 128uy
+        ip <- ip + 1
+        shift <- shift + 7
+
+    if length > int64 Int32.MaxValue then fail ()
+
+    // decompress data
+    let result: byte array = Array.zeroCreate (int length)
+    let mutable op = 0
+
+    while ip < data.Length do
+        let tag = int data.[ip]
+        ip <- ip + 1
+
+        if tag &&& 3 = 0 then
+            let mutable count = int64 (tag >>> 2) + 1L
+
+            if count > 60L then
+                let bytes = int count - 60
+                if data.Length - ip < bytes then fail ()
+
+                count <- 0L
+                for i in 0 .. bytes - 1 do count <- count ||| (int64 data.[ip + i] <<< (i * 8))
+                count <- count + 1L
+                ip <- ip + bytes
+
+            if int64 (data.Length - ip) < count || int64 (result.Length - op) < count then fail ()
+
+            Buffer.BlockCopy(data, ip, result, op, int count)
+            ip <- ip + int count
+            op <- op + int count
+        else
+            let size = match tag &&& 3 with 1 -> 1 | 2 -> 2 | _ -> 4
+            if data.Length - ip < size then fail ()
+
+            let mutable count = if tag &&& 3 = 1 then ((tag >>> 2) &&& 7) + 4 else (tag >>> 2) + 1
+            let offset =
+                match tag &&& 3 with
+                | 1 -> int64 (((tag >>> 5) <<< 8) ||| int data.[ip])
+                | 2 -> int64 data.[ip] ||| (int64 data.[ip + 1] <<< 8)
+                | _ -> int64 (BitConverter.ToUInt32(data, ip))
+
+            ip <- ip + size
+
+            if offset = 0L || offset > int64 (op + dict.Length) || result.Length - op < count then fail ()
+
+            // copy the dictionary part first; the rest comes from the output and may overlap the destination
+            if offset > int64 op then
+                let fromDict = min count (int offset - op)
+                Buffer.BlockCopy(dict, dict.Length - (int offset - op), result, op, fromDict)
+                op <- op + fromDict
+                count <- count - fromDict
+
+            let offset = int offset
+
+            for _ in 1 .. count do
+                result.[op] <- result.[op - offset]
+                op <- op + 1
+
+    if op <> result.Length then fail ()
+
+    // return decompressed chunk
+    result
+
+// train dictionary of the specified size from sample records; the dictionary consists of sample segments that cover the
+// most 8-byte sequences that are shared between samples
+let trainDictionary (samples: byte array seq) size =
+    let samples = Seq.toArray samples
+    let segmentSize = 64
+
+    // get all 8-byte sequences of the range
+    let sequences (sample: byte array) offset length =
+        seq { for i in offset .. offset + length - 8 -> BitConverter.ToUInt64(sample, i) }
+
+    // count the samples that contain each sequence
+    let counts = Dictionary<uint64, int>()
+
+    for sample in samples do
+        for s in HashSet(sequences sample 0 sample.Length) do
+            counts.[s] <- (match counts.TryGetValue(s) with | true, c -> c | _ -> 0) + 1
+
+    // sequences that occur only once are useless for compression; covered sequences don't add value either
+    let score sample offset length =
+        HashSet(sequences sample offset length) |> Seq.sumBy (fun s -> counts.[s] - 1)
+
+    let segments =
+        [| for sample in samples do
+            for offset in 0 .. segmentSize .. sample.Length - 1 ->
+                let length = min segmentSize (sample.Length - offset)
+                sample, offset, length, score sample offset length |]
+        |> Array.sortBy (fun (_, _, _, score) -> -score)
+
+    // greedily select segments, rescoring them with the sequences that are already covered; skip segments that lost half of
+    // their value to previous selections
+    let selected = List<byte array>()
+    let mutable total = 0
+
+    for (sample, offset, length, initial) in segments do
+        if total < size && initial > 0 && score sample offset length * 2 >= initial then
+            for s in sequences sample offset length do counts.[s] <- 1
+
+            selected.Add(Array.sub sample offset (min length (size - total)))
+            total <- total + length
+
+    // best segments go last, so that they are closest to the data and use shorter offsets
+    selected.Reverse()
+    Array.concat selected
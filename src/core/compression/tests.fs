@@ -0,0 +1,216 @@
+module Core.CompressionTests
+
+open System
+open System.IO
+open System.IO.Compression
+open System.Runtime.InteropServices
+
+open Core.Compression
+
+// test data that has both compressible and incompressible parts
+let private sample size =
+    let random = Random(42)
+    Array.init size (fun i -> if (i / 4096) % 3 = 0 then byte (random.Next(256)) else byte ((i / 16) % 7))
+
+// compress data with the specified block size, writing it in chunks of the specified size
+let private compressStream (data: byte array) blockSize chunkSize =
+    use output = new MemoryStream()
+
+    do
+        use stream = new SnappyStream(output, CompressionMode.Compress, blockSize, true)
+
+        for offset in 0 .. chunkSize .. data.Length - 1 do
+            stream.Write(data, offset, min chunkSize (data.Length - offset))
+
+    output.ToArray()
+
+// decompress data, reading it in chunks of the specified size
+let private decompressStream (data: byte array) chunkSize =
+    use stream = new SnappyStream(new MemoryStream(data), CompressionMode.Decompress)
+    use output = new MemoryStream()
+    let buffer = Array.zeroCreate chunkSize
+
+    let rec loop () =
+        match stream.Read(buffer, 0, chunkSize) with
+        | 0 -> ()
+        | n -> output.Write(buffer, 0, n); loop ()
+
+    loop ()
+    output.ToArray()
+
+let testBufferRoundtrip () =
+    for size in [0; 1; 100; 100000] do
+        let data = sample size
+        assert (decompress (compress data) = data)
+
+let testStreamRoundtrip () =
+    for size in [0; 1; 4095; 4096; 4097; 100000] do
+        let data = sample size
+
+        for (blockSize, chunkSize) in [4096, 1; 4096, 1000; 4096, 10000; 65536, 7] do
+            let compressed = compressStream data blockSize chunkSize
+            assert (decompressStream compressed 1 = data)
+            assert (decompressStream compressed 5000 = data)
+
+let testStreamFlush () =
+    use output = new MemoryStream()
+    use stream = new SnappyStream(output, CompressionMode.Compress, 4096)
+
+    // flushed data can be decompressed without the rest of the stream
+    stream.Write(sample 10000, 0, 10000)
+    stream.Flush()
+
+    let partial = output.ToArray()
+    assert (decompressStream partial 100 = sample 10000)
+
+let testStreamCorruption () =
+    let data = sample 20000
+    let compressed = compressStream data 4096 20000
+
+    let fails (data: byte array) =
+        try
+            decompressStream data 4096 |> ignore
+            false
+        with e -> true
+
+    // corrupted header, payload and truncated stream have to be detected
+    for offset in [0; 9; 20; 30; 1000; compressed.Length - 1] do
+        let corrupted = Array.copy compressed
+        corrupted.[offset] <- corrupted.[offset] ^^^ 1uy
+        assert (fails corrupted)
+
+    assert (fails (Array.sub compressed 0 (compressed.Length - 1)))
+    assert (fails (Array.sub compressed 0 15))
+
+let testBlocksRoundtrip () =
+    for size in [0; 1; 4095; 4096; 4097; 100000] do
+        let data = sample size
+        let compressed = compressBlocks data 4096
+
+        assert (decompressBlocks compressed = data)
+        assert (getBlockCount compressed = (size + 4095) / 4096)
+
+        // every block can be decompressed on its own
+        for i in 0 .. getBlockCount compressed - 1 do
+            assert (decompressBlock compressed i = Array.sub data (i * 4096) (min 4096 (size - i * 4096)))
+
+let testBlocksCorruption () =
+    let compressed = compressBlocks (sample 20000) 4096
+
+    let fails (data: byte array) =
+        try
+            decompressBlocks data |> ignore
+            false
+        with e -> true
+
+    // corrupted header, index and frames, as well as truncated data, have to be detected
+    for offset in [0; 4; 8; 12; 20; 28; 70; 100; compressed.Length - 1] do
+        let corrupted = Array.copy compressed
+        corrupted.[offset] <- corrupted.[offset] ^^^ 1uy
+        assert (fails corrupted)
+
+    assert (fails (Array.sub compressed 0 (compressed.Length - 1)))
+
+    // negative length matches the block count of an empty container, so it has to be rejected explicitly
+    let empty = compressBlocks [||] 4096
+    Buffer.BlockCopy(BitConverter.GetBytes(-1L), 0, empty, 12, 8)
+
+    assert (try decompressBlocks empty |> ignore; false with e -> e.Message = "Invalid compressed data")
+
+// run the function with unmanaged memory block of the specified size
+let private withMemory size f =
+    let memory = Marshal.AllocHGlobal(max 1 size)
+
+    try
+        f memory
+    finally
+        Marshal.FreeHGlobal(memory)
+
+let testPointerRoundtrip () =
+    for size in [0; 1; 100000] do
+        let data = sample size
+
+        withMemory size (fun input ->
+            Marshal.Copy(data, 0, input, size)
+
+            let capacity = getMaxCompressedLength size
+
+            withMemory capacity (fun compressed ->
+                let length = compressTo input size compressed capacity
+
+                // pointer variants use the same format as the array ones
+                let bytes: byte array = Array.zeroCreate length
+                Marshal.Copy(compressed, bytes, 0, length)
+                assert (decompress bytes = data)
+                assert (getDecompressedLength compressed length = size)
+
+                withMemory size (fun output ->
+                    let result = decompressTo compressed length output size
+                    let bytes: byte array = Array.zeroCreate result
+                    Marshal.Copy(output, bytes, 0, result)
+                    assert (bytes = data))))
+
+let testPointerBlocksRoundtrip () =
+    let data = sample 100000
+    let compressed = compressBlocks data 4096
+
+    withMemory compressed.Length (fun input ->
+        Marshal.Copy(compressed, 0, input, compressed.Length)
+        assert (getBlocksDecompressedLength input compressed.Length = data.Length)
+
+        withMemory data.Length (fun output ->
+            let length = decompressBlocksTo input compressed.Length output data.Length
+            let bytes: byte array = Array.zeroCreate length
+            Marshal.Copy(output, bytes, 0, length)
+            assert (bytes = data)))
+
+let testPointerCapacity () =
+    let data = sample 10000
+    let compressed = compress data
+
+    let fails f =
+        try
+            f () |> ignore
+            false
+        with e -> true
+
+    // destination has to be large enough for any result
+    withMemory data.Length (fun input ->
+        Marshal.Copy(data, 0, input, data.Length)
+        assert (fails (fun () -> withMemory data.Length (fun output -> compressTo input data.Length output data.Length))))
+
+    withMemory compressed.Length (fun input ->
+        Marshal.Copy(compressed, 0, input, compressed.Length)
+        assert (fails (fun () -> withMemory data.Length (fun output -> decompressTo input compressed.Length output (data.Length - 1)))))
+
+// small serialized-like records that share most of their structure
+let private records count seed =
+    let random = Random(seed)
+
+    Array.init count (fun i ->
+        sprintf "{ material = \"art/materials/mat%03d\"; albedo = \"art/textures/albedo_%d.dds\"; specular = [%d, %d, %d]; roughness = %f; }"
+            i (i * 7) (random.Next(256)) (random.Next(256)) (random.Next(256)) (random.NextDouble())
+        |> Text.Encoding.UTF8.GetBytes)
+
+let testDictionaryRoundtrip () =
+    let dictionary = CompressionDictionary(trainDictionary (records 100 1) 4096)
+
+    for data in Array.append (records 100 2) [| [||]; sample 100000 |] do
+        assert (decompressWith dictionary (compressWith dictionary data) = data)
+
+    // empty dictionary works as well, and produces plain snappy data
+    let empty = CompressionDictionary([||])
+
+    for data in records 10 3 do
+        assert (decompressWith empty (compressWith empty data) = data)
+        assert (decompress (compressWith empty data) = data)
+
+let testDictionaryRatio () =
+    let data = records 1000 2
+    let dictionary = CompressionDictionary(trainDictionary (records 100 1) 4096)
+
+    // dictionary has to significantly improve compression of small records
+    let plain = data |> Array.sumBy (fun r -> (compress r).Length)
+    let primed = data |> Array.sumBy (fun r -> (compressWith dictionary r).Length)
+
+    assert (primed * 2 < plain)
@@ -73,3 +73,28 @@ let private runTestsWithAssertionHandler () =
 // run all tests
 let run () =
     runTestsWithAssertionHandler()
+
+// get best time in milliseconds over several runs of the function; the first run is not timed, so that one-time costs
+// like JIT compilation are excluded
+let measure f =
+    f () |> ignore
+
+    Array.init 5 (fun _ ->
+        let timer = System.Diagnostics.Stopwatch.StartNew()
+        f () |> ignore
+        timer.Elapsed.TotalMilliseconds) |> Array.min
+
+// run all benchmarks in all loaded assemblies; benchmarks are public functions without arguments in modules with names
+// that end with Benchmarks, and they print their own results
+let benchmark () =
+    let assemblies = System.AppDomain.CurrentDomain.GetAssemblies()
+    let types = assemblies |> Array.collect (fun a -> a.GetTypes())
+    let suites = types |> Array.filter (fun t -> t.Name.EndsWith("Benchmarks"))
+    let methods = suites |> Array.collect (fun t -> t.GetMethods(System.Reflection.BindingFlags.Static ||| System.Reflection.BindingFlags.Public))
+    let benchmarks = methods |> Array.filter (fun m -> m.GetParameters().Length = 0)
+
+    for b in benchmarks do
+        printfn "%s.%s:" b.DeclaringType.FullName b.Name
+
+        let d = System.Delegate.CreateDelegate(typeof<TestDelegate>, b) :?> TestDelegate
+        d.Invoke()
@@ -16,7 +16,7 @@ type Device(output: nativeint) =
             OutputHandle = output,
             SampleDescription = SampleDescription(1, 0),
             SwapEffect = SwapEffect.Discard,
-            Usage = Usage.RenderTargetOutput,
+            Usage = (Usage.RenderTargetOutput ||| Usage.UnorderedAccess),
             Flags = SwapChainFlags.AllowModeSwitch)
 
     // create device
@@ -25,10 +25,10 @@ type Device(output: nativeint) =
     // disable Alt+Enter handling
     do swapchain.GetParent<Factory>().MakeWindowAssociation(output, WindowAssociationFlags.IgnoreAltEnter) |> ignore
 
-    // get back buffer
+    // get back buffer; it has an unordered access view so that compute shaders can write the final image
     let getBackBuffer () =
         let resource = Texture2D.FromSwapChain<Texture2D>(swapchain, 0)
-        new RenderTarget(resource, null, new RenderTargetView(device, resource), null)
+        new RenderTarget(resource, null, new RenderTargetView(device, resource), null, unorderedView = new UnorderedAccessView(device, resource))
 
     // back buffer
     let mutable backbuffer = getBackBuffer ()
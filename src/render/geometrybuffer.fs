@@ -9,15 +9,33 @@ type GeometryBuffer(bindFlags, contents: byte array) =
     [<System.NonSerialized>]
     let mutable data = null
 
+    // raw shader view for vertex buffers
+    [<System.NonSerialized>]
+    let mutable view = null
+
     // fixup callback
     member private this.Fixup ctx =
         let device = Core.Serialization.Fixup.Get<Device>(ctx)
         use stream = DataStream.Create(contents, canRead = true, canWrite = false, makeCopy = false)
-        data <- new Buffer(device, stream, BufferDescription(SizeInBytes = contents.Length, BindFlags = bindFlags))
+
+        // vertex data is also read by compute shaders (i.e. skinning) as a raw buffer
+        if bindFlags = BindFlags.VertexBuffer then
+            data <- new Buffer(device, stream, BufferDescription(SizeInBytes = contents.Length, BindFlags = (bindFlags ||| BindFlags.ShaderResource), OptionFlags = ResourceOptionFlags.BufferAllowRawViews))
+            view <- new ShaderResourceView(device, data,
+                        ShaderResourceViewDescription(Format = SharpDX.DXGI.Format.R32_Typeless, Dimension = ShaderResourceViewDimension.ExtendedBuffer, BufferEx =
+                            ShaderResourceViewDescription.ExtendedBufferResource(ElementCount = contents.Length / 4, Flags = ShaderResourceViewExtendedBufferFlags.Raw)))
+        else
+            data <- new Buffer(device, stream, BufferDescription(SizeInBytes = contents.Length, BindFlags = bindFlags))
 
     // resource accessor
     member this.Resource = data
 
+    // raw view accessor; null for index buffers
+    member this.View = view
+
+    // data size in bytes
+    member this.Size = contents.Length
+
 // vertex buffer
 type VertexBuffer(contents) =
     inherit GeometryBuffer(BindFlags.VertexBuffer, contents)
@@ -0,0 +1,24 @@
+module Render.Instancing.Benchmarks
+
+// instance batching for levels with many copies of the same meshes: 200 meshes with 1-4 fragments that use 40
+// materials; compares draw calls and material changes with drawing every object separately and with per-mesh
+// instancing through a constant buffer array, which is limited to 1365 float3x4 transforms per draw
+let benchmarkInstanceBatching () =
+    let random = System.Random(42)
+    let meshes = Array.init 200 (fun _ -> Array.init (1 + random.Next(4)) (fun _ -> random.Next(40)))
+
+    printfn "%10s %14s %14s %14s %16s %16s %12s" "instances" "object draws" "cbuffer draws" "batch draws" "object changes" "batch changes" "build ms"
+
+    for count in [1000; 10000; 100000] do
+        // mesh popularity is skewed, like props in a level
+        let instances = Array.init count (fun i -> meshes.[int (float meshes.Length * random.NextDouble() ** 3.0)], Matrix34.Translation(float32 i, 0.f, 0.f))
+
+        let _, batches = InstanceBatcher.build instances id
+
+        let countChanges (materials: int seq) = materials |> Seq.pairwise |> Seq.filter (fun (a, b) -> a <> b) |> Seq.length
+        let objectDraws = instances |> Array.sumBy (fun (mesh, _) -> mesh.Length)
+        let cbufferDraws = batches |> Array.sumBy (fun b -> (b.instanceCount + 1364) / 1365)
+
+        printfn "%10d %14d %14d %14d %16d %16d %12.2f" count objectDraws cbufferDraws batches.Length
+            (countChanges (instances |> Seq.collect fst)) (countChanges (batches |> Seq.map (fun b -> b.mesh.[b.fragment])))
+            (Core.Test.measure (fun () -> InstanceBatcher.build instances id))
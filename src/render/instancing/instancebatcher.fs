@@ -0,0 +1,59 @@
+// instance batching; groups mesh instances by mesh, so each mesh fragment is drawn once for all of its instances, and
+// orders the draws by material, so material state changes once per material instead of once per fragment
+module Render.Instancing.InstanceBatcher
+
+open System.Collections.Generic
+
+// instanced draw of one mesh fragment
+type Batch<'Mesh> =
+    { mesh: 'Mesh
+      fragment: int
+      // instance range in the transform array
+      firstInstance: int
+      instanceCount: int }
+
+// build batches for (mesh, transform) instances; meshes are compared by reference and materials structurally
+// returns transforms that are grouped by mesh and batches that are grouped by material; both groupings keep the order
+// of first appearance, so the result is deterministic
+let build (instances: ('Mesh * Matrix34) array) (getMaterials: 'Mesh -> 'Material array) =
+    // group transforms by mesh with a counting sort
+    let meshes = List<'Mesh>()
+    let indices = Dictionary<'Mesh, int>(HashIdentity.Reference)
+
+    let meshIndices =
+        instances |> Array.map (fun (mesh, _) ->
+            match indices.TryGetValue(mesh) with
+            | true, index -> index
+            | _ ->
+                indices.Add(mesh, meshes.Count)
+                meshes.Add(mesh)
+                meshes.Count - 1)
+
+    let counts = Array.zeroCreate meshes.Count
+
+    for index in meshIndices do
+        counts.[index] <- counts.[index] + 1
+
+    let offsets = Array.scan (+) 0 counts
+    let positions = Array.copy offsets
+    let transforms = Array.zeroCreate instances.Length
+
+    for i in 0 .. instances.Length - 1 do
+        let index = meshIndices.[i]
+        transforms.[positions.[index]] <- snd instances.[i]
+        positions.[index] <- positions.[index] + 1
+
+    // one batch per mesh fragment
+    let batches =
+        meshes |> Seq.mapi (fun index mesh ->
+            getMaterials mesh |> Array.mapi (fun fragment material ->
+                material, { mesh = mesh; fragment = fragment; firstInstance = offsets.[index]; instanceCount = counts.[index] }))
+        |> Array.concat
+
+    // group batches by material; the sort is stable, so batches with the same material keep the mesh order
+    let materials = Dictionary<'Material, int>(HashIdentity.Structural)
+
+    for material, _ in batches do
+        if not (materials.ContainsKey(material)) then materials.Add(material, materials.Count)
+
+    transforms, batches |> Seq.sortBy (fun (material, _) -> materials.[material]) |> Seq.map snd |> Seq.toArray
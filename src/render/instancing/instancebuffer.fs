@@ -0,0 +1,44 @@
+namespace Render.Instancing
+
+open SharpDX.Direct3D11
+
+open Render
+
+// instance transforms for all instanced draws of a frame in one structured buffer; the buffer is filled once per frame
+// and each batch reads its range, so the instance count per draw is not limited by the constant buffer size
+// the buffer grows to the next power of two if the transforms do not fit
+type InstanceBuffer(device: Device) =
+    static let stride = sizeof<Matrix34>
+    static let minCapacity = 256
+
+    let mutable capacity = 0
+    let mutable buffer: Buffer = null
+    let mutable view: ShaderResourceView = null
+
+    // create buffer for the instance count
+    let create count =
+        if view <> null then view.Dispose()
+        if buffer <> null then buffer.Dispose()
+
+        capacity <- max minCapacity capacity
+        while capacity < count do capacity <- capacity * 2
+
+        buffer <- new Buffer(device.Device, capacity * stride, ResourceUsage.Dynamic, BindFlags.ShaderResource, CpuAccessFlags.Write, ResourceOptionFlags.BufferStructured, stride)
+        view <- new ShaderResourceView(device.Device, buffer)
+
+    // get instance capacity
+    member this.Capacity = capacity
+
+    // get read-only view
+    member this.View = view
+
+    // upload instance transforms for the frame
+    member this.Update(context: DeviceContext, transforms: Matrix34 array) =
+        if transforms.Length > capacity || buffer = null then create transforms.Length
+
+        let _, stream = context.MapSubresource(buffer, MapMode.WriteDiscard, MapFlags.None)
+
+        try
+            stream.WriteRange(transforms)
+        finally
+            context.UnmapSubresource(buffer, 0)
@@ -0,0 +1,55 @@
+module Render.Instancing.Tests
+
+// mesh with fragment materials
+type private TestMesh =
+    { name: string
+      materials: string array }
+
+let private meshes =
+    [| { name = "rock"; materials = [| "stone"; "moss" |] }
+       { name = "crate"; materials = [| "wood" |] }
+       { name = "wall"; materials = [| "stone"; "metal"; "wood" |] } |]
+
+// instances of the meshes in random order; transforms encode the instance index
+let private instances =
+    let random = System.Random(42)
+    Array.init 500 (fun i -> meshes.[random.Next(meshes.Length)], Matrix34.Translation(float32 i, 0.f, 0.f))
+
+let private getMaterials mesh = mesh.materials
+
+let testBatchInstances () =
+    let transforms, batches = InstanceBatcher.build instances getMaterials
+
+    // one batch per mesh fragment, and every instance of the mesh is in the batch range in the original order
+    assert (transforms.Length = instances.Length)
+    assert (batches.Length = (meshes |> Array.sumBy (fun m -> m.materials.Length)))
+
+    for batch in batches do
+        let expected = instances |> Array.filter (fun (mesh, _) -> obj.ReferenceEquals(mesh, batch.mesh)) |> Array.map snd
+
+        assert (Array.sub transforms batch.firstInstance batch.instanceCount = expected)
+
+    // every fragment of every mesh is drawn once
+    let drawn = batches |> Array.map (fun b -> b.mesh.name, b.fragment) |> Array.sort
+    let fragments = meshes |> Array.collect (fun m -> Array.init m.materials.Length (fun f -> m.name, f)) |> Array.sort
+
+    assert (drawn = fragments)
+
+let testBatchMaterials () =
+    let _, batches = InstanceBatcher.build instances getMaterials
+    let materials = batches |> Array.map (fun b -> b.mesh.materials.[b.fragment])
+
+    // batches with the same material are adjacent, in the order of first appearance
+    let changes = materials |> Array.pairwise |> Array.filter (fun (a, b) -> a <> b) |> Array.length
+
+    assert (changes + 1 = (materials |> Array.distinct |> Array.length))
+    assert (Array.distinct materials = (instances |> Array.collect (fun (mesh, _) -> mesh.materials) |> Array.distinct))
+
+let testBatchMeshIdentity () =
+    // meshes are compared by reference, so equal copies of a mesh are batched separately
+    let copy = { meshes.[1] with name = meshes.[1].name }
+    let transforms, batches = InstanceBatcher.build [| meshes.[1], Matrix34.Identity; copy, Matrix34.Identity; meshes.[1], Matrix34.Identity |] getMaterials
+
+    assert (transforms.Length = 3)
+    assert (batches |> Array.map (fun b -> b.instanceCount) = [| 2; 1 |])
+    assert (InstanceBatcher.build [||] getMaterials = ([||], [||]))
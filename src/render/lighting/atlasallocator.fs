@@ -0,0 +1,99 @@
+namespace Render.Lighting
+
+open System.Collections.Generic
+
+// free atlas rectangle
+[<Struct>]
+type private AtlasRect =
+    { x: int
+      y: int
+      width: int
+      height: int }
+
+// 2D atlas allocator with a guillotine free list; allocations take the best-fitting free rectangle and split the rest
+// of it along the shorter leftover axis, so allocations of similar sizes end up in the same strips
+// freed rectangles are merged with free neighbors that share an entire edge, which restores the splits in the reverse
+// order; merging is not exhaustive, so heavy churn can fragment the atlas, in which case the owner should free
+// everything and allocate again
+// allocations never move, so the contents of allocated regions stay valid until they are freed
+type AtlasAllocator(width: int, height: int) =
+    let free = List<AtlasRect>([| { x = 0; y = 0; width = width; height = height } |])
+    let mutable allocatedArea = 0
+
+    // merge two rectangles if they form a rectangle
+    let tryMerge a b =
+        if a.x = b.x && a.width = b.width && (a.y + a.height = b.y || b.y + b.height = a.y) then
+            Some { x = a.x; y = min a.y b.y; width = a.width; height = a.height + b.height }
+        elif a.y = b.y && a.height = b.height && (a.x + a.width = b.x || b.x + b.width = a.x) then
+            Some { x = min a.x b.x; y = a.y; width = a.width + b.width; height = a.height }
+        else
+            None
+
+    // add free rectangle and merge it with the neighbors while possible
+    let rec release rect =
+        match Seq.tryFindIndex (fun r -> (tryMerge rect r).IsSome) free with
+        | Some index ->
+            let merged = (tryMerge rect free.[index]).Value
+            free.RemoveAt(index)
+            release merged
+        | None -> free.Add(rect)
+
+    // atlas dimensions
+    member this.Width = width
+    member this.Height = height
+
+    // total area of allocated rectangles
+    member this.AllocatedArea = allocatedArea
+
+    // free rectangle count; this is a measure of fragmentation
+    member this.FreeCount = free.Count
+
+    // allocate a rectangle; returns the top-left corner, or None if no free rectangle is large enough
+    member this.Allocate(w, h) =
+        // best area fit; ties go to the rectangle closest to the origin for compact and deterministic packing
+        let mutable best = -1
+
+        for i in 0 .. free.Count - 1 do
+            let r = free.[i]
+
+            if w <= r.width && h <= r.height then
+                if best < 0 then best <- i
+                else
+                    let b = free.[best]
+                    let area, barea = r.width * r.height, b.width * b.height
+
+                    if area < barea || (area = barea && (r.y, r.x) < (b.y, b.x)) then best <- i
+
+        if best < 0 then None
+        else
+            let r = free.[best]
+            free.RemoveAt(best)
+
+            // split the leftover space along the shorter axis; the longer leftover stays in one piece
+            let right, bottom =
+                if r.width - w <= r.height - h then
+                    { x = r.x + w; y = r.y; width = r.width - w; height = h }, { x = r.x; y = r.y + h; width = r.width; height = r.height - h }
+                else
+                    { x = r.x + w; y = r.y; width = r.width - w; height = r.height }, { x = r.x; y = r.y + h; width = w; height = r.height - h }
+
+            if right.width > 0 && right.height > 0 then free.Add(right)
+            if bottom.width > 0 && bottom.height > 0 then free.Add(bottom)
+
+            allocatedArea <- allocatedArea + w * h
+
+            Some (r.x, r.y)
+
+    // free a rectangle that was returned by Allocate with the same size
+    member this.Free(x, y, w, h) =
+        assert (x >= 0 && y >= 0 && x + w <= width && y + h <= height)
+        assert (free |> Seq.forall (fun r -> x + w <= r.x || r.x + r.width <= x || y + h <= r.y || r.y + r.height <= y))
+
+        allocatedArea <- allocatedArea - w * h
+
+        release { x = x; y = y; width = w; height = h }
+
+    // free all rectangles
+    member this.Clear() =
+        free.Clear()
+        free.Add({ x = 0; y = 0; width = width; height = height })
+        allocatedArea <- 0
@@ -0,0 +1,154 @@
+module Render.Lighting.Benchmarks
+
+open Render.Lighting.LightGridReference
+
+// light grid fill over a range of light counts and resolutions; the scene is a wavy surface with foreground blocks
+// and lights scattered around it; light counts per pixel show how much shading work the grid saves, and the index
+// count is the size of the clustered light lists
+let benchmarkLightGridFill () =
+    let view = Math.Camera.lookAt (Vector3(0.f, 10.f, -30.f)) Vector3.Zero Vector3.UnitY
+    let random = System.Random(42)
+    let coord range = (float32 (random.NextDouble()) * 2.f - 1.f) * range
+
+    let allLights = Array.init 4096 (fun _ -> LightCullData(LightType.Point, Vector3(coord 40.f, coord 15.f, coord 40.f), 1.f + abs (coord 6.f)))
+
+    printfn "%12s %8s %12s %12s %12s %14s %14s %12s %14s %14s" "resolution" "lights" "frustum ms" "cone ms" "2.5D ms" "clustered ms" "lights/pixel" "2.5D l/p" "clustered l/p" "indices"
+
+    for width, height in [1280, 720; 1920, 1080; 2560, 1440] do
+        let projection = Math.Camera.projectionPerspective 1.f (float32 width / float32 height) 0.1f 1000.f
+        let viewDepth i =
+            let x, y = float32 (i % width) / float32 width, float32 (i / width) / float32 height
+            (if (i % width / 100 + i / width / 100) % 2 = 0 then 20.f else 60.f) + 10.f * sin (x * 30.f) * cos (y * 20.f)
+
+        let depth = Array.init (width * height) (fun i -> Matrix44.TransformPerspective(projection, Vector4(0.f, 0.f, viewDepth i, 1.f)).z)
+
+        // get average light count over the lists that pixels look up
+        let getPixelLightCount (grid: Grid) =
+            Array.init (width * height) (fun i ->
+                let slice = getDepthSlice grid.depth 1.f 1000.f (viewDepth i)
+                (getCellLights grid (i % width / LightGridLayout.cellSize) (i / width / LightGridLayout.cellSize) slice).Length)
+            |> Array.averageBy float
+
+        for count in [64; 256; 1024; 4096] do
+            let lights = Array.sub allLights 0 count
+            let run cullMethod depthMask depthSlices () = fill cullMethod depthMask depth width height view projection lights depthSlices 1.f 1000.f (1 <<< 24)
+
+            let tiled = run CullMethod.Cone false 1 ()
+            let masked = run CullMethod.Cone true 1 ()
+            let clustered = run CullMethod.Cone false 16 ()
+
+            printfn "%12s %8d %12.2f %12.2f %12.2f %14.2f %14.1f %12.1f %14.1f %14d" (sprintf "%dx%d" width height) count
+                (Core.Test.measure (run CullMethod.Frustum false 1)) (Core.Test.measure (run CullMethod.Cone false 1)) (Core.Test.measure (run CullMethod.Cone true 1)) (Core.Test.measure (run CullMethod.Cone false 16))
+                (getPixelLightCount tiled) (getPixelLightCount masked) (getPixelLightCount clustered) clustered.statistics.requestedIndices
+
+// shadow filters on a 1024x1024 shadow map with slanted edges and disks; the error is the RMS difference against the
+// lit fraction of a 2x2 texel box around the point, measured near shadow edges
+let benchmarkShadowFilters () =
+    let size = 1024
+    let nx, ny = cos 0.3f, sin 0.3f
+
+    let isOccluded (x: float32) (y: float32) =
+        x * nx + y * ny < 0.45f * float32 size * (nx + ny) ||
+        [| 800.f, 200.f, 40.f; 600.f, 800.f, 8.f; 900.f, 900.f, 2.f |] |> Array.exists (fun (cx, cy, r) -> (x - cx) * (x - cx) + (y - cy) * (y - cy) < r * r)
+
+    let map: ShadowFilterReference.ShadowMap =
+        { width = size; height = size
+          depth = Array.init (size * size) (fun i -> if isOccluded (float32 (i % size) + 0.5f) (float32 (i / size) + 0.5f) then 0.3f else 1.f) }
+
+    let reference (x: float32) (y: float32) =
+        Array.init 64 (fun i -> isOccluded (x - 1.f + (float32 (i % 8) + 0.5f) / 4.f) (y - 1.f + (float32 (i / 8) + 0.5f) / 4.f))
+        |> Array.averageBy (fun o -> if o then 0.f else 1.f)
+
+    let random = System.Random(42)
+    let samples = Array.init 1000000 (fun _ -> float32 (random.NextDouble()), float32 (random.NextDouble()))
+    let edges =
+        Array.init 1000000 (fun _ -> float32 (random.NextDouble()) * float32 size, float32 (random.NextDouble()) * float32 size)
+        |> Array.filter (fun (x, y) -> let r = reference x y in r > 0.f && r < 1.f)
+
+    printfn "%12s %10s %14s %12s" "filter" "samples" "ns/pixel" "edge error"
+
+    for filter in System.Enum.GetValues(typeof<ShadowFilter>) :?> ShadowFilter array do
+        let run () = samples |> Array.sumBy (fun (u, v) -> ShadowFilterReference.sampleShadowFiltered filter map u v 0.5f)
+
+        printfn "%12A %10d %14.1f %12.4f" filter (ShadowFilterReference.getSampleCount filter)
+            (Core.Test.measure run * 1e6 / float samples.Length) (ShadowFilterReference.getFilterError filter map 0.5f reference edges)
+
+// shadow atlas allocation over 1000 frames with synthetic light sets in a 4096x4096 atlas: 4 directional cascades and
+// spot lights with random sizes; each frame some spot lights are replaced and some change size; compares the number of
+// shadow maps that get their size with the row packer that packed the atlas from scratch every frame, and reports how
+// many shadow maps the cache has to render per frame because their regions changed, both with the changing light set
+// and after it stops changing
+let benchmarkShadowAtlas () =
+    let frames = 1000
+    let steadyFrames = 100
+
+    // row packer that the light data builder used before the atlas allocator; returns the number of placed maps
+    let packRows (sizes: int array) =
+        let mutable x, y, nexty, placed = 0, 0, 0, 0
+
+        for size in sizes do
+            if x + size > 4096 then
+                x <- 0
+                y <- nexty
+
+            if x + size <= 4096 && y + size <= 4096 then
+                nexty <- max nexty (y + size)
+                x <- x + size
+                placed <- placed + 1
+
+        placed
+
+    printfn "%8s %10s %12s %12s %12s %12s %14s %8s %12s %14s" "spots" "requested" "row packer" "full size" "smaller" "dropped" "renders/frame" "repacks" "us/frame" "steady renders"
+
+    for count in [16; 64; 128; 256] do
+        let random = System.Random(42)
+        let randomSize () = [| 128; 128; 128; 128; 256; 256; 256; 512; 512; 1024 |].[random.Next(10)]
+
+        let cache = ShadowCache(4096, 4096)
+        let spots = Array.init count (fun i -> i + 1, randomSize ())
+        let mutable nextKey = count + 1
+        let mutable packed, full, smaller, dropped, renders = 0, 0, 0, 0, 0
+        let timer = System.Diagnostics.Stopwatch()
+
+        // cascades first, then spot lights from large to small like the light data builder does
+        let getRequests () =
+            Array.append
+                (Array.init 4 (fun i -> (0, i), 1024, Matrix44.Identity))
+                (spots |> Array.sortBy (fun (key, size) -> -size, key) |> Array.map (fun (key, size) -> (key, 0), size, Matrix44.Identity))
+
+        for frame in 0 .. frames - 1 do
+            // replace 2% of the lights and resize 5%
+            for i in 0 .. count - 1 do
+                let r = random.Next(100)
+                if r < 2 then
+                    spots.[i] <- nextKey, randomSize ()
+                    nextKey <- nextKey + 1
+                elif r < 7 then
+                    spots.[i] <- fst spots.[i], randomSize ()
+
+            let requests = getRequests ()
+
+            timer.Start()
+            let regions = cache.Update(requests)
+            timer.Stop()
+
+            packed <- packed + packRows (requests |> Array.map (fun (_, size, _) -> size))
+
+            Array.iter2 (fun (_, size, _) region ->
+                match region with
+                | Some (_, _, s, dirty) ->
+                    if s = size then full <- full + 1 else smaller <- smaller + 1
+                    if dirty then renders <- renders + 1
+                | None -> dropped <- dropped + 1) requests regions
+
+        // the same lights with the same sizes keep their shadow maps
+        let steadyRenders =
+            let requests = getRequests ()
+
+            Array.init steadyFrames (fun _ -> cache.Update(requests) |> Array.sumBy (function Some (_, _, _, true) -> 1 | _ -> 0)) |> Array.sum
+
+        let average v = float v / float frames
+
+        printfn "%8d %10d %12.1f %12.1f %12.1f %12.1f %14.2f %8d %12.1f %14.2f" count (count + 4)
+            (average packed) (average full) (average smaller) (average dropped) (average renders) cache.Repacks (timer.Elapsed.TotalMilliseconds * 1000.0 / float frames)
+            (float steadyRenders / float steadyFrames)
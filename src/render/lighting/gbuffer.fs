@@ -0,0 +1,69 @@
+// CPU port of the G-buffer packing in gbuffer.h; produces the same bits as the render target formats, so it can be used
+// to check encoding precision
+module Render.Lighting.GBuffer
+
+// G-buffer contents; colors are linear
+type Data =
+    { albedo: Vector3
+      normal: Vector3
+      specular: Vector3
+      roughness: float32 }
+
+// gamma value; matches kGamma in gamma.h
+let private gammaValue = 2.2f
+
+// get sign of the value; unlike sign, returns 1 for 0
+let inline private signNotZero (v: float32) = if v >= 0.f then 1.f else -1.f
+
+// clamp value to [0..1]
+let inline private saturate (v: float32) = max 0.f (min 1.f v)
+
+// encode unit vector to [0..1]^2: project the vector on the octahedron and fold the lower half over the upper half
+let encodeOctahedral (n: Vector3) =
+    let n = n / (abs n.x + abs n.y + abs n.z)
+    let r = if n.z >= 0.f then n.xy else Vector2((1.f - abs n.y) * signNotZero n.x, (1.f - abs n.x) * signNotZero n.y)
+
+    r * 0.5f + Vector2(0.5f, 0.5f)
+
+let decodeOctahedral (e: Vector2) =
+    let e = e * 2.f - Vector2(1.f, 1.f)
+    let z = 1.f - abs e.x - abs e.y
+    let xy = if z < 0.f then Vector2((1.f - abs e.y) * signNotZero e.x, (1.f - abs e.x) * signNotZero e.y) else e
+
+    Vector3.Normalize(Vector3(xy.x, xy.y, z))
+
+// convert UNorm value to float
+let private unpackUNorm (value: uint32) bits =
+    float32 value / float32 ((1 <<< bits) - 1)
+
+// pack linear color and alpha to R8G8B8A8_UNorm; color is stored in gamma space
+let packColor (color: Vector3) alpha =
+    let inline channel v = Math.Pack.packFloatUNorm (saturate v ** (1.f / gammaValue)) 8
+
+    channel color.x ||| (channel color.y <<< 8) ||| (channel color.z <<< 16) ||| (Math.Pack.packFloatUNorm alpha 8 <<< 24)
+
+// unpack linear color and alpha from R8G8B8A8_UNorm
+let unpackColor (value: uint32) =
+    let inline channel shift = unpackUNorm ((value >>> shift) &&& 0xffu) 8
+
+    Vector3(channel 0 ** gammaValue, channel 8 ** gammaValue, channel 16 ** gammaValue), channel 24
+
+// pack unit vector to R16G16_UNorm
+let packNormal (normal: Vector3) =
+    let e = encodeOctahedral normal
+
+    Math.Pack.packFloatUNorm e.x 16 ||| (Math.Pack.packFloatUNorm e.y 16 <<< 16)
+
+// unpack unit vector from R16G16_UNorm
+let unpackNormal (value: uint32) =
+    decodeOctahedral (Vector2(unpackUNorm (value &&& 0xffffu) 16, unpackUNorm (value >>> 16) 16))
+
+// pack G-buffer data to the render target values; same as packGBuffer
+let pack (data: Data) =
+    packColor data.albedo data.roughness, packNormal data.normal, packColor data.specular 0.f
+
+// unpack G-buffer data from the render target values; same as unpackGBuffer
+let unpack (albedo, normal, specular) =
+    let albedoColor, roughness = unpackColor albedo
+
+    { albedo = albedoColor; normal = unpackNormal normal; specular = fst (unpackColor specular); roughness = roughness }
@@ -8,18 +8,41 @@ type LightType =
     | Point = 1
     | Spot = 2
 
+// light list category; light grid lists are partitioned by category, so that shading loops are specialized for the
+// light type and do not sample shadow maps for lights without shadows; point light shadows are not supported
 [<ShaderStruct>]
-type LightCullData(typ: LightType, position: Vector3, radius: float32) =
+type LightCategory =
+    | Directional = 0
+    | DirectionalShadowed = 1
+    | Point = 2
+    | Spot = 3
+    | SpotShadowed = 4
+
+[<ShaderStruct>]
+type LightCullData(typ: LightType, position: Vector3, radius: float32, shadowed: bool) =
+    new (typ, position, radius) = LightCullData(typ, position, radius, false)
+
     member this.Type = typ
     member this.Position = position
     member this.Radius = radius
+    member this.Shadowed = shadowed
+
+// shadow map filter kernel; matches sampleShadowFiltered in shadowmap.h
+[<ShaderStruct>]
+type ShadowFilter =
+    | Single = 0 // 1 bilinear comparison
+    | FXAA = 1 // 5 comparisons, 7 on shadow edges
+    | Poisson4 = 2 // 4 comparisons
+    | Poisson8 = 3 // 8 comparisons
+    | PCF3x3 = 4 // 9 comparisons
 
 [<ShaderStruct>]
-type LightShadowCascade(transformScale: Vector2, transformOffset: Vector2, atlasScale: Vector2, atlasOffset: Vector2) =
+type LightShadowCascade(transformScale: Vector2, transformOffset: Vector2, atlasScale: Vector2, atlasOffset: Vector2, filter: ShadowFilter) =
     member this.TransformScale = transformScale
     member this.TransformOffset = transformOffset
     member this.AtlasScale = atlasScale
     member this.AtlasOffset = atlasOffset
+    member this.Filter = filter
 
 [<ShaderStruct>]
 type LightShadowData(transform: Matrix44, cascadeDistances: Vector4, cascadeInfo: LightShadowCascade array) =
@@ -1,31 +1,11 @@
 module Render.Lighting.LightDataBuilder
 
-// utility class for dumb rectangle packing
-type private RectPacker(maxWidth, maxHeight) =
-    let mutable x = 0
-    let mutable y = 0
-    let mutable nexty = 0
-
-    member this.Pack(width, height) =
-        // switch to next line
-        if x + width > maxWidth then
-            x <- 0
-            y <- nexty
-
-        // check if the rectangle fits in both dimensions
-        if x + width <= maxWidth && y + height <= maxHeight then
-            nexty <- max nexty (y + height)
-            x <- x + width
-            Some (x - width, y)
-        else
-            None
-
 // get cull data for a light
-let private getCullData light =
+let private getCullData light shadowed =
     match light with
-    | DirectionalLight l -> LightCullData(LightType.Directional, Vector3.Zero, 0.f)
-    | PointLight l -> LightCullData(LightType.Point, l.position, l.radius)
-    | SpotLight l -> LightCullData(LightType.Spot, l.position, l.radius)
+    | DirectionalLight l -> LightCullData(LightType.Directional, Vector3.Zero, 0.f, shadowed)
+    | PointLight l -> LightCullData(LightType.Point, l.position, l.radius, false)
+    | SpotLight l -> LightCullData(LightType.Spot, l.position, l.radius, shadowed)
 
 // get clip-space z
 let private getClipZ projection z =
@@ -79,6 +59,10 @@ let private getStableBoundingSphere view projection znear zfar smView smSize =
 
     let sphereRadius, sphereCenter = getBoundingSphereWithCenterOnSegment pointsCenterBeg pointsCenterEnd pointsView
 
+    // round the radius up to 8 significant bits, so that the sphere does not change with the camera orientation
+    let radiusStep = 2.f ** (floor (log (float32 sphereRadius) / log 2.f) - 8.f)
+    let sphereRadius = ceil (sphereRadius / radiusStep) * radiusStep
+
     let texsize = sphereRadius * 2.f / float32 smSize
     let roundtex v = round (v / texsize) * texsize
 
@@ -95,7 +79,21 @@ let private getSplitDistance znear zfar llcoeff split splitCount =
 
 let dbgCascadeCoeff = Core.DbgVar(0.2f, "shadows/cascade split coeff")
 
-// get shadow data for a light
+// shadow filters; distant cascades cover more of the scene per texel, so they do not need wide kernels
+let dbgCascadeFilters =
+    [| ShadowFilter.Poisson8; ShadowFilter.FXAA; ShadowFilter.Poisson4; ShadowFilter.Single |]
+    |> Array.mapi (fun i filter -> Core.DbgVar(filter, sprintf "shadows/cascade %d filter" i))
+
+let dbgSpotFilter = Core.DbgVar(ShadowFilter.Poisson8, "shadows/spot filter")
+
+// get shadow map size for a light with the specified importance; sizes are powers of two, so that regions of freed
+// shadow maps can be reused by shadow maps of other sizes
+let private getShadowSize importance =
+    let size = 2.f ** round (log (1024.f * importance) / log 2.f)
+    int (min 1024.f (max (float32 ShadowCache.MinSize) size))
+
+// get shadow data for a light; returns shadow map size, transform, cascades and importance, which is the priority
+// for atlas space
 let private getShadowData light eyeView eyeProjection =
     match light with
     | DirectionalLight l ->
@@ -106,7 +104,12 @@ let private getShadowData light eyeView eyeProjection =
 
         let view = Math.Camera.lookAt Vector3.Zero l.direction (if abs l.direction.x < 0.7f then Vector3.UnitX else Vector3.UnitY)
         let tr, tc = getStableBoundingSphere eyeView eyeProjection znear zfar view smSize
-        let proj = Math.Camera.projectionOrthoOffCenter (tc.x - tr) (tc.x + tr) (tc.y - tr) (tc.y + tr) (tc.z - tr) (tc.z + tr)
+
+        // cascades share the depth range; snap it coarsely and pad it by a step, so that camera movement rarely changes
+        // the depth of cached cascades
+        let zstep = tr / 8.f
+        let zc = round (tc.z / zstep) * zstep
+        let proj = Math.Camera.projectionOrthoOffCenter (tc.x - tr) (tc.x + tr) (tc.y - tr) (tc.y + tr) (zc - tr - zstep) (zc + tr + zstep)
 
         let cascades =
             Array.init splits (fun split ->
@@ -114,15 +117,20 @@ let private getShadowData light eyeView eyeProjection =
                 let cfar = getSplitDistance znear zfar dbgCascadeCoeff.Value (split + 1) splits
                 let r, c = getStableBoundingSphere eyeView eyeProjection cnear cfar view smSize
 
-                cfar, Vector2(tr / r, tr / r), (tc.xy - c.xy) / r)
+                cfar, Vector2(tr / r, tr / r), (tc.xy - c.xy) / r, dbgCascadeFilters.[min split (dbgCascadeFilters.Length - 1)].Value)
 
-        Some (smSize, (proj * Matrix44(view)), cascades)
+        Some (smSize, (proj * Matrix44(view)), cascades, infinityf)
     | PointLight l ->
         None
     | SpotLight l ->
         let view = Math.Camera.lookAt l.position (l.position + l.direction) (if abs l.direction.x < 0.7f then Vector3.UnitX else Vector3.UnitY)
         let proj = Math.Camera.projectionPerspective (l.outerAngle * 2.f) 1.f 0.01f l.radius
-        Some (512, (proj * Matrix44(view)), [|0.f, Vector2(1.f, 1.f), Vector2.Zero|])
+
+        // lights that are larger on screen need more texels; the importance is 1 when the camera is inside the light
+        let eye = Matrix34.InverseAffine(eyeView).Column 3
+        let importance = l.radius / max l.radius (eye - l.position).Length
+
+        Some (getShadowSize importance, (proj * Matrix44(view)), [|0.f, Vector2(1.f, 1.f), Vector2.Zero, dbgSpotFilter.Value|], importance)
 
 // get render data for a light
 let private getRenderData light shadow =
@@ -131,36 +139,72 @@ let private getRenderData light shadow =
     | PointLight l -> LightData(LightType.Point, l.position, Vector3.Zero, l.radius, 0.f, 0.f, l.color, l.intensity, shadow)
     | SpotLight l -> LightData(LightType.Spot, l.position, l.direction, l.radius, cos l.outerAngle, cos l.innerAngle, l.color, l.intensity, shadow)
 
-// build light data
-let build lights shadowAtlasWidth shadowAtlasHeight view projection =
-    // get culling info
-    let cullData = lights |> Array.map getCullData
+// shadow map that needs to be rendered; the viewport is in atlas texels
+type ShadowMapUpdate =
+    { transform: Matrix44
+      x: int
+      y: int
+      size: int }
 
-    // get shadowing info
-    let packer = RectPacker(shadowAtlasWidth, shadowAtlasHeight)
+// build light data; shadow maps are allocated in the cache, and only the shadow maps that are not in the cache are
+// returned for rendering
+let build (cache: ShadowCache) lights view projection =
+    let shadowAtlasWidth, shadowAtlasHeight = cache.Width, cache.Height
 
-    let shadowCascadeDummy = LightShadowCascade(Vector2.Zero, Vector2.Zero, Vector2.Zero, Vector2.Zero)
+    let shadowCascadeDummy = LightShadowCascade(Vector2.Zero, Vector2.Zero, Vector2.Zero, Vector2.Zero, ShadowFilter.Single)
     let shadowDataDummy = LightShadowData(Matrix44.Identity, Vector4(infinityf, infinityf, infinityf, infinityf), [|shadowCascadeDummy|])
+    let shadows = lights |> Array.map (fun l -> getShadowData l view projection)
+
+    // get cascade transforms; cascades are rendered with the shared light transform, scaled and offset to the cascade
+    let getCascadeTransform matrix (transformScale: Vector2) (transformOffset: Vector2) =
+        Matrix44(Matrix34.Translation(Vector3(transformOffset, 0.f)) * Matrix34.Scaling(Vector3(transformScale, 1.f))) * matrix
+
+    // allocate shadow maps in the order of importance, so that the important lights get atlas space first
+    let requests =
+        shadows
+        |> Array.mapi (fun light shadow ->
+            match shadow with
+            | Some (size, matrix, cascades, importance) ->
+                cascades |> Array.mapi (fun cascade (_, transformScale, transformOffset, _) ->
+                    importance, ((light, cascade), size, getCascadeTransform matrix transformScale transformOffset))
+            | None -> [||])
+        |> Array.concat
+        |> Array.sortBy (fun (importance, (key, _, _)) -> -importance, key)
+        |> Array.map snd
+
+    let regions = Array.zip requests (cache.Update requests) |> Array.map (fun ((key, _, _), region) -> key, region) |> dict
+
+    // get shadowing info
     let shadowData =
-        lights
-        |> Array.map (fun l -> getShadowData l view projection)
-        |> Array.map (function
-            | Some (size, matrix, cascades) ->
+        shadows
+        |> Array.mapi (fun light shadow ->
+            match shadow with
+            | Some (_, matrix, cascades, _) ->
                 let cascadeInfo =
-                    cascades |> Array.map (fun (distance, transformScale, transformOffset) ->
-                        match packer.Pack(size, size) with
-                        | Some (x, y) ->
+                    cascades |> Array.mapi (fun cascade (distance, transformScale, transformOffset, filter) ->
+                        match regions.[(light, cascade)] with
+                        | Some (x, y, size, _) ->
                             let offset = Vector2(float32 x / float32 shadowAtlasWidth, float32 y / float32 shadowAtlasHeight)
                             let scale = Vector2(float32 size / float32 shadowAtlasWidth, float32 size / float32 shadowAtlasHeight)
-                            distance, LightShadowCascade(transformScale, transformOffset, scale, offset)
+                            distance, LightShadowCascade(transformScale, transformOffset, scale, offset, filter)
                         | None -> infinityf, shadowCascadeDummy)
 
                 let dist i = if i < cascadeInfo.Length then fst cascadeInfo.[i] else infinityf
                 LightShadowData(matrix, Vector4(dist 0, dist 1, dist 2, dist 3), cascadeInfo |> Array.map snd)
             | None -> shadowDataDummy)
 
+    // get shadow maps to render
+    let updates =
+        requests |> Array.choose (fun (key, _, transform) ->
+            match regions.[key] with
+            | Some (x, y, size, true) -> Some { transform = transform; x = x; y = y; size = size }
+            | _ -> None)
+
+    // get culling info; lights are shadowed if the first cascade fits in the atlas
+    let cullData = Array.map2 (fun light (shadow: LightShadowData) -> getCullData light (shadow.CascadeDistances.x < infinityf)) lights shadowData
+
     // get render info
     let lightData = Array.map2 getRenderData lights shadowData
 
     // return everything
-    cullData, lightData
+    cullData, lightData, updates
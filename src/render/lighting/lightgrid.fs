@@ -4,45 +4,123 @@ open SharpDX.Direct3D11
 
 open Render
 
-// light grid with an array of 2-byte light indices per tile
+// light grid with a light list per cell; cells are 16x16 pixel tiles, optionally subdivided into depth slices that are
+// distributed logarithmically between depthNear and depthFar (a grid with one slice is a 2D grid)
+// each cell has an offset into the shared buffer with 2-byte light indices and a 16-bit light count per LightCategory;
+// the category lists are stored one after another in category order (offset, counts 0|1, counts 2|3, count 4); the fill
+// shader allocates index ranges with an atomic counter, so memory depends on the total light count rather than on the
+// worst cell; lists are truncated if the index buffer is full, starting from the last category
 [<ShaderStruct>]
-type LightGrid(device: Device, widthPixels, heightPixels, maxLightsPerTile) =
-    static let cellSize = 16 // cell size is a fixed value because of CS restrictions
+type LightGrid(device: Device, widthPixels, heightPixels, depthSlices, depthNear: float32, depthFar: float32, indexCapacity) =
+    static let cellSize = LightGridLayout.cellSize
+    static let maxDepth = LightGridLayout.maxDepth
+    static let categories = LightGridLayout.categories
+    static let readbackLatency = 3 // statistics are read back with a delay of several frames to avoid stalls
+
+    do if depthSlices < 1 || depthSlices > maxDepth then invalidArg "depthSlices" "Depth slice count is out of range"
 
     let width = (widthPixels + cellSize - 1) / cellSize
     let height = (heightPixels + cellSize - 1) / cellSize
 
-    let format = Format.R16_UInt
+    let depthScale, depthBias = LightGrid.GetDepthScaleBias(depthSlices, depthNear, depthFar)
+
+    // create typed buffer with shader resource and unordered access views
+    let createBuffer (format: Format) count =
+        let buffer =
+            new Buffer(device.Device, Formats.getSizeBits format / 8 * count, ResourceUsage.Default, BindFlags.UnorderedAccess ||| BindFlags.ShaderResource,
+                CpuAccessFlags.None, ResourceOptionFlags.None, 0)
+
+        let view =
+            new ShaderResourceView(device.Device, buffer,
+                ShaderResourceViewDescription(Format = format, Dimension = ShaderResourceViewDimension.Buffer, Buffer =
+                    ShaderResourceViewDescription.BufferResource(ElementCount = count)))
+
+        let uaView =
+            new UnorderedAccessView(device.Device, buffer,
+                UnorderedAccessViewDescription(Format = format, Dimension = UnorderedAccessViewDimension.Buffer, Buffer =
+                    UnorderedAccessViewDescription.BufferResource(ElementCount = count)))
+
+        buffer, view, uaView
 
-    let indexSize = Formats.getSizeBits format / 8
-    let indexCount = width * height * maxLightsPerTile
+    let _, cellView, cellUAView = createBuffer Format.R32G32B32A32_UInt (width * height * depthSlices)
+    let _, indexView, indexUAView = createBuffer Format.R16_UInt indexCapacity
 
-    let buffer =
-        new Buffer(device.Device, indexSize * indexCount, ResourceUsage.Default, BindFlags.UnorderedAccess ||| BindFlags.ShaderResource,
-            CpuAccessFlags.None, ResourceOptionFlags.None, 0)
+    // allocation counter: requested index count, truncated cell count
+    let counter, _, counterUAView = createBuffer Format.R32_UInt 2
 
-    let view =
-        new ShaderResourceView(device.Device, buffer,
-            ShaderResourceViewDescription(Format = format, Dimension = ShaderResourceViewDimension.Buffer, Buffer =
-                ShaderResourceViewDescription.BufferResource(ElementCount = indexCount)))
+    // debug counter per tile: number of lights rejected by the depth mask
+    let _, debugView, debugUAView = createBuffer Format.R32_UInt (width * height)
 
-    let uaView =
-        new UnorderedAccessView(device.Device, buffer,
-            UnorderedAccessViewDescription(Format = format, Dimension = UnorderedAccessViewDimension.Buffer, Buffer =
-                UnorderedAccessViewDescription.BufferResource(ElementCount = indexCount)))
+    let readback =
+        Array.init readbackLatency (fun _ ->
+            new Buffer(device.Device, 8, ResourceUsage.Staging, BindFlags.None, CpuAccessFlags.Read, ResourceOptionFlags.None, 0))
+
+    let mutable frame = 0
+    let mutable statistics = { requestedIndices = 0; indexCapacity = indexCapacity; truncatedCells = 0 }
+
+    // 2D grid
+    new (device, widthPixels, heightPixels, indexCapacity) = LightGrid(device, widthPixels, heightPixels, 1, 1.f, 1.f, indexCapacity)
+
+    // get depth slice parameters; slice index for view-space depth z is floor(log2(z) * scale + bias), clamped to the
+    // slice range
+    static member GetDepthScaleBias(depthSlices, depthNear: float32, depthFar: float32) =
+        LightGridLayout.getDepthScaleBias depthSlices depthNear depthFar
 
     // get grid dimensions
     static member CellSize = cellSize
+    static member MaxDepth = maxDepth
+
+    // get light category count
+    static member Categories = categories
 
     member this.Width = width
     member this.Height = height
-    member this.TileSize = maxLightsPerTile
+    member this.Depth = depthSlices
+
+    // get depth slice parameters
+    member this.DepthScale = depthScale
+    member this.DepthBias = depthBias
+
+    // get grid stride in cells
+    member this.Stride = width
+
+    // get depth slice stride in cells
+    member this.SliceStride = width * height
+
+    // get index buffer size
+    member this.IndexCapacity = indexCapacity
+
+    // get read-only views
+    member this.CellView = cellView
+    member this.IndexView = indexView
+    member this.DebugView = debugView
+
+    // get unordered views
+    member this.CellUnorderedView = cellUAView
+    member this.IndexUnorderedView = indexUAView
+    member this.CounterUnorderedView = counterUAView
+    member this.DebugUnorderedView = debugUAView
+
+    // get the latest statistics that were read back
+    member this.Statistics = statistics
+
+    // reset allocation counter; has to be called before the fill
+    member this.Reset(context: DeviceContext) =
+        context.UpdateSubresource([| 0; 0 |], counter, 0, 0, 0)
+
+    // copy allocation counter for readback and read statistics from an earlier frame; has to be called after the fill
+    member this.UpdateStatistics(context: DeviceContext) =
+        context.CopyResource(counter, readback.[frame % readbackLatency])
+        frame <- frame + 1
 
-    // get grid stride in elements
-    member this.Stride = width * maxLightsPerTile
+        if frame >= readbackLatency then
+            let buffer = readback.[frame % readbackLatency]
+            let data = context.MapSubresource(buffer, 0, MapMode.Read, MapFlags.None)
 
-    // get read-only view
-    member this.View = view
+            try
+                let requested = System.Runtime.InteropServices.Marshal.ReadInt32(data.DataPointer)
+                let truncated = System.Runtime.InteropServices.Marshal.ReadInt32(data.DataPointer, 4)
 
-    // get unordered view
-    member this.UnorderedView = uaView
\ No newline at end of file
+                statistics <- { requestedIndices = requested; indexCapacity = indexCapacity; truncatedCells = truncated }
+            finally
+                context.UnmapSubresource(buffer, 0)
@@ -0,0 +1,30 @@
+namespace Render.Lighting
+
+// light list statistics from the GPU
+type LightGridStatistics =
+    { // number of indices that the lists needed; lights are dropped if it exceeds the capacity
+      requestedIndices: int
+      indexCapacity: int
+      // number of lists that were truncated
+      truncatedCells: int }
+
+// light grid layout parameters; LightGrid and the CPU reference share them, and the reference does not depend on the
+// Direct3D types through them
+module LightGridLayout =
+    // cell size is a fixed value because of CS restrictions
+    let cellSize = 16
+
+    // slice count is limited by group shared memory in CS
+    let maxDepth = 32
+
+    // light category count
+    let categories = System.Enum.GetValues(typeof<LightCategory>).Length
+
+    // get depth slice parameters; slice index for view-space depth z is floor(log2(z) * scale + bias), clamped to the
+    // slice range
+    let getDepthScaleBias depthSlices (depthNear: float32) (depthFar: float32) =
+        if depthSlices = 1 then
+            0.f, 0.f
+        else
+            let scale = float32 depthSlices / (log (depthFar / depthNear) / log 2.f)
+            scale, -(log depthNear / log 2.f) * scale
@@ -0,0 +1,370 @@
+// CPU port of lightgrid_fill.hlsl; produces the same index layout as LightGrid, so it can be used to validate
+// GPU output and to experiment with culling changes on machines without a GPU
+module Render.Lighting.LightGridReference
+
+open System.Threading
+open System.Threading.Tasks
+
+// culling method; matches CULL_METHOD in lightgrid_fill.hlsl
+type CullMethod =
+    | Frustum = 0
+    | Cone = 1
+
+// light grid contents in LightGrid layout
+type Grid =
+    { width: int
+      height: int
+      depth: int
+      // offset and light counts per category for each cell (cellStride values); cells are stored slice by slice, each
+      // slice is a 2D grid; category lists of the cell are stored one after another in category order
+      cells: int array
+      // light indices (0-based)
+      indices: uint16 array
+      // number of lights rejected by the depth mask per tile
+      rejected: int array
+      statistics: LightGridStatistics }
+
+// number of values per cell in Grid.cells
+let cellStride = 1 + LightGridLayout.categories
+
+// get light list category; matches getLightCategory in lightgrid.h
+let getLightCategory (light: LightCullData) =
+    match light.Type with
+    | LightType.Directional -> if light.Shadowed then LightCategory.DirectionalShadowed else LightCategory.Directional
+    | LightType.Spot -> if light.Shadowed then LightCategory.SpotShadowed else LightCategory.Spot
+    | _ -> LightCategory.Point
+
+// get grid dimensions in tiles for the specified dimensions in pixels
+let getGridSize width height =
+    let cellSize = LightGridLayout.cellSize
+    (width + cellSize - 1) / cellSize, (height + cellSize - 1) / cellSize
+
+// get depth slice index for the view-space depth; matches getLightGridSlice in lightgrid.h
+let getDepthSlice depthSlices depthNear depthFar (z: float32) =
+    let scale, bias = LightGridLayout.getDepthScaleBias depthSlices depthNear depthFar
+    max 0 (min (depthSlices - 1) (int (floor (log (max z 1e-10f) / log 2.f * scale + bias))))
+
+// depth mask bin count; the mask is a 32-bit value in the shader
+let private maskBins = 32
+
+// get depth mask bin index for the view-space depth
+let private getDepthMaskBin (zmin: float32) (zmax: float32) (z: float32) =
+    max 0 (min (maskBins - 1) (int ((z - zmin) / max (zmax - zmin) 1e-6f * float32 maskBins)))
+
+// lights are culled in batches of one light per shader thread; each batch has a visibility bitmask per depth slice
+let private batchSize = LightGridLayout.cellSize * LightGridLayout.cellSize
+let private batchWords = batchSize / 32
+
+// get number of set bits; same as countbits in the shader
+let private countBits (v: uint32) =
+    let v = v - ((v >>> 1) &&& 0x55555555u)
+    let v = (v &&& 0x33333333u) + ((v >>> 2) &&& 0x33333333u)
+    int ((((v + (v >>> 4)) &&& 0x0f0f0f0fu) * 0x01010101u) >>> 24)
+
+// model of the list compaction in lightgrid_fill.hlsl; there is a list per depth slice and category, with index
+// slice * LightGridLayout.categories + category; ranges are (first slice, last slice, category) per light, and culled lights
+// have empty slice ranges; for each batch, the list masks are built and every light gets its position in each list
+// from the exclusive prefix sum of the mask bit counts, so lists are sorted by light index
+// emit is called with (list, position, light index); returns light counts per list
+let compactLists depthSlices (ranges: (int * int * LightCategory) array) (emit: int -> int -> int -> unit) =
+    let categories = LightGridLayout.categories
+    let listCount = depthSlices * categories
+    let counts = Array.zeroCreate listCount
+    let masks = Array.zeroCreate (listCount * batchWords)
+    let prefix = Array.zeroCreate (listCount * batchWords)
+
+    for batch in 0 .. batchSize .. ranges.Length - 1 do
+        let size = min batchSize (ranges.Length - batch)
+
+        // build list masks; the shader builds each word in a separate thread, the result is the same
+        System.Array.Clear(masks, 0, masks.Length)
+
+        for t in 0 .. size - 1 do
+            let first, last, category = ranges.[batch + t]
+
+            for slice in first .. last do
+                let k = (slice * categories + int category) * batchWords + t / 32
+                masks.[k] <- masks.[k] ||| (1u <<< (t % 32))
+
+        // compute exclusive prefix sums of the bit counts within each list
+        for list in 0 .. listCount - 1 do
+            let mutable sum = 0
+
+            for word in 0 .. batchWords - 1 do
+                prefix.[list * batchWords + word] <- sum
+                sum <- sum + countBits masks.[list * batchWords + word]
+
+        // emit lights at the positions that follow the lists of the previous batches
+        for t in 0 .. size - 1 do
+            let first, last, category = ranges.[batch + t]
+
+            for slice in first .. last do
+                let list = slice * categories + int category
+                let k = list * batchWords + t / 32
+                emit list (counts.[list] + prefix.[k] + countBits (masks.[k] &&& ((1u <<< (t % 32)) - 1u))) (batch + t)
+
+        for list in 0 .. listCount - 1 do
+            let last = list * batchWords + batchWords - 1
+            counts.[list] <- counts.[list] + prefix.[last] + countBits masks.[last]
+
+    counts
+
+// get world position from the screen-space position (0..1 with y pointing down) and the depth buffer value
+let inline private getWorldPosition (viewProjectionInverse: Matrix44) (x: float32) (y: float32) (z: float32) =
+    Matrix44.TransformPerspective(viewProjectionInverse, Vector4(x * 2.f - 1.f, 1.f - 2.f * y, z, 1.f))
+
+// get view-projection matrix that maps the tile region with the specified depth range to the clip space
+let private getTileFrustum (viewProjection: Matrix44) width height x y (zmin: float32) (zmax: float32) =
+    let cellSize = float32 LightGridLayout.cellSize
+    let zscale = 1.f / (zmax - zmin + 1e-10f)
+
+    let crop =
+        Matrix44(width / cellSize, 0.f, 0.f, -float32 x,
+                 0.f, height / cellSize, 0.f, -float32 y,
+                 0.f, 0.f, zscale, -zmin * zscale,
+                 0.f, 0.f, 0.f, 1.f)
+
+    let toClip = Matrix44(2.f, 0.f, 0.f, -1.f, 0.f, -2.f, 0.f, 1.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f)
+    let toScreen = Matrix44(0.5f, 0.f, 0.f, 0.5f, 0.f, -0.5f, 0.f, 0.5f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f)
+
+    toClip * crop * toScreen * viewProjection
+
+// get normalized frustum planes in the same order as the shader; planes are flattened to xyzw values
+let private getFrustumPlanes (frustum: Matrix44) =
+    let normalize (p: Vector4) = p / p.xyz.Length
+
+    [| normalize (frustum.row3 - frustum.row0)
+       normalize (frustum.row3 + frustum.row0)
+       normalize (frustum.row3 - frustum.row1)
+       normalize (frustum.row3 + frustum.row1)
+       normalize frustum.row2
+       normalize (frustum.row3 - frustum.row2) |]
+    |> Array.collect (fun p -> [| p.x; p.y; p.z; p.w |])
+
+// fill light grid from the depth buffer (row-major, width * height values) and the camera matrices
+// tiles allocate index ranges from the shared index buffer in arbitrary order, like on the GPU, so cell offsets differ
+// between runs; lists are truncated if the index buffer is full
+// lists are compacted with the same batch prefix sums as on the GPU, so they are sorted by light index and match the GPU
+// lists exactly
+// depthMask enables 2.5D culling (CULL_DEPTH_MASK in the shader): the tile depth range is split into 32 bins, and the
+// lights that do not overlap bins with pixels are rejected
+let fill (cullMethod: CullMethod) (depthMask: bool) (depth: float32 array) width height (view: Matrix34) (projection: Matrix44) (lights: LightCullData array) depthSlices depthNear depthFar indexCapacity =
+    if depth.Length <> width * height then invalidArg "depth" "Depth buffer size does not match the dimensions"
+    if depthSlices < 1 || depthSlices > LightGridLayout.maxDepth then invalidArg "depthSlices" "Depth slice count is out of range"
+    if lights.Length > 65535 then invalidArg "lights" "Light count is out of range"
+
+    let cellSize = LightGridLayout.cellSize
+    let gridWidth, gridHeight = getGridSize width height
+    let sliceStride = gridWidth * gridHeight
+
+    let viewProjection = projection * Matrix44(view)
+    let viewProjectionInverse = Matrix44.Inverse(viewProjection)
+    let origin = Matrix34.InverseAffine(view).Column 3
+
+    // light data in structure-of-arrays layout so that the cull loops read each field sequentially
+    let lightCount = lights.Length
+    let lightDirectional = lights |> Array.map (fun l -> l.Type = LightType.Directional)
+    let lightX = lights |> Array.map (fun l -> l.Position.x)
+    let lightY = lights |> Array.map (fun l -> l.Position.y)
+    let lightZ = lights |> Array.map (fun l -> l.Position.z)
+    let lightRadius = lights |> Array.map (fun l -> l.Radius)
+
+    // get view-space depth, depth slice range and category for each light
+    let lightViewZ = lights |> Array.map (fun l -> Vector4.Dot(view.row2, Vector4(l.Position, 1.f)))
+    let lightSlices =
+        lights |> Array.mapi (fun i l ->
+            if l.Type = LightType.Directional then
+                0, depthSlices - 1, getLightCategory l
+            else
+                let z = lightViewZ.[i]
+                getDepthSlice depthSlices depthNear depthFar (z - l.Radius), getDepthSlice depthSlices depthNear depthFar (z + l.Radius), getLightCategory l)
+
+    // get view-space depth from the depth buffer value; same as getViewSpaceZ in the shader
+    let getViewSpaceZ (depth: float32) = projection.row2.w / (depth - projection.row2.z)
+
+    // same as getWorldPosition; the matrix is copied to locals because the pixel loop is dominated by struct copies otherwise
+    let m = viewProjectionInverse
+    let m00, m01, m02, m03 = m.row0.x, m.row0.y, m.row0.z, m.row0.w
+    let m10, m11, m12, m13 = m.row1.x, m.row1.y, m.row1.z, m.row1.w
+    let m20, m21, m22, m23 = m.row2.x, m.row2.y, m.row2.z, m.row2.w
+    let m30, m31, m32, m33 = m.row3.x, m.row3.y, m.row3.z, m.row3.w
+
+    let inline getWorldPositionFast x y z =
+        let cx, cy = x * 2.f - 1.f, 1.f - 2.f * y
+        let w = cx * m30 + cy * m31 + z * m32 + m33
+        Vector3((cx * m00 + cy * m01 + z * m02 + m03) / w, (cx * m10 + cy * m11 + z * m12 + m13) / w, (cx * m20 + cy * m21 + z * m22 + m23) / w)
+
+    let cells = Array.zeroCreate (sliceStride * depthSlices * cellStride)
+    let rejected = Array.zeroCreate sliceStride
+    let indices = Array.zeroCreate indexCapacity
+
+    // allocation counters
+    let requested = ref 0
+    let truncated = ref 0
+
+    // get depth mask for the pixel rectangle: view-space depth range and occupied bits; pixels at the far plane do not
+    // receive lighting, so they are not included
+    let getDepthMask x0 y0 x1 y1 =
+        let mutable zmin = System.Single.MaxValue
+        let mutable zmax = 0.f
+        let mutable mask = 0u
+
+        for y in y0 .. y1 - 1 do
+            for x in x0 .. x1 - 1 do
+                let d = depth.[y * width + x]
+
+                if d < 1.f then
+                    let z = getViewSpaceZ d
+                    zmin <- min zmin z
+                    zmax <- max zmax z
+
+        for y in y0 .. y1 - 1 do
+            for x in x0 .. x1 - 1 do
+                let d = depth.[y * width + x]
+
+                if d < 1.f then
+                    mask <- mask ||| (1u <<< getDepthMaskBin zmin zmax (getViewSpaceZ d))
+
+        zmin, zmax, mask
+
+    let fillTile tx ty =
+        let x0, y0 = tx * cellSize, ty * cellSize
+        let x1, y1 = min width (x0 + cellSize), min height (y0 + cellSize)
+
+        let maskMin, maskMax, mask = if depthMask then getDepthMask x0 y0 x1 y1 else 0.f, 0.f, 0u
+
+        // check if the light depth extent overlaps occupied bins
+        let isInDepthMask i =
+            let z, r = lightViewZ.[i], lightRadius.[i]
+
+            if z + r < maskMin || z - r > maskMax then
+                false
+            else
+                let first = getDepthMaskBin maskMin maskMax (z - r)
+                let last = getDepthMaskBin maskMin maskMax (z + r)
+
+                mask &&& (0xffffffffu >>> (31 - last)) &&& (0xffffffffu <<< first) <> 0u
+
+        // depth slice ranges and categories of visible lights; culled lights have empty ranges
+        let ranges = Array.create lightCount (0, -1, LightCategory.Directional)
+        let rejects = ref 0
+
+        // add the light that passed the volume test
+        let add i =
+            if not depthMask || lightDirectional.[i] || isInDepthMask i then
+                ranges.[i] <- lightSlices.[i]
+            else
+                incr rejects
+
+        match cullMethod with
+        | CullMethod.Frustum ->
+            // compute z range; the initial values match the group shared variable initialization
+            let mutable zmin = System.Single.MaxValue
+            let mutable zmax = 0.f
+
+            for y in y0 .. y1 - 1 do
+                for x in x0 .. x1 - 1 do
+                    let z = depth.[y * width + x]
+                    zmin <- min zmin z
+                    zmax <- max zmax z
+
+            let planes = getFrustumPlanes (getTileFrustum viewProjection (float32 width) (float32 height) tx ty zmin zmax)
+
+            for i in 0 .. lightCount - 1 do
+                let x, y, z, r = lightX.[i], lightY.[i], lightZ.[i], lightRadius.[i]
+                let inline outside p = planes.[p] * x + planes.[p + 1] * y + planes.[p + 2] * z + planes.[p + 3] < -r
+
+                if lightDirectional.[i] || not (outside 0 || outside 4 || outside 8 || outside 12 || outside 16 || outside 20) then
+                    add i
+
+        | CullMethod.Cone ->
+            // compute cone axis through the tile center
+            let center = getWorldPosition viewProjectionInverse ((float32 tx + 0.5f) * float32 cellSize / float32 width) ((float32 ty + 0.5f) * float32 cellSize / float32 height) 1.f
+            let direction = Vector3.Normalize(center - origin)
+
+            // compute axis range and section radius; points in front of the camera have positive t, so float min/max
+            // are equivalent to the integer min/max on float bits that the shader uses
+            let mutable tmin = System.Single.MaxValue
+            let mutable tmax = 0.f
+            let mutable radius = 0.f
+
+            for y in y0 .. y1 - 1 do
+                for x in x0 .. x1 - 1 do
+                    let p = getWorldPositionFast ((float32 x + 0.5f) / float32 width) ((float32 y + 0.5f) / float32 height) depth.[y * width + x]
+                    let t = Vector3.Dot(p - origin, direction)
+                    let u = (origin + t * direction - p).Length / t
+
+                    tmin <- min tmin t
+                    tmax <- max tmax t
+                    radius <- max radius u
+
+            let scale = sqrt (1.f - radius * radius)
+
+            for i in 0 .. lightCount - 1 do
+                // project light center on the cone axis and get conservative distance to the cone surface
+                let dx, dy, dz = lightX.[i] - origin.x, lightY.[i] - origin.y, lightZ.[i] - origin.z
+                let t = max tmin (min tmax (dx * direction.x + dy * direction.y + dz * direction.z))
+                let ax, ay, az = t * direction.x - dx, t * direction.y - dy, t * direction.z - dz
+                let distance = (sqrt (ax * ax + ay * ay + az * az) - t * radius) * scale
+
+                if lightDirectional.[i] || distance < lightRadius.[i] then
+                    add i
+
+        | _ -> invalidArg "cullMethod" "Unknown cull method"
+
+        rejected.[ty * gridWidth + tx] <- !rejects
+
+        // count lights in each list
+        let categories = LightGridLayout.categories
+        let counts = compactLists depthSlices ranges (fun _ _ _ -> ())
+
+        // allocate an index range for each cell; category lists are truncated if the index buffer is full, starting from
+        // the last category
+        let offsets = Array.zeroCreate counts.Length
+
+        for slice in 0 .. depthSlices - 1 do
+            let total = Array.sub counts (slice * categories) categories |> Array.sum
+            let offset = Interlocked.Add(&requested.contents, total) - total
+            let mutable available = max 0 (indexCapacity - offset)
+
+            if total > available then
+                Interlocked.Increment(&truncated.contents) |> ignore
+
+            let cell = slice * sliceStride + ty * gridWidth + tx
+            cells.[cell * cellStride] <- offset
+
+            let mutable listOffset = offset
+
+            for category in 0 .. categories - 1 do
+                let list = slice * categories + category
+                let count = min counts.[list] available
+
+                counts.[list] <- count
+                offsets.[list] <- listOffset
+                cells.[cell * cellStride + 1 + category] <- count
+
+                available <- available - count
+                listOffset <- listOffset + count
+
+        // write light indices; truncated lists keep the lights with smaller indices
+        compactLists depthSlices ranges (fun list position i ->
+            if position < counts.[list] then
+                indices.[offsets.[list] + position] <- uint16 i) |> ignore
+
+    // tiles are independent, so they are processed in parallel
+    Parallel.For(0, gridWidth * gridHeight, fun i -> fillTile (i % gridWidth) (i / gridWidth)) |> ignore
+
+    { width = gridWidth; height = gridHeight; depth = depthSlices; cells = cells; indices = indices; rejected = rejected
+      statistics = { requestedIndices = !requested; indexCapacity = indexCapacity; truncatedCells = !truncated } }
+
+// get light indices of the category list in the cell
+let getCellCategoryLights (grid: Grid) tx ty slice (category: LightCategory) =
+    let cell = (slice * grid.height + ty) * grid.width + tx
+    let offset = grid.cells.[cell * cellStride] + Array.sum (Array.sub grid.cells (cell * cellStride + 1) (int category))
+    Array.init grid.cells.[cell * cellStride + 1 + int category] (fun i -> int grid.indices.[offset + i])
+
+// get light indices for the cell; lights are grouped by category
+let getCellLights (grid: Grid) tx ty slice =
+    let cell = (slice * grid.height + ty) * grid.width + tx
+    let count = Array.sum (Array.sub grid.cells (cell * cellStride + 1) LightGridLayout.categories)
+    Array.init count (fun i -> int grid.indices.[grid.cells.[cell * cellStride] + i])
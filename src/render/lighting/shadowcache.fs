@@ -0,0 +1,168 @@
+namespace Render.Lighting
+
+open System.Collections.Generic
+
+// shadow map region in the atlas
+type private ShadowCacheEntry =
+    { x: int
+      y: int
+      size: int
+      mutable transform: Matrix44
+      mutable valid: bool }
+
+// shadow map cache; shadow maps stay in the atlas between frames and keep their regions, so a shadow map is rendered
+// only if its transform changes (the light moved, or the stable cascade sphere snapped to another texel) or if the
+// geometry inside its frustum changes
+// shadow maps are identified by a (light index, cascade index) key; shadow maps that are not requested in a frame are
+// freed; requests that do not fit at the requested size get smaller regions, down to MinSize, and grow back when there
+// is free space; existing shadow maps are never evicted or moved to make them grow, so the cache does not render
+// anything while the requests stay the same
+type ShadowCache(width: int, height: int) =
+    static let minSize = 128
+
+    let entries = Dictionary<int * int, ShadowCacheEntry>()
+    let allocator = AtlasAllocator(width, height)
+
+    // number of regions that were freed since the last check for repacking
+    let mutable freed = 0
+    let mutable repacks = 0
+
+    // check if the box intersects the shadow frustum; the test is conservative
+    let intersects (bounds: Math.AABB) (transform: Matrix44) =
+        let center, extent = bounds.Center, bounds.Extent
+
+        Math.Frustum(transform).Planes |> Array.forall (fun p ->
+            let radius = abs p.x * extent.x + abs p.y * extent.y + abs p.z * extent.z
+            Vector3.Dot(p.xyz, center) + p.w + radius >= 0.f)
+
+    // allocate a region of the requested size or smaller
+    let rec allocate size =
+        match allocator.Allocate(size, size) with
+        | Some (x, y) -> Some (x, y, size)
+        | None when size > minSize -> allocate (size / 2)
+        | None -> None
+
+    let add key size =
+        match allocate size with
+        | Some (x, y, s) ->
+            entries.Add(key, { x = x; y = y; size = s; transform = Matrix44.Zero; valid = false })
+            true
+        | None -> false
+
+    let remove key =
+        let e = entries.[key]
+        allocator.Free(e.x, e.y, e.size, e.size)
+        entries.Remove(key) |> ignore
+        freed <- freed + 1
+
+    // smallest shadow map size
+    static member MinSize = minSize
+
+    // atlas dimensions
+    member this.Width = width
+    member this.Height = height
+
+    // atlas allocator
+    member this.Allocator = allocator
+
+    // number of times the atlas was packed from scratch because of fragmentation
+    member this.Repacks = repacks
+
+    // update the cache with the shadow maps for this frame; requests are (key, size, transform) and are allocated in
+    // order, so requests should be sorted by importance: if the atlas is full, new requests evict the shadow maps of the
+    // requests that come after them
+    // returns the region (x, y, size) and whether the shadow map needs to be rendered for each request, or None if it
+    // does not fit
+    member this.Update(requests: ((int * int) * int * Matrix44) array) =
+        // if the requests do not fit in the atlas, halve the sizes starting from the least important requests; this
+        // gives shadows to more lights than evicting does
+        let sizes = requests |> Array.map (fun (_, size, _) -> size)
+        let mutable area = sizes |> Array.sumBy (fun size -> int64 size * int64 size)
+        let mutable index = sizes.Length - 1
+
+        while area > int64 width * int64 height && index >= 0 do
+            if sizes.[index] > minSize then
+                area <- area - int64 sizes.[index] * int64 sizes.[index] * 3L / 4L
+                sizes.[index] <- sizes.[index] / 2
+            else
+                index <- index - 1
+
+        let requests = Array.map2 (fun (key, _, transform) size -> key, size, transform) requests sizes
+
+        // free shadow maps that are no longer requested, or that are larger than requested
+        let requested = requests |> Array.map (fun (key, size, _) -> key, size) |> dict
+
+        for KeyValue(key, e) in Seq.toArray entries do
+            match requested.TryGetValue(key) with
+            | true, size when e.size <= size -> ()
+            | _ -> remove key
+
+        // allocate new shadow maps and grow the ones that got less than requested earlier
+        for i in 0 .. requests.Length - 1 do
+            let key, size, _ = requests.[i]
+
+            match entries.TryGetValue(key) with
+            | true, e when e.size = size -> ()
+            | true, e ->
+                // grow the shadow map only if there is free space, so that it does not evict shadow maps that then
+                // have to grow in turn
+                match allocator.Allocate(size, size) with
+                | Some (x, y) ->
+                    remove key
+                    entries.Add(key, { x = x; y = y; size = size; transform = Matrix44.Zero; valid = false })
+                | None -> ()
+            | _ ->
+                // settle for a smaller shadow map; if even the smallest one does not fit, evict less important shadow
+                // maps, starting from the least important one
+                let mutable evict = requests.Length - 1
+
+                while not (add key size) && evict > i do
+                    let ekey, _, _ = requests.[evict]
+                    if entries.ContainsKey(ekey) then remove ekey
+                    evict <- evict - 1
+
+        let missing =
+            requests |> Array.sumBy (fun (key, size, _) ->
+                match entries.TryGetValue(key) with
+                | true, e -> int64 size * int64 size - int64 e.size * int64 e.size
+                | _ -> int64 size * int64 size)
+
+        // if some shadow maps did not get the requested size but there is enough free space for them, the atlas may be
+        // fragmented by freed regions; pack it from scratch if that gives all shadow maps the requested size, which
+        // renders all shadow maps again, so it is only worth it if at least 1/8 of the atlas is missing; the check only
+        // runs after regions were freed, so it is skipped while the requests stay the same
+        if missing * 8L >= int64 (width * height) && missing <= int64 (width * height - allocator.AllocatedArea) && freed > 0 then
+            freed <- 0
+
+            let scratch = AtlasAllocator(width, height)
+
+            if requests |> Array.forall (fun (_, size, _) -> (scratch.Allocate(size, size)).IsSome) then
+                entries.Clear()
+                allocator.Clear()
+                repacks <- repacks + 1
+
+                for key, size, _ in requests do
+                    add key size |> ignore
+
+        // get regions and refresh the transforms
+        requests |> Array.map (fun (key, _, transform) ->
+            match entries.TryGetValue(key) with
+            | true, e ->
+                let dirty = not e.valid || e.transform <> transform
+
+                e.transform <- transform
+                e.valid <- true
+
+                Some (e.x, e.y, e.size, dirty)
+            | _ -> None)
+
+    // invalidate shadow maps that can contain the geometry in the box; call this for the old and the new bounds of
+    // geometry that moved, appeared or disappeared
+    member this.Invalidate(bounds: Math.AABB) =
+        for e in entries.Values do
+            if e.valid && intersects bounds e.transform then e.valid <- false
+
+    // invalidate all shadow maps
+    member this.InvalidateAll() =
+        for e in entries.Values do
+            e.valid <- false
@@ -0,0 +1,113 @@
+// CPU port of the shadow map filters in shadowmap.h; used to compare filter quality against cost offline
+module Render.Lighting.ShadowFilterReference
+
+// shadow map with row-major depth values
+type ShadowMap =
+    { width: int
+      height: int
+      depth: float32 array }
+
+// Poisson disk offsets in texels; same as sampleShadowPoisson
+let private poissonOffsets =
+    [| 0.f, 0.f
+       0.200887527842703f, -0.805816066868008f; 0.169759583602972f, 0.787268282932537f; -0.639597778815228f, -0.370236979450183f
+       0.629148098269191f, 0.367398185340504f; -0.456211403483755f, 0.542374725109481f; -0.411828977295713f, -0.484566120009967f
+       0.106871055317844f, 0.59918690478536f; -0.117388437710382f, -0.518626519610864f; 0.436862373204161f, -0.182937652849816f
+       0.206632546759667f, 0.343668469981935f; -0.330409446933952f, 0.175773621457362f; -0.1f, -0.16089955706328f |]
+
+// get comparison result for the texel with clamp addressing; the sampler uses Comparison.Less
+let inline private compare (map: ShadowMap) x y (depth: float32) =
+    let x = max 0 (min (map.width - 1) x)
+    let y = max 0 (min (map.height - 1) y)
+
+    if depth < map.depth.[y * map.width + x] then 1.f else 0.f
+
+// sample shadow map with a texel offset; same as SampleCmpLevelZero with linear comparison filtering, which compares
+// the four nearest texels and blends the results bilinearly
+let sampleShadow (map: ShadowMap) (u: float32) (v: float32) (depth: float32) ox oy =
+    let x = u * float32 map.width - 0.5f
+    let y = v * float32 map.height - 0.5f
+    let x0, y0 = int (floor x), int (floor y)
+    let fx, fy = x - floor x, y - floor y
+    let x0, y0 = x0 + ox, y0 + oy
+
+    let top = compare map x0 y0 depth * (1.f - fx) + compare map (x0 + 1) y0 depth * fx
+    let bottom = compare map x0 (y0 + 1) depth * (1.f - fx) + compare map (x0 + 1) (y0 + 1) depth * fx
+
+    top * (1.f - fy) + bottom * fy
+
+// same as sampleShadowPCF
+let sampleShadowPCF map u v depth size =
+    let radius = size / 2
+    let mutable result = 0.f
+
+    for x in -radius .. radius do
+        for y in -radius .. radius do
+            result <- result + sampleShadow map u v depth x y
+
+    result / float32 ((radius * 2 + 1) * (radius * 2 + 1))
+
+// same as sampleShadowPoisson
+let sampleShadowPoisson map u v depth size =
+    let su, sv = 1.f / float32 map.width, 1.f / float32 map.height
+    let mutable result = 0.f
+
+    for i in 0 .. size - 1 do
+        let ox, oy = poissonOffsets.[i]
+        result <- result + sampleShadow map (u + ox * su) (v + oy * sv) depth 0 0
+
+    result / float32 size
+
+// same as sampleShadowFXAA
+let sampleShadowFXAA map u v depth =
+    let su, sv = 1.f / float32 map.width, 1.f / float32 map.height
+
+    let shadowM = sampleShadow map u v depth 0 0
+    let shadowNW = sampleShadow map u v depth -1 -1
+    let shadowNE = sampleShadow map u v depth 1 -1
+    let shadowSW = sampleShadow map u v depth -1 1
+    let shadowSE = sampleShadow map u v depth 1 1
+
+    let shadowDiag1 = shadowSW - shadowNE
+    let shadowDiag2 = shadowSE - shadowNW
+
+    let dx, dy = shadowDiag1 + shadowDiag2, shadowDiag1 - shadowDiag2
+
+    if dx * dx + dy * dy < 0.01f then
+        shadowM
+    else
+        let length = sqrt (dx * dx + dy * dy)
+        let ou, ov = dx / length * su, dy / length * sv
+
+        let shadowD1 = sampleShadow map (u - ou) (v - ov) depth 0 0
+        let shadowD2 = sampleShadow map (u + ou) (v + ov) depth 0 0
+
+        shadowM * 0.5f + shadowD1 * 0.25f + shadowD2 * 0.25f
+
+// same as sampleShadowFiltered
+let sampleShadowFiltered (filter: ShadowFilter) map u v depth =
+    match filter with
+    | ShadowFilter.Single -> sampleShadow map u v depth 0 0
+    | ShadowFilter.FXAA -> sampleShadowFXAA map u v depth
+    | ShadowFilter.Poisson4 -> sampleShadowPoisson map u v depth 4
+    | ShadowFilter.Poisson8 -> sampleShadowPoisson map u v depth 8
+    | ShadowFilter.PCF3x3 -> sampleShadowPCF map u v depth 3
+    | f -> failwithf "Unknown filter %A" f
+
+// get the worst-case number of comparison samples for the filter
+let getSampleCount (filter: ShadowFilter) =
+    match filter with
+    | ShadowFilter.Single -> 1
+    | ShadowFilter.FXAA -> 7
+    | ShadowFilter.Poisson4 -> 4
+    | ShadowFilter.Poisson8 -> 8
+    | ShadowFilter.PCF3x3 -> 9
+    | f -> failwithf "Unknown filter %A" f
+
+// get RMS error of the filter against the reference lit fraction at the specified points (in texels)
+let getFilterError filter map depth (reference: float32 -> float32 -> float32) (points: (float32 * float32) array) =
+    points
+    |> Array.averageBy (fun (x, y) ->
+        let e = sampleShadowFiltered filter map (x / float32 map.width) (y / float32 map.height) depth - reference x y
+        float (e * e))
+    |> sqrt
@@ -0,0 +1,414 @@
+module Render.Lighting.Tests
+
+open Render.Lighting.LightGridReference
+
+// test viewport size (pixels); not a multiple of the cell size to cover partial tiles
+let private width = 200
+let private height = 120
+
+let private view = Math.Camera.lookAt (Vector3(0.f, 10.f, -30.f)) Vector3.Zero Vector3.UnitY
+let private projection = Math.Camera.projectionPerspective 1.f (float32 width / float32 height) 0.1f 1000.f
+
+// depth buffer with wavy foreground blocks at 15 units and background at 60 units from the camera; blocks are not
+// aligned to tiles, so many tiles have depth discontinuities
+let private depth =
+    Array.init (width * height) (fun i ->
+        let x, y = float32 (i % width), float32 (i / width)
+        let z = (if (i % width / 24 + i / width / 24) % 2 = 0 then 15.f else 60.f) + 5.f * sin (x * 0.05f) * cos (y * 0.07f)
+        Matrix44.TransformPerspective(projection, Vector4(0.f, 0.f, z, 1.f)).z)
+
+// random point and spot lights around the origin and a shadowed directional light; some spot lights are shadowed
+let private lights =
+    let random = System.Random(42)
+    let coord range = (float32 (random.NextDouble()) * 2.f - 1.f) * range
+
+    Array.init 200 (fun i ->
+        if i = 17 then LightCullData(LightType.Directional, Vector3.Zero, 0.f, true)
+        else LightCullData((if i % 2 = 0 then LightType.Point else LightType.Spot), Vector3(coord 40.f, coord 15.f, coord 40.f), 1.f + abs (coord 6.f), i % 4 = 1))
+
+// get world positions of pixel centers
+let private positions =
+    let inverse = Matrix44.Inverse(projection * Matrix44(view))
+
+    Array.init (width * height) (fun i ->
+        let x, y = (float32 (i % width) + 0.5f) / float32 width, (float32 (i / width) + 0.5f) / float32 height
+        Matrix44.TransformPerspective(inverse, Vector4(x * 2.f - 1.f, 1.f - 2.f * y, depth.[i], 1.f)))
+
+// depth slice range for clustered grids
+let private depthNear = 1.f
+let private depthFar = 1000.f
+
+// get view-space depth of pixel centers
+let private viewDepths = positions |> Array.map (fun p -> Vector4.Dot(view.row2, Vector4(p, 1.f)))
+
+// every light that affects a pixel has to be in the list of the pixel's cell
+let private checkConservative cullMethod depthMask depthSlices =
+    let grid = fill cullMethod depthMask depth width height view projection lights depthSlices depthNear depthFar (1 <<< 20)
+
+    assert (grid.statistics.truncatedCells = 0)
+
+    for slice in 0 .. depthSlices - 1 do
+        for ty in 0 .. grid.height - 1 do
+            for tx in 0 .. grid.width - 1 do
+                // cells are partitioned by category, category lists are sorted by index
+                let lists = Array.init LightGridLayout.categories (fun c -> getCellCategoryLights grid tx ty slice (enum c))
+
+                assert (Array.concat lists = getCellLights grid tx ty slice)
+
+                lists |> Array.iteri (fun c list ->
+                    assert (list = Array.sort list)
+                    assert (list |> Array.forall (fun i -> getLightCategory lights.[i] = enum c)))
+
+                // directional lights are in all cells
+                assert (lists.[int LightCategory.DirectionalShadowed] = [|17|])
+
+    for y in 0 .. height - 1 do
+        for x in 0 .. width - 1 do
+            let p = positions.[y * width + x]
+            let slice = getDepthSlice depthSlices depthNear depthFar viewDepths.[y * width + x]
+            let cell = getCellLights grid (x / LightGridLayout.cellSize) (y / LightGridLayout.cellSize) slice |> Set.ofArray
+
+            lights |> Array.iteri (fun i l ->
+                if l.Type <> LightType.Directional && (p - l.Position).Length < l.Radius * 0.99f then
+                    assert (cell.Contains i))
+
+    grid
+
+// get average light count over the lists that pixels look up
+let private getPixelLightCount (grid: Grid) =
+    Array.init (width * height) (fun i ->
+        let slice = getDepthSlice grid.depth depthNear depthFar viewDepths.[i]
+        (getCellLights grid (i % width / LightGridLayout.cellSize) (i / width / LightGridLayout.cellSize) slice).Length)
+    |> Array.averageBy float
+
+let testFrustumConservative () =
+    let grid = checkConservative CullMethod.Frustum false 1
+
+    // depth bounds have to reject most lights
+    assert (getPixelLightCount grid < 0.2 * float lights.Length)
+
+let testConeConservative () =
+    let grid = checkConservative CullMethod.Cone false 1
+
+    assert (getPixelLightCount grid < 0.2 * float lights.Length)
+
+let testClusteredConservative () =
+    for cullMethod in [CullMethod.Frustum; CullMethod.Cone] do
+        let tiled = checkConservative cullMethod false 1
+        let clustered = checkConservative cullMethod false 16
+
+        // depth slices have to reduce the number of lights that pixels iterate over
+        assert (getPixelLightCount clustered < 0.75 * getPixelLightCount tiled)
+
+let testDepthMaskConservative () =
+    for cullMethod in [CullMethod.Frustum; CullMethod.Cone] do
+        let tiled = checkConservative cullMethod false 1
+        let masked = checkConservative cullMethod true 1
+
+        checkConservative cullMethod true 16 |> ignore
+
+        // lights between foreground and background have to be rejected
+        assert (masked.rejected |> Array.sum > 0)
+        assert (getPixelLightCount masked < 0.9 * getPixelLightCount tiled)
+
+let testCompactLists () =
+    let grid = fill CullMethod.Cone false depth width height view projection lights 16 depthNear depthFar (1 <<< 20)
+
+    // lists occupy disjoint ranges that cover exactly the requested part of the index buffer
+    let ranges =
+        Array.init (grid.cells.Length / cellStride) (fun i -> grid.cells.[i * cellStride], Array.sum (Array.sub grid.cells (i * cellStride + 1) LightGridLayout.categories))
+        |> Array.filter (fun (_, count) -> count > 0) |> Array.sort
+
+    assert (ranges |> Array.sumBy snd = grid.statistics.requestedIndices)
+    assert (ranges |> Array.pairwise |> Array.forall (fun ((o0, c0), (o1, _)) -> o0 + c0 = o1))
+
+let testCompactionModel () =
+    let random = System.Random(42)
+
+    // light counts cover partial and multiple batches
+    for count in [0; 1; 31; 256; 1000] do
+        let ranges =
+            Array.init count (fun _ ->
+                let category: LightCategory = enum (random.Next(LightGridLayout.categories))
+                if random.Next(3) = 0 then 0, -1, category else let first = random.Next(16) in first, first + random.Next(16 - first), category)
+
+        let lists = Array.init (16 * LightGridLayout.categories) (fun _ -> ResizeArray())
+
+        let counts = compactLists 16 ranges (fun list position i ->
+            assert (position = lists.[list].Count)
+            lists.[list].Add(i))
+
+        // batch compaction has to produce the same lists as a sequential scan over the lights
+        for list in 0 .. lists.Length - 1 do
+            let slice, category = list / LightGridLayout.categories, list % LightGridLayout.categories
+            let expected = Array.init count id |> Array.filter (fun i -> let first, last, c = ranges.[i] in first <= slice && slice <= last && int c = category)
+
+            assert (counts.[list] = expected.Length)
+            assert (lists.[list].ToArray() = expected)
+
+let testDeterministicLists () =
+    let getLists (grid: Grid) =
+        Array.init (grid.width * grid.height * grid.depth) (fun i -> getCellLights grid (i % grid.width) (i / grid.width % grid.height) (i / (grid.width * grid.height)))
+
+    let full = getLists (fill CullMethod.Cone true depth width height view projection lights 16 depthNear depthFar (1 <<< 20))
+    let truncated = fill CullMethod.Cone true depth width height view projection lights 16 depthNear depthFar 1000
+
+    // lists do not depend on the allocation order; truncated lists keep the lights with smaller indices
+    assert (truncated.statistics.truncatedCells > 0)
+    assert (getLists truncated |> Array.forall2 (fun (f: int array) t -> t = Array.sub f 0 t.Length) full)
+
+let testIndexOverflow () =
+    let all = Array.init 100 (fun _ -> LightCullData(LightType.Directional, Vector3.Zero, 0.f))
+
+    for capacity in [0; 1; 1000] do
+        let grid = fill CullMethod.Cone true depth width height view projection all 4 depthNear depthFar capacity
+        let cellCount = grid.width * grid.height * grid.depth
+
+        // all lists request all lights; lists that do not fit are truncated, the rest are complete
+        assert (grid.statistics.requestedIndices = cellCount * all.Length)
+        assert (grid.statistics.truncatedCells = cellCount - capacity / all.Length)
+
+        let lists = Array.init cellCount (fun i -> getCellLights grid (i % grid.width) (i / grid.width % grid.height) (i / (grid.width * grid.height)))
+
+        assert (lists |> Array.sumBy (fun l -> l.Length) = capacity)
+        assert (lists |> Array.forall (fun l -> l = Array.init l.Length id))
+
+// unit vectors: axes, octahedron fold edges and a Fibonacci sphere
+let private normals =
+    let axes = [| Vector3.UnitX; Vector3.UnitY; Vector3.UnitZ; -Vector3.UnitX; -Vector3.UnitY; -Vector3.UnitZ |]
+    let edges = [| Vector3(1.f, 1.f, 0.f); Vector3(-1.f, 1.f, 0.f); Vector3(1.f, 0.f, -1.f); Vector3(-1.f, -1.f, -1e-3f) |] |> Array.map Vector3.Normalize
+
+    let sphere =
+        Array.init 10000 (fun i ->
+            let z = 1.f - 2.f * (float32 i + 0.5f) / 10000.f
+            let phi = float32 i * 2.39996323f
+            let r = sqrt (1.f - z * z)
+            Vector3(r * cos phi, r * sin phi, z))
+
+    Array.concat [axes; edges; sphere]
+
+// get angle between unit vectors in degrees; the chord length is used because acos of the dot product loses precision
+// for small angles
+let private getAngle (a: Vector3) (b: Vector3) =
+    2.0 * asin (min 1.0 (float (a - b).Length / 2.0)) * 180.0 / System.Math.PI
+
+let testGBufferNormals () =
+    for n in normals do
+        // encoding is exact up to float precision; 16-bit quantization keeps the error well below a texel of a normal map
+        assert (getAngle n (GBuffer.decodeOctahedral (GBuffer.encodeOctahedral n)) < 1e-3)
+        assert (getAngle n (GBuffer.unpackNormal (GBuffer.packNormal n)) < 0.01)
+
+        // packing is stable
+        assert (GBuffer.packNormal (GBuffer.unpackNormal (GBuffer.packNormal n)) = GBuffer.packNormal n)
+
+let testGBufferColors () =
+    for i in 0 .. 1000 do
+        let v = float32 i / 1000.f
+        let color, alpha = GBuffer.unpackColor (GBuffer.packColor (Vector3(v, v, v)) v)
+
+        // gamma space storage keeps the relative error of dark values low
+        assert (abs (color.x - v) < 0.005f)
+        assert (v < 0.01f || abs (color.x - v) < 0.05f * v)
+
+        // alpha is linear
+        assert (abs (alpha - v) <= 0.5f / 255.f + 1e-6f)
+
+let testGBufferData () =
+    let data = { GBuffer.albedo = Vector3(0.5f, 0.1f, 0.02f); GBuffer.normal = Vector3.Normalize(Vector3(0.3f, -0.5f, -0.8f)); GBuffer.specular = Vector3(0.04f, 0.04f, 0.04f); GBuffer.roughness = 0.7f }
+    let packed = GBuffer.pack data
+    let result = GBuffer.unpack packed
+
+    assert (GBuffer.pack result = packed)
+    assert ((result.albedo - data.albedo).Length < 0.005f && (result.specular - data.specular).Length < 0.005f)
+    assert (getAngle result.normal data.normal < 0.01 && abs (result.roughness - data.roughness) < 0.002f)
+
+// shadow map with an occluder at depth 0.3 that covers a half-plane with a slanted edge and a disk
+let private shadowMapSize = 128
+
+let private isOccluded (x: float32) (y: float32) =
+    x * 0.955f + y * 0.296f < 0.6f * float32 shadowMapSize || (x - 100.f) * (x - 100.f) + (y - 30.f) * (y - 30.f) < 100.f
+
+let private shadowMap: ShadowFilterReference.ShadowMap =
+    { width = shadowMapSize; height = shadowMapSize
+      depth = Array.init (shadowMapSize * shadowMapSize) (fun i -> if isOccluded (float32 (i % shadowMapSize) + 0.5f) (float32 (i / shadowMapSize) + 0.5f) then 0.3f else 1.f) }
+
+// all filter values, so that a filter without a reference kernel fails the tests
+let private shadowFilters = System.Enum.GetValues(typeof<ShadowFilter>) :?> ShadowFilter array
+
+let testShadowFilterRange () =
+    let random = System.Random(42)
+
+    for filter in shadowFilters do
+        assert (ShadowFilterReference.getSampleCount filter > 0)
+
+    for i in 0 .. 1000 do
+        let u, v = float32 (random.NextDouble()), float32 (random.NextDouble())
+
+        for filter in shadowFilters do
+            // receivers in front of the occluder are lit, receivers behind the background are in shadow
+            assert (ShadowFilterReference.sampleShadowFiltered filter shadowMap u v 0.2f = 1.f)
+            assert (ShadowFilterReference.sampleShadowFiltered filter shadowMap u v 1.f = 0.f)
+
+            let value = ShadowFilterReference.sampleShadowFiltered filter shadowMap u v 0.5f
+            assert (value >= 0.f && value <= 1.f)
+
+let testShadowFilterBilinear () =
+    let map: ShadowFilterReference.ShadowMap = { width = 4; height = 1; depth = [| 0.f; 0.f; 1.f; 1.f |] }
+
+    // halfway between the texel centers on both sides of the edge
+    assert (ShadowFilterReference.sampleShadow map 0.5f 0.5f 0.5f 0 0 = 0.5f)
+    assert (ShadowFilterReference.sampleShadow map 0.5625f 0.5f 0.5f 0 0 = 0.75f)
+    assert (ShadowFilterReference.sampleShadow map 0.5f 0.5f 0.5f 1 0 = 1.f)
+
+let testShadowFilterQuality () =
+    // reference is the lit fraction of a 2x2 texel box, evaluated on the analytic occluder
+    let reference (x: float32) (y: float32) =
+        Array.init 64 (fun i -> isOccluded (x - 1.f + (float32 (i % 8) + 0.5f) / 4.f) (y - 1.f + (float32 (i / 8) + 0.5f) / 4.f))
+        |> Array.averageBy (fun o -> if o then 0.f else 1.f)
+
+    // points near shadow edges; the filters are exact elsewhere
+    let random = System.Random(42)
+    let points =
+        Array.init 20000 (fun _ -> float32 (random.NextDouble()) * float32 shadowMapSize, float32 (random.NextDouble()) * float32 shadowMapSize)
+        |> Array.filter (fun (x, y) -> let r = reference x y in r > 0.f && r < 1.f)
+
+    let error filter = ShadowFilterReference.getFilterError filter shadowMap 0.5f reference points
+
+    // more comparisons give smoother edges
+    assert (points.Length > 100)
+    assert (error ShadowFilter.Poisson8 < error ShadowFilter.Poisson4)
+    assert (error ShadowFilter.Poisson4 < error ShadowFilter.Single)
+    assert (error ShadowFilter.FXAA < error ShadowFilter.Single)
+
+// get shadow cache result with the specified dirty flag
+let private withDirty dirty (region: (int * int * int * bool) option) =
+    region |> Option.map (fun (x, y, size, _) -> x, y, size, dirty)
+
+let testShadowCacheRegions () =
+    let cache = ShadowCache(1024, 1024)
+    let transform = Math.Camera.projectionOrthoOffCenter -10.f 10.f -10.f 10.f -10.f 10.f
+    let moved = Matrix44(Matrix34.Translation(1.f, 0.f, 0.f)) * transform
+
+    // first frame renders everything
+    let first = cache.Update(Array.init 4 (fun i -> (i, 0), 512, transform))
+    assert (first |> Array.forall (function Some (_, _, size, dirty) -> size = 512 && dirty | None -> false))
+
+    // unchanged shadow maps keep their regions and are not rendered again
+    let second = cache.Update(Array.init 4 (fun i -> (i, 0), 512, if i = 1 then moved else transform))
+    assert (second |> Array.mapi (fun i r -> r = withDirty (i = 1) first.[i]) |> Array.forall id)
+
+    // freed regions are reused by new shadow maps
+    let third = cache.Update([| (0, 0), 512, transform; (7, 0), 512, transform |])
+    assert (third.[0] = withDirty false first.[0])
+    assert (first |> Array.take 4 |> Array.exists (fun r -> r = third.[1]))
+
+    // invalidation only affects shadow maps that contain the box
+    let box = Math.AABB(Vector3(-1.f, -1.f, -1.f), Vector3(1.f, 1.f, 1.f))
+    let outside = Math.AABB(Vector3(20.f, -1.f, -1.f), Vector3(21.f, 1.f, 1.f))
+
+    cache.Invalidate(outside)
+    assert (cache.Update([| (0, 0), 512, transform |]) = [| withDirty false first.[0] |])
+
+    cache.Invalidate(box)
+    assert (cache.Update([| (0, 0), 512, transform |]) = [| withDirty true first.[0] |])
+
+    // shadow maps that do not fit get smaller regions; they grow back when there is space
+    let smaller = cache.Update([| (0, 0), 512, transform; (7, 0), 512, transform; (8, 0), 1024, transform |])
+    assert (match smaller.[2] with Some (_, _, size, true) -> size = 512 | _ -> false)
+
+    let larger = cache.Update([| (8, 0), 1024, transform |])
+    assert (larger = [| Some (0, 0, 1024, true) |])
+
+    // if the requests do not fit, the least important ones get smaller
+    let budget = ShadowCache(1024, 1024).Update(Array.init 5 (fun i -> (i, 0), 512, transform))
+    assert (budget |> Array.map (Option.map (fun (_, _, size, _) -> size)) = [| Some 512; Some 512; Some 512; Some 256; Some 128 |])
+
+let testShadowCacheSteady () =
+    let cache = ShadowCache(2048, 2048)
+    let random = System.Random(1)
+    let randomSize () = [| 128; 128; 256; 256; 512; 1024 |].[random.Next(6)]
+
+    // requests in importance order, which is not the size order, so the atlas can not always be packed perfectly
+    let getRequests count = Array.init count (fun i -> (i, 0), randomSize (), Matrix44.Identity)
+
+    // changing requests leave the atlas fragmented; the same requests are rendered once and then stay in the cache,
+    // even if some shadow maps did not get the requested size
+    for frame in 0 .. 20 do
+        cache.Update(getRequests (10 + random.Next(30))) |> ignore
+
+    let requests = getRequests 40
+    let first = cache.Update(requests)
+    assert (first |> Array.exists (fun r -> r.IsSome))
+
+    for frame in 0 .. 20 do
+        assert (cache.Update(requests) = (first |> Array.map (withDirty false)))
+
+let testAtlasAllocator () =
+    let allocator = AtlasAllocator(1024, 1024)
+    let random = System.Random(42)
+    let allocated = System.Collections.Generic.List<int * int * int>()
+
+    // allocations never overlap and stay in the atlas
+    let check () =
+        for i in 0 .. allocated.Count - 1 do
+            let x0, y0, s0 = allocated.[i]
+            assert (x0 >= 0 && y0 >= 0 && x0 + s0 <= 1024 && y0 + s0 <= 1024)
+
+            for j in 0 .. i - 1 do
+                let x1, y1, s1 = allocated.[j]
+                assert (x0 + s0 <= x1 || x1 + s1 <= x0 || y0 + s0 <= y1 || y1 + s1 <= y0)
+
+        assert (allocator.AllocatedArea = (allocated |> Seq.sumBy (fun (_, _, s) -> s * s)))
+
+    // power of two squares fill the atlas completely
+    for size in [512; 256; 256; 128; 128; 128; 128; 256; 256; 256; 256; 256; 256; 256; 256; 256] do
+        let result = allocator.Allocate(size, size)
+        assert (result.IsSome)
+        allocated.Add((fst result.Value, snd result.Value, size))
+
+    check ()
+    assert (allocator.AllocatedArea = 1024 * 1024)
+    assert (allocator.Allocate(128, 128).IsNone)
+
+    // random churn
+    for i in 0 .. 1000 do
+        if allocated.Count > 0 && random.Next(2) = 0 then
+            let index = random.Next(allocated.Count)
+            let x, y, s = allocated.[index]
+            allocator.Free(x, y, s, s)
+            allocated.RemoveAt(index)
+        else
+            let size = 128 <<< random.Next(3)
+            match allocator.Allocate(size, size) with
+            | Some (x, y) -> allocated.Add((x, y, size))
+            | None -> ()
+
+        check ()
+
+    // freeing everything merges the free rectangles back together
+    for x, y, s in allocated do
+        allocator.Free(x, y, s, s)
+
+    assert (allocator.AllocatedArea = 0)
+    assert (allocator.Allocate(1024, 1024) = Some (0, 0))
+
+let testShadowCacheBuild () =
+    let cache = ShadowCache(4096, 4096)
+    let lights = [|
+        DirectionalLight { direction = Vector3.Normalize(Vector3(-1.f, -1.f, -1.f)); color = Color4(1.f, 1.f, 1.f); intensity = 1.f }
+        SpotLight { position = Vector3(0.f, 10.f, 0.f); direction = -Vector3.UnitY; radius = 20.f; outerAngle = 0.5f; innerAngle = 0.4f; color = Color4(1.f, 1.f, 1.f); intensity = 1.f } |]
+
+    let build eye target =
+        let _, _, updates = LightDataBuilder.build cache lights (Math.Camera.lookAt eye target Vector3.UnitY) projection
+        updates.Length
+
+    // 4 cascades and a spot light shadow map
+    assert (build (Vector3(0.f, 10.f, -30.f)) Vector3.Zero = 5)
+
+    // cascade spheres are snapped to texels, so the shadow maps stay cached until the camera moves by a texel
+    assert (build (Vector3(0.f, 10.f, -30.f)) Vector3.Zero = 0)
+    assert (build (Vector3(0.f, 10.f, -30.0001f)) Vector3.Zero = 0)
+
+    // camera movement only re-renders the cascades that moved by a texel; near cascades have smaller texels
+    let moved = build (Vector3(0.3f, 10.f, -30.f)) (Vector3(0.3f, 0.f, 0.f))
+    assert (moved > 0 && moved < 4)
@@ -0,0 +1,27 @@
+module Render.PostFX.Benchmarks
+
+open Render.PostFX.Reference
+
+// luminance histogram reduction over a range of resolutions on one thread and on all cores; the image is an HDR
+// gradient with noise, so pixels spread over many bins
+let benchmarkExposureHistogram () =
+    let parameters: ExposureReference.Parameters = { minLogLuminance = -10.f; logLuminanceRange = 16.f; lowPercentile = 0.5f; highPercentile = 0.95f }
+
+    printfn "%12s %12s %12s %10s %14s %12s" "resolution" "serial ms" "threaded ms" "speedup" "Mpixels/s" "exposure"
+
+    for width, height in [1280, 720; 1920, 1080; 2560, 1440; 3840, 2160] do
+        let random = System.Random(42)
+        let image =
+            { width = width; height = height
+              data = Array.init (width * height) (fun i ->
+                let l = 2.f ** (float32 (i % width) / float32 width * 12.f - 8.f) * (0.5f + float32 (random.NextDouble()))
+                Vector3(l, l * 0.9f, l * 0.8f)) }
+
+        let serial = Core.Test.measure (fun () -> ExposureReference.buildHistogram parameters image)
+        let threaded = Core.Test.measure (fun () -> ExposureReference.buildHistogramParallel parameters image)
+
+        let average = ExposureReference.getAverageLogLuminance parameters (ExposureReference.buildHistogramParallel parameters image)
+        let exposure = ExposureReference.getExposure (ExposureReference.adapt None average 1.f) 0.f
+
+        printfn "%12s %12.2f %12.2f %10.2f %14.1f %12.4f" (sprintf "%dx%d" width height) serial threaded (serial / threaded)
+            (float (width * height) / threaded / 1000.0) exposure
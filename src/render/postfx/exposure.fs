@@ -0,0 +1,84 @@
+namespace Render.PostFX
+
+open SharpDX.Direct3D11
+open SharpDX.DXGI
+
+open Render
+
+// automatic exposure from a luminance histogram
+// the histogram pass bins log2 luminance of the HDR target; each group builds the histogram of its tile in group shared
+// memory and adds it to the global histogram, so the pass reads every pixel once and needs no intermediate targets
+// the adaptation pass averages log2 luminance over the bins between the low and the high percentiles, which ignores
+// small very dark and very bright regions, and moves the adapted luminance towards the average exponentially over time
+// adapted luminance and exposure stay in a GPU buffer between frames and tonemapping reads the exposure from it, so
+// there is no readback
+[<ShaderStruct>]
+type Exposure(device: Device) =
+    static let bins = 64 // bin 0 has pixels below the luminance range; bin count is limited by the group size in CS
+    static let groupSize = 16
+    static let tileSize = 64 // each thread of a 16x16 group bins 4x4 pixels
+
+    // create typed buffer with shader resource and unordered access views
+    let createBuffer (format: Format) count =
+        let buffer =
+            new Buffer(device.Device, Formats.getSizeBits format / 8 * count, ResourceUsage.Default, BindFlags.UnorderedAccess ||| BindFlags.ShaderResource,
+                CpuAccessFlags.None, ResourceOptionFlags.None, 0)
+
+        let view =
+            new ShaderResourceView(device.Device, buffer,
+                ShaderResourceViewDescription(Format = format, Dimension = ShaderResourceViewDimension.Buffer, Buffer =
+                    ShaderResourceViewDescription.BufferResource(ElementCount = count)))
+
+        let uaView =
+            new UnorderedAccessView(device.Device, buffer,
+                UnorderedAccessViewDescription(Format = format, Dimension = UnorderedAccessViewDimension.Buffer, Buffer =
+                    UnorderedAccessViewDescription.BufferResource(ElementCount = count)))
+
+        buffer, view, uaView
+
+    let histogram, histogramView, histogramUAView = createBuffer Format.R32_UInt bins
+
+    // adapted log2 luminance, exposure
+    let _, stateView, stateUAView = createBuffer Format.R32_Float 2
+
+    let mutable adapted = false
+    let mutable adaptationRate = 1.f
+
+    // get histogram dimensions
+    static member Bins = bins
+    static member GroupSize = groupSize
+    static member TileSize = tileSize
+
+    // get the fraction of the distance to the target luminance that adaptation covers in the time step; the result
+    // does not depend on how the time is split into frames
+    static member GetAdaptationRate(deltaTime: float32, speed: float32) =
+        1.f - exp (-deltaTime * speed)
+
+    // log2 luminance range of bins 1..Bins-1
+    member val MinLogLuminance = -10.f with get, set
+    member val LogLuminanceRange = 16.f with get, set
+
+    // fractions of pixels in the luminance range that are ignored at the dark and at the bright end
+    member val LowPercentile = 0.5f with get, set
+    member val HighPercentile = 0.95f with get, set
+
+    // exposure compensation in stops
+    member val Compensation = 0.f with get, set
+
+    // adaptation rate for the current frame; 1 for the first frame, which starts at the target luminance
+    member this.AdaptationRate = adaptationRate
+
+    // get read-only views
+    member this.HistogramView = histogramView
+    member this.StateView = stateView
+
+    // get unordered views
+    member this.HistogramUnorderedView = histogramUAView
+    member this.StateUnorderedView = stateUAView
+
+    // clear the histogram and set the adaptation rate for the frame; has to be called before the histogram pass
+    member this.Reset(context: DeviceContext, deltaTime, speed) =
+        context.UpdateSubresource(Array.zeroCreate<int> bins, histogram, 0, 0, 0)
+
+        adaptationRate <- if adapted then Exposure.GetAdaptationRate(deltaTime, speed) else 1.f
+        adapted <- true
@@ -0,0 +1,105 @@
+// CPU port of the automatic exposure passes in postfx/exposure_histogram.hlsl and postfx/exposure_adapt.hlsl; the
+// histogram reduction runs on all cores the same way the GPU does, with a histogram per tile that is added to the
+// shared one with atomics
+module Render.PostFX.ExposureReference
+
+open System.Threading
+open System.Threading.Tasks
+
+open Render.PostFX.Reference
+
+// histogram settings; match the Exposure properties
+type Parameters =
+    { minLogLuminance: float32
+      logLuminanceRange: float32
+      lowPercentile: float32
+      highPercentile: float32 }
+
+// average luminance is mapped to middle gray
+let private key = 0.18f
+
+// get histogram bin for the color; bin 0 has pixels below the luminance range
+let getBin parameters (color: Vector3) =
+    let luminance = color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f
+
+    let logLuminance = if luminance > 0.f then log luminance / log 2.f else -infinityf
+
+    if logLuminance < parameters.minLogLuminance then 0
+    else
+        let t = min 1.f ((logLuminance - parameters.minLogLuminance) / parameters.logLuminanceRange)
+        1 + min (int (t * float32 (Exposure.Bins - 1))) (Exposure.Bins - 2)
+
+// get log2 luminance at the bin center
+let getBinLogLuminance parameters bin =
+    parameters.minLogLuminance + (float32 bin - 0.5f) / float32 (Exposure.Bins - 1) * parameters.logLuminanceRange
+
+// build histogram on one thread
+let buildHistogram parameters (image: Image) =
+    let histogram = Array.zeroCreate Exposure.Bins
+
+    for color in image.data do
+        let bin = getBin parameters color
+        histogram.[bin] <- histogram.[bin] + 1
+
+    histogram
+
+// build histogram on all cores; tiles are distributed over threads, each thread accumulates a local histogram over
+// its tiles and adds it to the shared one at the end
+let buildHistogramParallel parameters (image: Image) =
+    let tileSize = Exposure.TileSize
+    let tilesX = (image.width + tileSize - 1) / tileSize
+    let tilesY = (image.height + tileSize - 1) / tileSize
+
+    let histogram = Array.zeroCreate Exposure.Bins
+
+    let binTile tile (local: int array) =
+        let x0, y0 = tile % tilesX * tileSize, tile / tilesX * tileSize
+
+        let x1, y1 = min image.width (x0 + tileSize), min image.height (y0 + tileSize)
+
+        for y in y0 .. y1 - 1 do
+            for i in y * image.width + x0 .. y * image.width + x1 - 1 do
+                let bin = getBin parameters image.data.[i]
+                local.[bin] <- local.[bin] + 1
+
+        local
+
+    Parallel.For(0, tilesX * tilesY,
+        (fun () -> Array.zeroCreate Exposure.Bins),
+        (fun tile _ local -> binTile tile local),
+        (fun local -> local |> Array.iteri (fun bin count -> if count <> 0 then Interlocked.Add(&histogram.[bin], count) |> ignore))) |> ignore
+
+    histogram
+
+// get average log2 luminance of the pixels between the percentiles; returns None if there are no pixels in the range
+let getAverageLogLuminance parameters (histogram: int array) =
+    let counts = histogram |> Array.mapi (fun bin count -> if bin = 0 then 0.f else float32 count)
+    let total = Array.sum counts
+    let low, high = total * parameters.lowPercentile, total * parameters.highPercentile
+
+    let mutable below, weight, sum = 0.f, 0.f, 0.f
+
+    for bin in 0 .. counts.Length - 1 do
+        let w = max 0.f (min (below + counts.[bin]) high - max below low)
+
+        weight <- weight + w
+        sum <- sum + w * getBinLogLuminance parameters bin
+        below <- below + counts.[bin]
+
+    if weight > 0.f then Some (sum / weight) else None
+
+// move adapted log2 luminance towards the target; previous is None for the first frame
+let adapt previous target rate =
+    match previous, target with
+    | Some p, Some t -> p + (t - p) * rate
+    | Some p, None -> p
+    | None, Some t -> t
+    | None, None -> log key / log 2.f
+
+// get exposure for the adapted log2 luminance and compensation in stops
+let getExposure adapted compensation =
+    key / 2.f ** adapted * 2.f ** compensation
+
+// scale image colors by the exposure
+let expose (exposure: float32) (image: Image) =
+    { image with data = image.data |> Array.map (fun c -> c * exposure) }
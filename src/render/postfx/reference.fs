@@ -0,0 +1,177 @@
+// CPU port of the tonemap curve in postfx/tonemap.h and of the FXAA 3.11 quality path (FXAA_QUALITY__PRESET 12,
+// green as luma); produces golden images for the two-pass postfx chain (tonemap.hlsl + fxaa.hlsl) and for the fused
+// tonemap_fxaa.hlsl pass, so that they can be compared without a GPU
+module Render.PostFX.Reference
+
+// image with one color per pixel, rows top to bottom
+type Image =
+    { width: int
+      height: int
+      data: Vector3 array }
+
+// FXAA settings; match postfx/fxaa.hlsl
+let private fxaaSubpix = 0.75f
+let private fxaaEdgeThreshold = 0.166f
+let private fxaaEdgeThresholdMin = 0.0833f
+let private fxaaSteps = [| 1.f; 1.5f; 2.f; 4.f; 12.f |]
+
+// filmic tonemapping, approximation by J. Heil & R. Burgess-Dawson; the result is in sRGB
+let tonemap (color: Vector3) =
+    let curve c =
+        let x = max 0.f (c - 0.004f)
+        (x * (6.2f * x + 0.5f)) / (x * (6.2f * x + 1.7f) + 0.06f)
+
+    Vector3(curve color.x, curve color.y, curve color.z)
+
+// quantize color to UNorm8, like R8G8B8A8_UNorm render targets do
+let quantize (color: Vector3) =
+    let q c = round (max 0.f (min 1.f c) * 255.f) / 255.f
+    Vector3(q color.x, q color.y, q color.z)
+
+// get pixel with clamp addressing
+let private getPixel image x y =
+    image.data.[(max 0 (min (image.height - 1) y)) * image.width + (max 0 (min (image.width - 1) x))]
+
+// bilinear filtering with clamp addressing; position is in pixels, pixel centers are at .5
+let private sample image (px: float32) (py: float32) =
+    let x, y = px - 0.5f, py - 0.5f
+    let ix, iy = int (floor x), int (floor y)
+    let fx, fy = x - float32 ix, y - float32 iy
+
+    let top = Vector3.Lerp(getPixel image ix iy, getPixel image (ix + 1) iy, fx)
+    let bottom = Vector3.Lerp(getPixel image ix (iy + 1), getPixel image (ix + 1) (iy + 1), fx)
+
+    Vector3.Lerp(top, bottom, fy)
+
+// FxaaPixelShader quality path for one pixel; positions are in pixels instead of texture coordinates, which does not
+// change the result since all offsets are relative to the frame size
+let private fxaaPixel image x y =
+    let luma dx dy = (getPixel image (x + dx) (y + dy)).y
+    let sampleLuma (p: Vector2) = (sample image p.x p.y).y
+
+    let rgbM = getPixel image x y
+    let lumaM = rgbM.y
+    let lumaS, lumaE, lumaN, lumaW = luma 0 1, luma 1 0, luma 0 -1, luma -1 0
+
+    let rangeMax = max (max lumaN lumaW) (max lumaE (max lumaS lumaM))
+    let rangeMin = min (min lumaN lumaW) (min lumaE (min lumaS lumaM))
+    let range = rangeMax - rangeMin
+
+    if range < max fxaaEdgeThresholdMin (rangeMax * fxaaEdgeThreshold) then rgbM
+    else
+        let lumaNW, lumaSE, lumaNE, lumaSW = luma -1 -1, luma 1 1, luma 1 -1, luma -1 1
+
+        let lumaNS = lumaN + lumaS
+        let lumaWE = lumaW + lumaE
+        let subpixRcpRange = 1.f / range
+        let subpixNSWE = lumaNS + lumaWE
+        let edgeHorz1 = (-2.f * lumaM) + lumaNS
+        let edgeVert1 = (-2.f * lumaM) + lumaWE
+
+        let lumaNESE = lumaNE + lumaSE
+        let lumaNWNE = lumaNW + lumaNE
+        let edgeHorz2 = (-2.f * lumaE) + lumaNESE
+        let edgeVert2 = (-2.f * lumaN) + lumaNWNE
+
+        let lumaNWSW = lumaNW + lumaSW
+        let lumaSWSE = lumaSW + lumaSE
+        let edgeHorz4 = (abs edgeHorz1 * 2.f) + abs edgeHorz2
+        let edgeVert4 = (abs edgeVert1 * 2.f) + abs edgeVert2
+        let edgeHorz3 = (-2.f * lumaW) + lumaNWSW
+        let edgeVert3 = (-2.f * lumaS) + lumaSWSE
+        let edgeHorz = abs edgeHorz3 + edgeHorz4
+        let edgeVert = abs edgeVert3 + edgeVert4
+
+        let subpixNWSWNESE = lumaNWSW + lumaNESE
+        let horzSpan = edgeHorz >= edgeVert
+        let subpixA = subpixNSWE * 2.f + subpixNWSWNESE
+
+        let lumaN = if horzSpan then lumaN else lumaW
+        let lumaS = if horzSpan then lumaS else lumaE
+        let subpixB = (subpixA * (1.f / 12.f)) - lumaM
+
+        let gradientN = lumaN - lumaM
+        let gradientS = lumaS - lumaM
+        let pairN = abs gradientN >= abs gradientS
+        let gradient = max (abs gradientN) (abs gradientS)
+        let lengthSign = if pairN then -1.f else 1.f
+        let subpixC = max 0.f (min 1.f (abs subpixB * subpixRcpRange))
+
+        // search for the edge ends along the edge, half a pixel towards the steeper neighbor
+        let posM = Vector2(float32 x + 0.5f, float32 y + 0.5f)
+        let offNP = if horzSpan then Vector2(1.f, 0.f) else Vector2(0.f, 1.f)
+        let posB = posM + (if horzSpan then Vector2(0.f, lengthSign * 0.5f) else Vector2(lengthSign * 0.5f, 0.f))
+
+        let subpixD = (-2.f * subpixC) + 3.f
+        let subpixE = subpixC * subpixC
+        let lumaNN = if pairN then lumaN + lumaM else lumaS + lumaM
+        let gradientScaled = gradient * 1.f / 4.f
+        let lumaMM = lumaM - lumaNN * 0.5f
+        let subpixF = subpixD * subpixE
+        let lumaMLTZero = lumaMM < 0.f
+
+        let mutable posN = posB - offNP * fxaaSteps.[0]
+        let mutable posP = posB + offNP * fxaaSteps.[0]
+        let mutable lumaEndN = sampleLuma posN - lumaNN * 0.5f
+        let mutable lumaEndP = sampleLuma posP - lumaNN * 0.5f
+        let mutable doneN = abs lumaEndN >= gradientScaled
+        let mutable doneP = abs lumaEndP >= gradientScaled
+
+        if not doneN then posN <- posN - offNP * fxaaSteps.[1]
+        if not doneP then posP <- posP + offNP * fxaaSteps.[1]
+
+        let mutable search = 2
+
+        while search < fxaaSteps.Length && not (doneN && doneP) do
+            if not doneN then lumaEndN <- sampleLuma posN - lumaNN * 0.5f
+            if not doneP then lumaEndP <- sampleLuma posP - lumaNN * 0.5f
+            doneN <- abs lumaEndN >= gradientScaled
+            doneP <- abs lumaEndP >= gradientScaled
+            if not doneN then posN <- posN - offNP * fxaaSteps.[search]
+            if not doneP then posP <- posP + offNP * fxaaSteps.[search]
+            search <- search + 1
+
+        let dstN = if horzSpan then posM.x - posN.x else posM.y - posN.y
+        let dstP = if horzSpan then posP.x - posM.x else posP.y - posM.y
+
+        let goodSpanN = (lumaEndN < 0.f) <> lumaMLTZero
+        let goodSpanP = (lumaEndP < 0.f) <> lumaMLTZero
+        let spanLengthRcp = 1.f / (dstP + dstN)
+
+        let directionN = dstN < dstP
+        let dst = min dstN dstP
+        let goodSpan = if directionN then goodSpanN else goodSpanP
+        let subpixG = subpixF * subpixF
+        let pixelOffset = (dst * -spanLengthRcp) + 0.5f
+        let subpixH = subpixG * fxaaSubpix
+
+        let pixelOffsetGood = if goodSpan then pixelOffset else 0.f
+        let pixelOffsetSubpix = max pixelOffsetGood subpixH
+        let pos = if horzSpan then Vector2(posM.x, posM.y + pixelOffsetSubpix * lengthSign) else Vector2(posM.x + pixelOffsetSubpix * lengthSign, posM.y)
+
+        sample image pos.x pos.y
+
+// run FXAA on a tonemapped image
+let fxaa image =
+    { image with data = Array.init image.data.Length (fun i -> fxaaPixel image (i % image.width) (i / image.width)) }
+
+// run the two-pass chain on an HDR image: tonemap to an 8-bit target, then FXAA to the 8-bit back buffer
+let renderTwoPass hdr =
+    let ldr = { hdr with data = hdr.data |> Array.map (tonemap >> quantize) }
+    let result = fxaa ldr
+
+    { result with data = result.data |> Array.map quantize }
+
+// run the fused pass on an HDR image: FXAA reads tonemapped colors without quantization
+let renderFused hdr =
+    let result = fxaa { hdr with data = hdr.data |> Array.map tonemap }
+
+    { result with data = result.data |> Array.map quantize }
+
+// get maximum and average absolute channel difference between images
+let compare (a: Image) (b: Image) =
+    assert (a.width = b.width && a.height = b.height)
+
+    let diff = Array.map2 (fun (l: Vector3) (r: Vector3) -> max (abs (l.x - r.x)) (max (abs (l.y - r.y)) (abs (l.z - r.z)))) a.data b.data
+
+    Array.max diff, Array.average diff
@@ -0,0 +1,145 @@
+module Render.PostFX.Tests
+
+open Render.PostFX.Reference
+
+// HDR test scene: sky gradient, a bright quad with slanted edges, a disk, a thin diagonal line and a dark corner; the
+// shapes are point sampled at pixel centers, so the edges are aliased
+let private scene =
+    let width, height = 256, 192
+
+    let color x y =
+        let fx, fy = float32 x + 0.5f, float32 y + 0.5f
+        let u, v = fx * 0.966f - fy * 0.259f, fx * 0.259f + fy * 0.966f
+
+        if u > 40.f && u < 140.f && v > 60.f && v < 120.f then Vector3(4.f, 3.f, 2.f)
+        elif (fx - 190.f) * (fx - 190.f) + (fy - 60.f) * (fy - 60.f) < 900.f then Vector3(0.2f, 1.5f, 0.3f)
+        elif abs (fx * 0.6f - fy + 150.f) < 0.6f then Vector3(8.f, 8.f, 8.f)
+        elif fx < 50.f && fy > 150.f then Vector3(0.01f, 0.01f, 0.02f)
+        else Vector3(0.3f, 0.4f, 0.5f) * (1.f + fy / float32 height)
+
+    { width = width; height = height; data = Array.init (width * height) (fun i -> color (i % width) (i / width)) }
+
+let testTonemap () =
+    let values = Array.init 1000 (fun i -> (tonemap (Vector3(float32 i * 0.01f, 0.f, 0.f))).x)
+
+    // black stays black, the curve is monotonic and saturates below 1
+    assert (values.[0] = 0.f)
+    assert (values |> Array.pairwise |> Array.forall (fun (a, b) -> a <= b))
+    assert (values.[999] > 0.98f && values.[999] < 1.f)
+    assert (abs (values.[100] - 0.8412f) < 1e-3f)
+
+let testFxaaFlat () =
+    let image = { width = 16; height = 16; data = Array.create 256 (Vector3(0.2f, 0.5f, 0.7f)) }
+
+    assert ((fxaa image).data = image.data)
+
+let testFxaaEdges () =
+    let ldr = { scene with data = scene.data |> Array.map tonemap }
+    let result = fxaa ldr
+
+    // FXAA only blends neighbors, so the result stays in the range of the 3x3 neighborhood
+    for y in 0 .. scene.height - 1 do
+        for x in 0 .. scene.width - 1 do
+            let neighbors =
+                [| for dy in -1 .. 1 do
+                   for dx in -1 .. 1 do
+                   yield ldr.data.[(max 0 (min (scene.height - 1) (y + dy))) * scene.width + (max 0 (min (scene.width - 1) (x + dx)))].y |]
+
+            let luma = result.data.[y * scene.width + x].y
+            assert (luma >= Array.min neighbors - 1e-5f && luma <= Array.max neighbors + 1e-5f)
+
+    // slanted edges of the quad get intermediate values
+    let quad, sky = (tonemap (Vector3(4.f, 3.f, 2.f))).y, ldr.data.[30].y
+    let blended = result.data |> Array.filter (fun c -> c.y > min quad sky + 0.02f && c.y < max quad sky - 0.02f)
+    assert (blended.Length > 100)
+
+let testFusedMatchesTwoPass () =
+    // fused pass skips the 8-bit quantization before FXAA; that changes edge decisions near thresholds for a few
+    // pixels, other pixels match within a quantization step
+    let fused, twoPass = renderFused scene, renderTwoPass scene
+    let _, averageDiff = compare fused twoPass
+    let changed = Array.map2 (fun (l: Vector3) (r: Vector3) -> abs (l.y - r.y) > 1.5f / 255.f) fused.data twoPass.data |> Array.filter id
+
+    assert (averageDiff < 0.1f / 255.f)
+    assert (changed.Length < fused.data.Length / 200)
+
+// default exposure settings
+let private exposureParameters: ExposureReference.Parameters =
+    { minLogLuminance = -10.f; logLuminanceRange = 16.f; lowPercentile = 0.5f; highPercentile = 0.95f }
+
+// get image with the luminance values
+let private grayImage width height (luminance: int -> float32) =
+    { width = width; height = height; data = Array.init (width * height) (fun i -> Vector3(luminance i, luminance i, luminance i)) }
+
+let testExposureBins () =
+    let bin l = ExposureReference.getBin exposureParameters (Vector3(l, l, l))
+
+    // black and very dark pixels go to bin 0, very bright ones to the last bin
+    assert (bin 0.f = 0)
+    assert (bin (2.f ** -10.5f) = 0)
+    assert (bin (2.f ** -9.99f) = 1)
+    assert (bin 1e10f = Exposure.Bins - 1)
+
+    // bins are monotonic, and bin centers map to their bins
+    assert (Array.init 1000 (fun i -> bin (2.f ** (float32 i * 0.02f - 11.f))) |> Array.pairwise |> Array.forall (fun (a, b) -> a <= b))
+
+    for b in 1 .. Exposure.Bins - 1 do
+        assert (bin (2.f ** ExposureReference.getBinLogLuminance exposureParameters b) = b)
+
+let testExposureHistogramParallel () =
+    // size is not a multiple of the tile size to cover partial tiles
+    let random = System.Random(42)
+    let image = grayImage 300 170 (fun _ -> float32 (random.NextDouble() ** 4.0 * 100.0))
+
+    let serial = ExposureReference.buildHistogram exposureParameters image
+    let threaded = ExposureReference.buildHistogramParallel exposureParameters image
+
+    assert (serial = threaded)
+    assert (Array.sum threaded = image.data.Length)
+    assert (ExposureReference.buildHistogramParallel exposureParameters scene = ExposureReference.buildHistogram exposureParameters scene)
+
+let testExposurePercentiles () =
+    // 15% dark pixels, 80% at luminance 0.5 and 5% highlights; the percentile range only covers the 0.5 pixels, so
+    // they are exposed to middle gray, up to half a bin
+    let image = grayImage 100 100 (fun i -> if i < 1500 then 0.05f elif i < 9500 then 0.5f else 1000.f)
+    let average = (ExposureReference.getAverageLogLuminance exposureParameters (ExposureReference.buildHistogram exposureParameters image)).Value
+    let halfBin = exposureParameters.logLuminanceRange / float32 (Exposure.Bins - 1) / 2.f
+
+    assert (abs (average - log 0.5f / log 2.f) <= halfBin)
+    assert (abs (log (ExposureReference.getExposure average 0.f * 0.5f / 0.18f) / log 2.f) <= halfBin)
+
+    // black pixels are ignored
+    let black = { image with data = Array.append image.data (Array.create 5000 Vector3.Zero) }
+    assert (ExposureReference.getAverageLogLuminance exposureParameters (ExposureReference.buildHistogram exposureParameters black) = Some average)
+
+    // an empty range has no average
+    assert ((ExposureReference.getAverageLogLuminance exposureParameters (ExposureReference.buildHistogram exposureParameters (grayImage 4 4 (fun _ -> 0.f)))).IsNone)
+
+let testExposureScale () =
+    // brighter scenes get proportionally lower exposure, so they tonemap to the same image, up to bin resolution, as
+    // long as the scene stays in the luminance range
+    let getSceneExposure scale =
+        let image = ExposureReference.expose scale scene
+        let average = ExposureReference.getAverageLogLuminance exposureParameters (ExposureReference.buildHistogramParallel exposureParameters image)
+        ExposureReference.getExposure (ExposureReference.adapt None average 1.f) 0.f
+
+    let reference = getSceneExposure 1.f
+
+    for scale in [0.01f; 0.3f; 3.f; 7.f] do
+        assert (abs (log (getSceneExposure scale * scale / reference) / log 2.f) < 0.15f)
+
+    // compensation is in stops
+    assert (abs (ExposureReference.getExposure 1.f 1.f / ExposureReference.getExposure 1.f 0.f - 2.f) < 1e-5f)
+
+let testExposureAdaptation () =
+    // adaptation does not depend on the frame rate
+    let run frames =
+        let rate = Exposure.GetAdaptationRate(1.f / float32 frames, 2.f)
+        Seq.fold (fun adapted _ -> ExposureReference.adapt (Some adapted) (Some 4.f) rate) -2.f (seq { 1 .. frames })
+
+    assert (abs (run 30 - run 144) < 1e-4f)
+    assert (abs (run 30 - (4.f - 6.f * exp -2.f)) < 1e-4f)
+
+    // first frame starts at the target, frames without pixels in the range keep the adapted value
+    assert (ExposureReference.adapt None (Some 3.f) 0.1f = 3.f)
+    assert (ExposureReference.adapt (Some 1.f) None 0.1f = 1.f)
@@ -30,7 +30,9 @@ type private RenderTargetSlot =
         | None -> desc
 
 // render target
-and RenderTarget(resource: Resource, view: ShaderResourceView, colorView: RenderTargetView, depthView: DepthStencilView, ?pool: RenderTargetPool) =
+and RenderTarget(resource: Resource, view: ShaderResourceView, colorView: RenderTargetView, depthView: DepthStencilView, ?pool: RenderTargetPool, ?unorderedView: UnorderedAccessView) =
+    let unorderedView = defaultArg unorderedView null
+
     // release target to the pool via dispose, if it's bound to a pool; dispose of resources otherwise
     interface IDisposable with
         member this.Dispose() =
@@ -42,6 +44,7 @@ and RenderTarget(resource: Resource, view: ShaderResourceView, colorView: Render
                 if view <> null then view.Dispose()
                 if colorView <> null then colorView.Dispose()
                 if depthView <> null then depthView.Dispose()
+                if unorderedView <> null then unorderedView.Dispose()
 
     // get texture resource
     member this.Resource = resource
@@ -55,6 +58,9 @@ and RenderTarget(resource: Resource, view: ShaderResourceView, colorView: Render
     // get depth target view
     member this.DepthView = depthView
 
+    // get unordered access view; only color targets that are acquired with unordered access have it
+    member this.UnorderedView = unorderedView
+
 // render target pool
 and RenderTargetPool(device) =
     // render target cache
@@ -68,9 +74,10 @@ and RenderTargetPool(device) =
         // create views
         let view = new ShaderResourceView(device, resource)
         let colorView = new RenderTargetView(device, resource)
+        let unorderedView = if desc.BindFlags.HasFlag(BindFlags.UnorderedAccess) then new UnorderedAccessView(device, resource) else null
 
         // create target object
-        new RenderTarget(resource, view, colorView, null, this)
+        new RenderTarget(resource, view, colorView, null, this, unorderedView)
 
     // create depth render target by description
     member private this.CreateDepth (desc: Texture2DDescription) =
@@ -121,8 +128,10 @@ and RenderTargetPool(device) =
             target
 
     // simplified acquire interface
-    member this.Acquire (owner, width, height, format, ?miplevels, ?samples) =
-        let bindFlags = BindFlags.ShaderResource ||| (if Formats.isDepth format then BindFlags.DepthStencil else BindFlags.RenderTarget)
+    member this.Acquire (owner, width, height, format, ?miplevels, ?samples, ?unorderedAccess) =
+        let bindFlags =
+            BindFlags.ShaderResource ||| (if Formats.isDepth format then BindFlags.DepthStencil else BindFlags.RenderTarget) |||
+            (if defaultArg unorderedAccess false then BindFlags.UnorderedAccess else BindFlags.None)
         let desc = Texture2DDescription(Width = width, Height = height, MipLevels = defaultArg miplevels 1, ArraySize = 1, Format = format,
                     SampleDescription = SampleDescription(int (defaultArg samples MSAA.None), 0), Usage = ResourceUsage.Default, BindFlags = bindFlags)
         this.Acquire(owner, desc)
@@ -0,0 +1,94 @@
+// CPU port of the Pos_TBN_Tex1_Bone4_Packed decode and the 4-bone blend in skinning.hlsl, and of the
+// Pos_TBN_Tex1_Skinned decode in fill_default.h; validates the skinning pre-pass against skinning in the vertex shader
+module Render.Skinning.Reference
+
+open System
+
+open Render
+
+// decoded vertex
+type Vertex =
+    { position: Vector3
+      normal: Vector3
+      // xyz is the tangent, w is the bitangent sign
+      tangent: Vector4
+      // compressed texture coordinates
+      texcoord: uint32
+      boneIndices: int array
+      boneWeights: float32 array }
+
+// vertex sizes in bytes
+let sourceStride = (VertexLayouts.get VertexFormat.Pos_TBN_Tex1_Bone4_Packed).size
+let outputStride = (VertexLayouts.get VertexFormat.Pos_TBN_Tex1_Skinned).size
+
+let private unpackUNorm10 (value: uint32) =
+    Vector3(float32 (value &&& 1023u), float32 ((value >>> 10) &&& 1023u), float32 ((value >>> 20) &&& 1023u)) / 1023.f
+
+let private unpackDirection (value: uint32) =
+    unpackUNorm10 value * 2.f - Vector3(1.f, 1.f, 1.f)
+
+let private getBitangentSign (value: uint32) =
+    float32 (value >>> 30) / 3.f * 2.f - 1.f
+
+// decode a Pos_TBN_Tex1_Bone4_Packed vertex
+let decode (info: MeshCompressionInfo) (data: byte array) vertex =
+    let offset = vertex * sourceStride
+    let u16 i = float32 (BitConverter.ToUInt16(data, offset + i)) / 65535.f
+    let u32 i = BitConverter.ToUInt32(data, offset + i)
+
+    let position = Vector3(u16 0, u16 2, u16 4)
+    let tangent = u32 12
+
+    { position = Vector3(position.x * info.posScale.x, position.y * info.posScale.y, position.z * info.posScale.z) + info.posOffset
+      normal = unpackDirection (u32 8)
+      tangent = Vector4(unpackDirection tangent, getBitangentSign tangent)
+      texcoord = u32 16
+      boneIndices = Array.init 4 (fun i -> int data.[offset + 20 + i])
+      boneWeights = Array.init 4 (fun i -> float32 data.[offset + 24 + i] / 255.f) }
+
+// get the blended bone transform of the vertex
+let getTransform (bones: Matrix34 array) (v: Vertex) =
+    Array.fold2 (fun acc index weight -> acc + bones.[index] * weight) Matrix34.Zero v.boneIndices v.boneWeights
+
+// skin a vertex without quantization; this is what the fill shaders did per pass before the pre-pass
+let skin (bones: Matrix34 array) (v: Vertex) =
+    let transform = getTransform bones v
+
+    { v with
+        position = Matrix34.TransformPosition(transform, v.position)
+        normal = Vector3.Normalize(Matrix34.TransformDirection(transform, v.normal))
+        tangent = Vector4(Vector3.Normalize(Matrix34.TransformDirection(transform, v.tangent.xyz)), v.tangent.w) }
+
+// encode a skinned vertex as Pos_TBN_Tex1_Skinned
+let encode (v: Vertex) (data: byte array) vertex =
+    let offset = vertex * outputStride
+    let write i (value: uint32) = Array.blit (BitConverter.GetBytes(value)) 0 data (offset + i) 4
+
+    let bitangentSign = if v.tangent.w > 0.f then 3u <<< 30 else 0u
+
+    write 0 (BitConverter.ToUInt32(BitConverter.GetBytes(v.position.x), 0))
+    write 4 (BitConverter.ToUInt32(BitConverter.GetBytes(v.position.y), 0))
+    write 8 (BitConverter.ToUInt32(BitConverter.GetBytes(v.position.z), 0))
+    write 12 (Math.Pack.packDirectionUNorm v.normal 10)
+    write 16 (Math.Pack.packDirectionUNorm v.tangent.xyz 10 ||| bitangentSign)
+    write 20 v.texcoord
+
+// decode a Pos_TBN_Tex1_Skinned vertex; bone data is not stored
+let decodeSkinned (data: byte array) vertex =
+    let offset = vertex * outputStride
+    let u32 i = BitConverter.ToUInt32(data, offset + i)
+    let f32 i = BitConverter.ToSingle(data, offset + i)
+
+    let tangent = u32 16
+
+    { position = Vector3(f32 0, f32 4, f32 8)
+      normal = unpackDirection (u32 12)
+      tangent = Vector4(unpackDirection tangent, getBitangentSign tangent)
+      texcoord = u32 20
+      boneIndices = [||]
+      boneWeights = [||] }
+
+// run the skinning pass for a vertex range of the source buffer; writes the same range of the output buffer
+let skinRange (info: MeshCompressionInfo) (bones: Matrix34 array) (source: byte array) (output: byte array) first count =
+    for vertex in first .. first + count - 1 do
+        encode (skin bones (decode info source vertex)) output vertex
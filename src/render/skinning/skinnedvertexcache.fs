@@ -0,0 +1,82 @@
+namespace Render.Skinning
+
+open System.Collections.Generic
+
+open SharpDX.Direct3D11
+
+open Render
+
+// skinned vertex buffer of a mesh; vertices keep their indices, so fragments use the same vertex ranges as in the
+// source buffer
+type SkinnedVertexBuffer(device: Device, vertexCount: int) =
+    static let stride = (VertexLayouts.get VertexFormat.Pos_TBN_Tex1_Skinned).size
+
+    let buffer =
+        new Buffer(device.Device, vertexCount * stride, ResourceUsage.Default, BindFlags.VertexBuffer ||| BindFlags.UnorderedAccess,
+            CpuAccessFlags.None, ResourceOptionFlags.BufferAllowRawViews, 0)
+
+    let uaView =
+        new UnorderedAccessView(device.Device, buffer,
+            UnorderedAccessViewDescription(Format = SharpDX.DXGI.Format.R32_Typeless, Dimension = UnorderedAccessViewDimension.Buffer, Buffer =
+                UnorderedAccessViewDescription.BufferResource(ElementCount = vertexCount * stride / 4, Flags = UnorderedAccessViewBufferFlags.Raw)))
+
+    // vertex size in bytes
+    static member Stride = stride
+
+    member this.VertexCount = vertexCount
+
+    // get vertex buffer
+    member this.Resource = buffer
+
+    // get unordered view for the skinning pass
+    member this.UnorderedView = uaView
+
+    interface System.IDisposable with
+        member this.Dispose() =
+            uaView.Dispose()
+            buffer.Dispose()
+
+// skinned vertex buffers for the meshes that are rendered in a frame; the skinning pass fills them once per frame, and
+// all passes (depth, shadow maps, color) and all instances of the mesh read them, since the instances share the
+// skeleton
+// buffers are reused between frames; buffers of meshes that were not skinned in a frame are released by Trim
+type SkinnedVertexCache(device: Device) =
+    let buffers = Dictionary<Mesh, SkinnedVertexBuffer>(HashIdentity.Reference)
+    let used = HashSet<Mesh>(HashIdentity.Reference)
+
+    // get the range of source vertices (first vertex, vertex count) of the fragment; fragments are stored one after
+    // another in the vertex buffer
+    static member GetFragmentVertexRange(mesh: Mesh, fragment: MeshFragment) =
+        let stride = (VertexLayouts.get fragment.vertexFormat).size
+        let next = mesh.fragments |> Array.fold (fun e f -> if f.vertexOffset > fragment.vertexOffset then min e f.vertexOffset else e) mesh.vertices.Size
+
+        fragment.vertexOffset / stride, (next - fragment.vertexOffset) / stride
+
+    // get skinned vertex buffer offset in bytes of the fragment
+    static member GetFragmentOffset(fragment: MeshFragment) =
+        fragment.vertexOffset / (VertexLayouts.get fragment.vertexFormat).size * SkinnedVertexBuffer.Stride
+
+    // get the skinned vertex buffer for the mesh, creating it if necessary, and mark it as used in this frame
+    member this.Get(mesh: Mesh) =
+        used.Add(mesh) |> ignore
+
+        match buffers.TryGetValue(mesh) with
+        | true, buffer -> buffer
+        | _ ->
+            let buffer = new SkinnedVertexBuffer(device, mesh.vertices.Size / (VertexLayouts.get VertexFormat.Pos_TBN_Tex1_Bone4_Packed).size)
+            buffers.Add(mesh, buffer)
+            buffer
+
+    // get the skinned vertex buffer for the mesh if it was skinned in this frame
+    member this.TryGet(mesh: Mesh) =
+        if used.Contains(mesh) then Some buffers.[mesh] else None
+
+    // release buffers of the meshes that were not used since the last call; has to be called once per frame, before
+    // the skinning pass
+    member this.Trim() =
+        for KeyValue(mesh, buffer) in Seq.toArray buffers do
+            if not (used.Contains(mesh)) then
+                (buffer :> System.IDisposable).Dispose()
+                buffers.Remove(mesh) |> ignore
+
+        used.Clear()
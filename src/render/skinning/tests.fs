@@ -0,0 +1,95 @@
+module Render.Skinning.Tests
+
+open Render
+open Render.Skinning.Reference
+
+let private info: MeshCompressionInfo =
+    { posOffset = Vector3(-2.f, 0.f, -1.f); posScale = Vector3(4.f, 6.f, 2.f); uvOffset = Vector2(0.f, 0.f); uvScale = Vector2(1.f, 1.f) }
+
+// bone palette with random rotations and translations
+let private bones =
+    let random = System.Random(42)
+    let coord () = float32 (random.NextDouble()) * 2.f - 1.f
+
+    Array.init 16 (fun _ ->
+        Matrix34.Translation(coord (), coord (), coord ()) * Matrix34.RotationAxis(Vector3.Normalize(Vector3(coord (), coord (), coord ())), coord () * 3.f))
+
+let private vertexCount = 1000
+
+// random vertices packed the same way the mesh packer does; weights sum to 255
+let private source =
+    let random = System.Random(42)
+    let coord () = float32 (random.NextDouble()) * 2.f - 1.f
+
+    Array.init vertexCount (fun _ ->
+        let normal = Vector3.Normalize(Vector3(coord (), coord (), coord ()))
+        let tangent = Vector3.Normalize(Vector3.Cross(normal, Vector3.Normalize(Vector3(coord (), coord (), coord ()))))
+        let weights = Array.init 3 (fun _ -> random.Next(64))
+
+        let words =
+            [| uint32 (random.Next(65536)) ||| (uint32 (random.Next(65536)) <<< 16)
+               uint32 (random.Next(65536))
+               Math.Pack.packDirectionUNorm normal 10
+               Math.Pack.packDirectionUNorm tangent 10 ||| (if random.Next(2) = 0 then 3u <<< 30 else 0u)
+               uint32 (random.Next()) |]
+
+        Array.append
+            (words |> Array.collect System.BitConverter.GetBytes)
+            (Array.append (Array.init 4 (fun _ -> byte (random.Next(bones.Length)))) (Array.map byte (Array.append [| 255 - Array.sum weights |] weights))))
+    |> Array.concat
+
+let testDecode () =
+    assert (source.Length = vertexCount * sourceStride)
+
+    for vertex in 0 .. vertexCount - 1 do
+        let v = decode info source vertex
+
+        // positions are in the compression box, directions are unit length up to quantization, weights sum to 1
+        assert (v.position.x >= -2.f && v.position.x <= 2.f && v.position.y >= 0.f && v.position.y <= 6.f && v.position.z >= -1.f && v.position.z <= 1.f)
+        assert (abs (v.normal.Length - 1.f) < 5e-3f && abs (v.tangent.xyz.Length - 1.f) < 5e-3f)
+        assert (abs (v.tangent.w) = 1.f)
+        assert (abs (Array.sum v.boneWeights - 1.f) < 1e-5f)
+        assert (v.boneIndices |> Array.forall (fun i -> i >= 0 && i < bones.Length))
+
+let testSkinBlend () =
+    let v = decode info source 0
+
+    // identity bones keep the vertex
+    let identity = skin (Array.create bones.Length Matrix34.Identity) v
+    assert ((identity.position - v.position).Length < 1e-5f)
+    assert ((identity.normal - Vector3.Normalize(v.normal)).Length < 1e-5f)
+
+    // one bone with the full weight applies its transform
+    let single = skin bones { v with boneIndices = [| 5; 0; 0; 0 |]; boneWeights = [| 1.f; 0.f; 0.f; 0.f |] }
+    assert ((single.position - Matrix34.TransformPosition(bones.[5], v.position)).Length < 1e-5f)
+
+    // weights blend the transformed positions
+    let half = skin bones { v with boneIndices = [| 2; 7; 0; 0 |]; boneWeights = [| 0.5f; 0.5f; 0.f; 0.f |] }
+    let expected = (Matrix34.TransformPosition(bones.[2], v.position) + Matrix34.TransformPosition(bones.[7], v.position)) * 0.5f
+    assert ((half.position - expected).Length < 1e-5f)
+
+let testSkinnedMatchesVertexShader () =
+    let output = Array.zeroCreate (vertexCount * outputStride)
+
+    skinRange info bones source output 0 vertexCount
+
+    // the pre-pass stores positions as floats, and directions with the same 10-bit quantization as the source
+    for vertex in 0 .. vertexCount - 1 do
+        let expected = skin bones (decode info source vertex)
+        let actual = decodeSkinned output vertex
+
+        assert (actual.position = expected.position)
+        assert ((actual.normal - expected.normal).Length < 2e-3f)
+        assert ((actual.tangent.xyz - expected.tangent.xyz).Length < 2e-3f)
+        assert (actual.tangent.w = expected.tangent.w)
+        assert (actual.texcoord = expected.texcoord)
+
+let testSkinRange () =
+    let output = Array.zeroCreate (vertexCount * outputStride)
+
+    skinRange info bones source output 100 50
+
+    // only the fragment range is written
+    assert (Array.sub output 0 (100 * outputStride) |> Array.forall ((=) 0uy))
+    assert (Array.sub output (150 * outputStride) (output.Length - 150 * outputStride) |> Array.forall ((=) 0uy))
+    assert ((decodeSkinned output 120).position = (skin bones (decode info source 120)).position)
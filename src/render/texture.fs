@@ -188,10 +188,8 @@ module private TextureLoaderDDS =
         data.Position <- 0L
         data
 
-    // load texture from file
-    let load device path =
-        use data = loadFile path
-
+    // load texture from stream
+    let loadStream device (data: DataStream) =
         // read header
         if data.Read<int>() <> getFourCC "DDS " then failwith "Unrecognized header: incorrect magic"
 
@@ -213,8 +211,22 @@ module private TextureLoaderDDS =
 
         Texture(resource, view)
 
+    // load texture from file
+    let load device path =
+        use data = loadFile path
+        loadStream device data
+
+    // load texture from native memory
+    let loadMemory device (data: nativeint) (size: int) =
+        use stream = new DataStream(data, int64 size, true, false)
+        loadStream device stream
+
 // texture loader
 module TextureLoader =
     // load texture from file
     let load device path =
-        TextureLoaderDDS.load device path
\ No newline at end of file
+        TextureLoaderDDS.load device path
+
+    // load texture from native memory
+    let loadMemory device data size =
+        TextureLoaderDDS.loadMemory device data size
\ No newline at end of file
@@ -11,6 +11,7 @@ type VertexLayout =
 type VertexFormat =
     | Pos_TBN_Tex1_Bone4_Packed = 0
     | Pos_Color = 1
+    | Pos_TBN_Tex1_Skinned = 2
 
 module VertexLayouts =
     // get a size of the input element
@@ -40,6 +41,16 @@ module VertexLayouts =
                 "BONEWEIGHTS", 0, Format.R8G8B8A8_UNorm
             |]
 
+    // output of the skinning pre-pass; position is skinned and decompressed, texcoord is copied from the source
+    let private Pos_TBN_Tex1_Skinned =
+        build
+            [|
+                "POSITION", 0, Format.R32G32B32_Float
+                "NORMAL", 0, Format.R10G10B10A2_UNorm
+                "TANGENT", 0, Format.R10G10B10A2_UNorm
+                "TEXCOORD", 0, Format.R16G16_UNorm
+            |]
+
     let private Pos_Color =
         build
             [|
@@ -52,4 +63,5 @@ module VertexLayouts =
         match format with
         | VertexFormat.Pos_TBN_Tex1_Bone4_Packed -> Pos_TBN_Tex1_Bone4_Packed
         | VertexFormat.Pos_Color -> Pos_Color
+        | VertexFormat.Pos_TBN_Tex1_Skinned -> Pos_TBN_Tex1_Skinned
         | _ -> failwith "Unknown format %A" format
@@ -6,6 +6,9 @@ open BuildSystem
 // build context
 let context = Context(System.Environment.CurrentDirectory, ".build")
 
+// packs from the command line (i.e. .build/assets.pack); the sandbox maps them for the whole session
+let packs = System.Environment.GetCommandLineArgs() |> Array.filter (fun arg -> arg.EndsWith(".pack"))
+
 // watchers for asset build/reload
 let assetWatcher (loader: Asset.Loader) =
     Core.FS.Watcher(".", fun path ->
@@ -22,6 +25,7 @@ let shaderBuilder = Shader.Builder([|"src/shaders"; context.BuildPath + "/shader
 let Shader path =
     let bin = context.Target path ".shader"
     context.Task(shaderBuilder, source = path, target = bin)
+    bin
 
 // mesh export
 let Mesh path =
@@ -32,15 +36,24 @@ let Mesh path =
     // export .mesh file
     let mesh = context.Target path ".mesh"
     context.Task(Dae.MeshBuilder.builder, source = dae, target = mesh)
+    mesh
 
 // build shaders
-Node.Glob "src/shaders/**.hlsl"
-|> Array.iter Shader
+let shaders =
+    Node.Glob "src/shaders/**.hlsl"
+    |> Array.map Shader
 
 // build meshes
-[|"mb"; "ma"; "max"|]
-|> Array.collect (fun ext -> Node.Glob (sprintf "art/**.%s" ext))
-|> Array.iter Mesh
+let meshes =
+    [|"mb"; "ma"; "max"|]
+    |> Array.collect (fun ext -> Node.Glob (sprintf "art/**.%s" ext))
+    |> Array.map Mesh
+
+// pack shaders and meshes; textures are built by mesh export tasks, so they are not known here and stay loose files
+// the pack is not rebuilt while the sandbox maps packs, since the file can't be rewritten; assets that are rebuilt
+// after the pack are newer than it, so the loader reads them from loose files instead
+if packs.Length = 0 then
+    context.Task(Pack.builder, sources = Array.append shaders meshes, target = Node (context.BuildPath + "/assets.pack"))
 
 // build code for all shader struct types
 System.AppDomain.CurrentDomain.GetAssemblies()
@@ -34,6 +34,10 @@ assets.context.Run()
 
 let dbgNulldraw = Core.DbgVar(false, "render/null draw")
 let dbgWireframe = Core.DbgVar(false, "render/wireframe")
+let dbgDeferred = Core.DbgVar(false, "render/deferred")
+let dbgFusedPostfx = Core.DbgVar(true, "render/fused tonemap fxaa")
+let dbgExposureSpeed = Core.DbgVar(1.5f, "render/exposure/adaptation speed")
+let dbgExposureCompensation = Core.DbgVar(0.f, "render/exposure/compensation")
 let dbgPresentInterval = Core.DbgVar(0, "vsync interval")
 let dbgName = Core.DbgVar("foo", "name")
 let dbgTexfilter = Core.DbgVar(Filter.Anisotropic, "render/texture/filter")
@@ -48,30 +52,39 @@ form.SizeChanged.Add(fun args ->
     device.OnSizeChanged ()
     rtpool.ReleaseUnused())
 
-// setup asset loaders
+// setup asset loaders; packs from the command line take precedence over loose files that are older than the pack
 let assetDB = Asset.Database()
+let assetPacks = assets.packs |> Array.map (fun path -> new Asset.Pack(path))
 let fixupContext loader = Core.Serialization.Fixup.Create (device.Device, loader)
 let loader =
     Asset.Loader(assetDB,
         dict [
-            ".dds", fun path l -> Render.TextureLoader.load device.Device path |> box
-            ".mesh", fun path l -> (Core.Serialization.Load.fromFileEx path (fixupContext l)) :?> Render.Mesh |> box
-            ".shader", fun path l -> Core.Serialization.Load.fromFileEx path (fixupContext l) |> box
-        ])
+            ".dds", fun path l -> l.Read(path, Render.TextureLoader.loadMemory device.Device) |> box
+            ".mesh", fun path l -> l.Read(path, fun data size -> Core.Serialization.Load.fromMemoryEx data size (fixupContext l)) :?> Render.Mesh |> box
+            ".shader", fun path l -> l.Read(path, fun data size -> Core.Serialization.Load.fromMemoryEx data size (fixupContext l)) |> box
+        ], assetPacks)
 
 // start asset watcher
 let _ = assets.assetWatcher loader
 
 let gbufferFill = loader.Load<Render.Shader> ".build/src/shaders/gbuffer_fill_default.shader"
+let gbufferFillDeferred = loader.Load<Render.Shader> ".build/src/shaders/gbuffer_fill_deferred.shader"
 let depthFill = loader.Load<Render.Shader> ".build/src/shaders/depth_fill_default.shader"
+let depthClear = loader.Load<Render.Shader> ".build/src/shaders/depth_clear.shader"
+let postfxExposureHistogram = loader.Load<Render.Program> ".build/src/shaders/postfx/exposure_histogram.shader"
+let postfxExposureAdapt = loader.Load<Render.Program> ".build/src/shaders/postfx/exposure_adapt.shader"
+let postfxTonemapFxaa = loader.Load<Render.Program> ".build/src/shaders/postfx/tonemap_fxaa.shader"
 let postfxTonemap = loader.Load<Render.Shader> ".build/src/shaders/postfx/tonemap.shader"
 let postfxFxaa = loader.Load<Render.Shader> ".build/src/shaders/postfx/fxaa.shader"
 let postfxBlit = loader.Load<Render.Shader> ".build/src/shaders/postfx/blit.shader"
 let lightGridDebug = loader.Load<Render.Shader> ".build/src/shaders/lighting/lightgrid_debug.shader"
 let lightGridFill = loader.Load<Render.Program> ".build/src/shaders/lighting/lightgrid_fill.shader"
+let deferredLighting = loader.Load<Render.Program> ".build/src/shaders/lighting/deferred_lighting.shader"
+let skinning = loader.Load<Render.Program> ".build/src/shaders/skinning.shader"
 
-let vertexSize = (Render.VertexLayouts.get Render.VertexFormat.Pos_TBN_Tex1_Bone4_Packed).size
-let layout = new InputLayout(device.Device, gbufferFill.Value.VertexSignature.Resource, (Render.VertexLayouts.get Render.VertexFormat.Pos_TBN_Tex1_Bone4_Packed).elements)
+// fill shaders read the output of the skinning pre-pass
+let vertexSize = Render.Skinning.SkinnedVertexBuffer.Stride
+let layout = new InputLayout(device.Device, gbufferFill.Value.VertexSignature.Resource, (Render.VertexLayouts.get Render.VertexFormat.Pos_TBN_Tex1_Skinned).elements)
 
 let createDummyTexture color =
     let stream = new DataStream(4, canRead = false, canWrite = true)
@@ -199,6 +212,44 @@ let cbPool = Render.ConstantBufferPool(device.Device)
 
 let tricount = ref 0
 
+// instanced draws of the scene for this frame; instance transforms for all passes are uploaded once per frame
+let instanceBuffer = Render.Instancing.InstanceBuffer(device)
+let sceneBatches = ref ([||]: Render.Instancing.InstanceBatcher.Batch<Render.Mesh> array)
+
+let batchScene (context: DeviceContext) =
+    let instances = lock scene (fun () -> scene.ToArray()) |> Array.choose (fun (mesh, transform) -> if mesh.IsReady then Some (mesh.Value, !transform) else None)
+    let transforms, batches = Render.Instancing.InstanceBatcher.build instances (fun mesh -> mesh.fragments |> Array.map (fun fragment -> fragment.material))
+
+    instanceBuffer.Update(context, transforms)
+    sceneBatches := batches
+
+// skinned vertex buffers; meshes are skinned once per frame, before all passes
+let skinnedVertices = Render.Skinning.SkinnedVertexCache(device)
+
+let skinScene (context: DeviceContext) (shaderContext: Render.ShaderContext) =
+    skinnedVertices.Trim()
+
+    shaderContext.Program <- skinning.Value
+
+    for mesh, batches in !sceneBatches |> Seq.groupByRef (fun batch -> batch.mesh) do
+        if dbgNulldraw.Value then () else
+
+        shaderContext?skinningSource <- mesh.vertices.View
+        shaderContext?skinningOutputUA <- (skinnedVertices.Get mesh).UnorderedView
+
+        for batch in batches do
+            let fragment = mesh.fragments.[batch.fragment]
+            let first, count = Render.Skinning.SkinnedVertexCache.GetFragmentVertexRange(mesh, fragment)
+
+            shaderContext?meshCompressionInfo <- fragment.compressionInfo
+            shaderContext?mesh <- fragment.skin.ComputeBoneTransforms mesh.skeleton
+            shaderContext?skinningFirstVertex <- box first
+            shaderContext?skinningVertexCount <- box count
+
+            context.Dispatch((count + 63) / 64, 1, 1)
+
+    shaderContext?skinningOutputUA <- (null: UnorderedAccessView)
+
 let renderScene (context: DeviceContext) (shaderContext: Render.ShaderContext) (camera: Camera) (shader: Render.Shader) =
     context.OutputMerger.DepthStencilState <- new DepthStencilState(device.Device, DepthStencilStateDescription(IsDepthEnabled = true, DepthWriteMask = DepthWriteMask.All, DepthComparison = Comparison.LessEqual))
 
@@ -213,32 +264,39 @@ let renderScene (context: DeviceContext) (shaderContext: Render.ShaderContext) (
     shaderContext?camera <- camera
     shaderContext?defaultSampler <- new SamplerState(device.Device, SamplerStateDescription(AddressU = TextureAddressMode.Wrap, AddressV = TextureAddressMode.Wrap, AddressW = TextureAddressMode.Wrap, Filter = dbgTexfilter.Value, MaximumAnisotropy = 16, MaximumLod = infinityf))
 
-    let sceneCopy = lock scene (fun () -> scene.ToArray())
+    shaderContext?instanceTransforms <- instanceBuffer.View
+    shaderContext?material <- Material(dbgRoughness.Value, dbgSmoothness.Value)
 
-    for mesh, instances in sceneCopy |> Seq.choose (fun (mesh, transform) -> if mesh.IsReady then Some (mesh.Value, transform) else None) |> Seq.groupByRef (fun (mesh, transform) -> mesh) do
-        if dbgNulldraw.Value then () else
+    let texture (tex: Asset.Ref<Render.Texture> option) dummy = if tex.IsSome && tex.Value.IsReady then tex.Value.Value.View else dummy
+
+    // one draw per batch; batches are grouped by material, so textures are set once per material
+    let mutable lastMaterial = None
+
+    for batch in !sceneBatches do
+        let skinnedBuffer = skinnedVertices.TryGet batch.mesh
 
-        shaderContext?transforms <- instances |> Array.map (fun (mesh, transform) -> !transform)
+        if dbgNulldraw.Value || skinnedBuffer.IsNone then () else
 
-        for fragment in mesh.fragments do
-            let texture (tex: Asset.Ref<Render.Texture> option) dummy = if tex.IsSome && tex.Value.IsReady then tex.Value.Value.View else dummy
+        let mesh = batch.mesh
+        let fragment = mesh.fragments.[batch.fragment]
 
+        if lastMaterial <> Some fragment.material then
             let material = fragment.material
 
             shaderContext?albedoMap <- texture material.albedoMap dummyAlbedo
             shaderContext?normalMap <- texture material.normalMap dummyNormal
             shaderContext?specularMap <- texture material.specularMap dummySpecular
 
-            shaderContext?meshCompressionInfo <- fragment.compressionInfo
-            shaderContext?material <- Material(dbgRoughness.Value, dbgSmoothness.Value)
+            lastMaterial <- Some material
 
-            shaderContext?mesh <- fragment.skin.ComputeBoneTransforms mesh.skeleton
+        shaderContext?meshCompressionInfo <- fragment.compressionInfo
+        shaderContext?instanceOffset <- box batch.firstInstance
 
-            context.InputAssembler.SetVertexBuffers(0, VertexBufferBinding(mesh.vertices.Resource, vertexSize, fragment.vertexOffset))
-            context.InputAssembler.SetIndexBuffer(mesh.indices.Resource, fragment.indexFormat, fragment.indexOffset)
-            context.DrawIndexedInstanced(fragment.indexCount, instances.Length, 0, 0, 0)
+        context.InputAssembler.SetVertexBuffers(0, VertexBufferBinding(skinnedBuffer.Value.Resource, vertexSize, Render.Skinning.SkinnedVertexCache.GetFragmentOffset fragment))
+        context.InputAssembler.SetIndexBuffer(mesh.indices.Resource, fragment.indexFormat, fragment.indexOffset)
+        context.DrawIndexedInstanced(fragment.indexCount, batch.instanceCount, 0, 0, 0)
 
-            tricount := !tricount + instances.Length * fragment.indexCount / 3
+        tricount := !tricount + batch.instanceCount * fragment.indexCount / 3
 
 let renderPass (context: DeviceContext) (shaderContext: Render.ShaderContext) (camera: Camera) (depthBuffer: Render.RenderTarget) (colorBuffers: Render.RenderTarget array) (viewport: Viewport) (shader: Render.Shader) =
     context.Rasterizer.SetViewports(viewport)
@@ -258,6 +316,20 @@ let renderFullScreenTri (context: DeviceContext) (shaderContext: Render.ShaderCo
 
     context.Draw(3, 0)
 
+// clear depth in the viewport; depth clears of the view ignore the viewport
+let clearDepthRegion (context: DeviceContext) (shaderContext: Render.ShaderContext) (depthBuffer: Render.RenderTarget) (viewport: Viewport) =
+    context.Rasterizer.SetViewports(viewport)
+    context.OutputMerger.SetTargets(depthBuffer.DepthView, [||])
+
+    context.InputAssembler.InputLayout <- null
+    context.InputAssembler.PrimitiveTopology <- PrimitiveTopology.TriangleList
+    context.OutputMerger.DepthStencilState <- new DepthStencilState(device.Device, DepthStencilStateDescription(IsDepthEnabled = true, DepthWriteMask = DepthWriteMask.All, DepthComparison = Comparison.Always))
+    context.Rasterizer.State <- new RasterizerState(device.Device, RasterizerStateDescription(CullMode = CullMode.None, FillMode = FillMode.Solid))
+
+    shaderContext.Shader <- depthClear.Value
+
+    context.Draw(3, 0)
+
 form.KeyUp.Add(fun args ->
     if args.Alt && args.KeyCode = System.Windows.Forms.Keys.Oemcomma then
         let w = WinUI.PropertyGrid.create (Core.DbgVars.getVariables() |> Array.map (fun (name, v) -> name, box v))
@@ -353,10 +425,55 @@ let getLightGrid =
         match !cache with
         | Some grid when matches width grid.Width LightGrid.CellSize && matches height grid.Height LightGrid.CellSize -> grid
         | _ ->
-            let grid = LightGrid(device, width, height, 128)
+            // 16 depth slices from 1 to 1000 units; everything closer than 1 unit goes to the first slice
+            // index buffer is sized for 8 lights per cell on average
+            let grid = LightGrid(device, width, height, 16, 1.f, 1000.f, width * height / (LightGrid.CellSize * LightGrid.CellSize) * 16 * 8)
             cache := Some grid
             grid
 
+// shadow atlas; the atlas is owned for the lifetime of the app since cached shadow maps stay in it between frames
+let shadowCache = ShadowCache(4096, 4096)
+let shadowAtlas = rtpool.Acquire("lighting/shadow atlas", shadowCache.Width, shadowCache.Height, Format.D24_UNorm_S8_UInt)
+
+// exposure; adapted luminance persists between frames
+let exposure = Render.PostFX.Exposure(device)
+
+// get world-space bounds of a mesh instance
+let getMeshBounds (mesh: Render.Mesh) (transform: Matrix34) =
+    let points =
+        mesh.bounds |> Array.collect (fun b ->
+            let m = transform * mesh.skeleton.AbsoluteTransform b.Bone
+            let bmin, bmax = b.LocalBounds.Min, b.LocalBounds.Max
+
+            Array.init 8 (fun i ->
+                Matrix34.TransformPosition(m, Vector3((if i &&& 1 = 0 then bmin.x else bmax.x), (if i &&& 2 = 0 then bmin.y else bmax.y), (if i &&& 4 = 0 then bmin.z else bmax.z)))))
+
+    if points.Length = 0 then None
+    else Some (Math.AABB(Array.reduce (fun a b -> Vector3.Minimize(a, b)) points, Array.reduce (fun a b -> Vector3.Maximize(a, b)) points))
+
+// invalidate cached shadow maps after scene changes; moved meshes invalidate the shadow maps that contain their old or
+// new bounds, other changes (loading, reloading) are rare and invalidate everything
+let updateShadowCache =
+    let last = ref [||]
+
+    fun () ->
+        let current = lock scene (fun () -> scene.ToArray()) |> Array.map (fun (mesh, transform) -> mesh, mesh.IsReady, !transform)
+        let previous = !last
+        last := current
+
+        if current.Length <> previous.Length then
+            shadowCache.InvalidateAll()
+        else
+            for (mesh, ready, transform), (pmesh, pready, ptransform) in Array.zip current previous do
+                if not (obj.ReferenceEquals(mesh, pmesh)) || ready <> pready then
+                    shadowCache.InvalidateAll()
+                elif ready && transform <> ptransform then
+                    match getMeshBounds mesh.Value ptransform, getMeshBounds mesh.Value transform with
+                    | Some oldBounds, Some newBounds ->
+                        shadowCache.Invalidate(oldBounds)
+                        shadowCache.Invalidate(newBounds)
+                    | _ -> shadowCache.InvalidateAll()
+
 RenderLoop.Run(form, fun () ->
     frameTimer.Stop()
     let dt = frameTimer.Current
@@ -400,6 +517,10 @@ RenderLoop.Run(form, fun () ->
 
     let viewport = Viewport(0.f, 0.f, float32 form.ClientSize.Width, float32 form.ClientSize.Height)
 
+    // batch instances and skin meshes for all passes
+    batchScene context
+    skinScene context shaderContext
+
     // fill depth buffer
     use depthBuffer = rtpool.Acquire("gbuffer/depth", form.ClientSize.Width, form.ClientSize.Height, Format.D24_UNorm_S8_UInt)
 
@@ -444,14 +565,19 @@ RenderLoop.Run(form, fun () ->
                     color = colors.[i % colors.Length]
                     intensity = dbgSpotIntensity.Value })
 
-    let shadowAtlasWidth = 4096
-    let shadowAtlasHeight = 4096
-    let lightCullData, lightData = LightDataBuilder.build lights shadowAtlasWidth shadowAtlasHeight camera.View camera.Projection
+    updateShadowCache ()
+
+    let lightCullData, lightData, shadowUpdates = LightDataBuilder.build shadowCache lights camera.View camera.Projection
 
     context.OutputMerger.SetTargets(null, [||])
 
     // fill lightgrid
-    shaderContext?lightGridBufferUA <- lightGrid.UnorderedView
+    lightGrid.Reset(context)
+
+    shaderContext?lightGridCellsUA <- lightGrid.CellUnorderedView
+    shaderContext?lightGridIndicesUA <- lightGrid.IndexUnorderedView
+    shaderContext?lightGridCounterUA <- lightGrid.CounterUnorderedView
+    shaderContext?lightGridDebugUA <- lightGrid.DebugUnorderedView
     shaderContext?lightGrid <- lightGrid
     shaderContext?lightCullData <- lightCullData
     shaderContext?lightCount <- box lights.Length
@@ -461,64 +587,120 @@ RenderLoop.Run(form, fun () ->
     shaderContext.Program <- lightGridFill.Value
     context.Dispatch(lightGrid.Width, lightGrid.Height, 1)
 
-    shaderContext?lightGridBufferUA <- (null: UnorderedAccessView)
-    shaderContext?lightGridBuffer <- lightGrid.View
+    shaderContext?lightGridCellsUA <- (null: UnorderedAccessView)
+    shaderContext?lightGridIndicesUA <- (null: UnorderedAccessView)
+    shaderContext?lightGridCounterUA <- (null: UnorderedAccessView)
+    shaderContext?lightGridDebugUA <- (null: UnorderedAccessView)
+    shaderContext?lightGridCells <- lightGrid.CellView
+    shaderContext?lightGridIndices <- lightGrid.IndexView
 
-    shaderContext?lightData <- lightData
+    lightGrid.UpdateStatistics(context)
 
-    // render shadows
-    use shadowBuffer = rtpool.Acquire("lighting/shadow buffer", shadowAtlasWidth, shadowAtlasHeight, Format.D24_UNorm_S8_UInt)
+    let stats = lightGrid.Statistics
+    form.Text <- sprintf "%s; light indices: %d/%d, %d truncated lists" form.Text stats.requestedIndices stats.indexCapacity stats.truncatedCells
 
-    context.ClearDepthStencilView(shadowBuffer.DepthView, DepthStencilClearFlags.Depth, 1.f, 0uy)
-
-    for light in lightData do
-        let shadow = light.ShadowData
+    shaderContext?lightData <- lightData
 
-        shadow.CascadeInfo
-        |> Array.iteri (fun i cascade ->
-            let distance = shadow.CascadeDistances.[i]
+    // render shadow maps that are not in the cache
+    for update in shadowUpdates do
+        let viewport = Viewport(float32 update.x, float32 update.y, float32 update.size, float32 update.size)
 
-            if distance < infinityf then
-                // render shadow map
-                let transform = Matrix34.Translation(Vector3(cascade.TransformOffset, 0.f)) * Matrix34.Scaling(Vector3(cascade.TransformScale, 1.f))
-                let camera = Camera(Matrix34.Identity, Matrix44(transform) * shadow.Transform)
-                let viewport =
-                    Viewport(
-                        cascade.AtlasOffset.x * float32 shadowAtlasWidth, cascade.AtlasOffset.y * float32 shadowAtlasHeight, 
-                        cascade.AtlasScale.x * float32 shadowAtlasWidth, cascade.AtlasScale.y * float32 shadowAtlasHeight)
+        clearDepthRegion context shaderContext shadowAtlas viewport
+        renderPass context shaderContext (Camera(Matrix34.Identity, update.transform)) shadowAtlas [||] viewport depthFill.Value
 
-                renderPass context shaderContext camera shadowBuffer [||] viewport depthFill.Value)
+    form.Text <- sprintf "%s; shadow maps rendered: %d" form.Text shadowUpdates.Length
 
-    shaderContext?shadowMap <- shadowBuffer.View
+    shaderContext?shadowMap <- shadowAtlas.View
     shaderContext?shadowSampler <- new SamplerState(device.Device, SamplerStateDescription(AddressU = TextureAddressMode.Clamp, AddressV = TextureAddressMode.Clamp, AddressW = TextureAddressMode.Clamp, Filter = Filter.ComparisonMinMagMipLinear, ComparisonFunction = Comparison.Less))
 
     // fill color buffer
-    use colorBuffer = rtpool.Acquire("scene/hdr", form.ClientSize.Width, form.ClientSize.Height, Format.R16G16B16A16_Float)
+    use colorBuffer = rtpool.Acquire("scene/hdr", form.ClientSize.Width, form.ClientSize.Height, Format.R16G16B16A16_Float, unorderedAccess = true)
 
     context.ClearRenderTargetView(colorBuffer.ColorView, SharpDX.Color4 0xff808080)
 
-    renderPass context shaderContext camera depthBuffer [|colorBuffer|] viewport gbufferFill.Value
+    if dbgDeferred.Value then
+        // fill G-buffer; lighting cost does not depend on overdraw since only visible pixels are shaded
+        use albedoBuffer = rtpool.Acquire("gbuffer/albedo", form.ClientSize.Width, form.ClientSize.Height, Format.R8G8B8A8_UNorm)
+        use normalBuffer = rtpool.Acquire("gbuffer/normal", form.ClientSize.Width, form.ClientSize.Height, Format.R16G16_UNorm)
+        use specularBuffer = rtpool.Acquire("gbuffer/specular", form.ClientSize.Width, form.ClientSize.Height, Format.R8G8B8A8_UNorm)
+
+        renderPass context shaderContext camera depthBuffer [|albedoBuffer; normalBuffer; specularBuffer|] viewport gbufferFillDeferred.Value
+
+        context.OutputMerger.SetTargets(null, [||])
+
+        // shade G-buffer pixels with the light grid lists
+        shaderContext?depthBuffer <- depthBuffer.View
+        shaderContext?gbufferAlbedo <- albedoBuffer.View
+        shaderContext?gbufferNormal <- normalBuffer.View
+        shaderContext?gbufferSpecular <- specularBuffer.View
+        shaderContext?colorUA <- colorBuffer.UnorderedView
+        shaderContext?camera <- camera
+
+        shaderContext.Program <- deferredLighting.Value
+        context.Dispatch(lightGrid.Width, lightGrid.Height, 1)
 
-    // tonemap
-    use ldrBuffer = rtpool.Acquire("scene/ldr", form.ClientSize.Width, form.ClientSize.Height, Format.R8G8B8A8_UNorm)
+        shaderContext?colorUA <- (null: UnorderedAccessView)
+    else
+        renderPass context shaderContext camera depthBuffer [|colorBuffer|] viewport gbufferFill.Value
 
-    context.OutputMerger.SetTargets(ldrBuffer.ColorView)
+    // luminance histogram and exposure adaptation
+    context.OutputMerger.SetTargets(null, [||])
+
+    exposure.Compensation <- dbgExposureCompensation.Value
+    exposure.Reset(context, dt, dbgExposureSpeed.Value)
 
-    shaderContext?defaultSampler <- new SamplerState(device.Device, SamplerStateDescription(AddressU = TextureAddressMode.Clamp, AddressV = TextureAddressMode.Clamp, AddressW = TextureAddressMode.Clamp, Filter = Filter.MinMagMipLinear))
+    shaderContext?exposure <- exposure
     shaderContext?colorMap <- colorBuffer.View
+    shaderContext?exposureHistogramUA <- exposure.HistogramUnorderedView
+
+    shaderContext.Program <- postfxExposureHistogram.Value
+    context.Dispatch((form.ClientSize.Width + Render.PostFX.Exposure.TileSize - 1) / Render.PostFX.Exposure.TileSize, (form.ClientSize.Height + Render.PostFX.Exposure.TileSize - 1) / Render.PostFX.Exposure.TileSize, 1)
+
+    shaderContext?exposureHistogramUA <- (null: UnorderedAccessView)
+    shaderContext?exposureHistogram <- exposure.HistogramView
+    shaderContext?exposureStateUA <- exposure.StateUnorderedView
+
+    shaderContext.Program <- postfxExposureAdapt.Value
+    context.Dispatch(1, 1, 1)
+
+    shaderContext?exposureStateUA <- (null: UnorderedAccessView)
+    shaderContext?exposureState <- exposure.StateView
+
+    if dbgFusedPostfx.Value then
+        // tonemap + fxaa in one pass; saves the LDR target write and read
+        context.OutputMerger.SetTargets(null, [||])
+
+        shaderContext?colorMap <- colorBuffer.View
+        shaderContext?outputUA <- device.BackBuffer.UnorderedView
+
+        shaderContext.Program <- postfxTonemapFxaa.Value
+        context.Dispatch((form.ClientSize.Width + 15) / 16, (form.ClientSize.Height + 15) / 16, 1)
+
+        shaderContext?outputUA <- (null: UnorderedAccessView)
+
+        context.OutputMerger.SetTargets(device.BackBuffer.ColorView)
+    else
+        // tonemap
+        use ldrBuffer = rtpool.Acquire("scene/ldr", form.ClientSize.Width, form.ClientSize.Height, Format.R8G8B8A8_UNorm)
+
+        context.OutputMerger.SetTargets(ldrBuffer.ColorView)
+
+        shaderContext?defaultSampler <- new SamplerState(device.Device, SamplerStateDescription(AddressU = TextureAddressMode.Clamp, AddressV = TextureAddressMode.Clamp, AddressW = TextureAddressMode.Clamp, Filter = Filter.MinMagMipLinear))
+        shaderContext?colorMap <- colorBuffer.View
 
-    renderFullScreenTri context shaderContext postfxTonemap.Value
+        renderFullScreenTri context shaderContext postfxTonemap.Value
 
-    // fxaa blit
-    context.OutputMerger.SetTargets(device.BackBuffer.ColorView)
+        // fxaa blit
+        context.OutputMerger.SetTargets(device.BackBuffer.ColorView)
 
-    shaderContext?defaultSampler <- new SamplerState(device.Device, SamplerStateDescription(AddressU = TextureAddressMode.Clamp, AddressV = TextureAddressMode.Clamp, AddressW = TextureAddressMode.Clamp, Filter = Filter.MinMagMipLinear))
-    shaderContext?colorMap <- ldrBuffer.View
+        shaderContext?defaultSampler <- new SamplerState(device.Device, SamplerStateDescription(AddressU = TextureAddressMode.Clamp, AddressV = TextureAddressMode.Clamp, AddressW = TextureAddressMode.Clamp, Filter = Filter.MinMagMipLinear))
+        shaderContext?colorMap <- ldrBuffer.View
 
-    renderFullScreenTri context shaderContext postfxFxaa.Value
+        renderFullScreenTri context shaderContext postfxFxaa.Value
 
     // blend lightgrid debug output over
     shaderContext?lightGrid <- lightGrid
+    shaderContext?lightGridDebug <- lightGrid.DebugView
 
     let mutable blendon = BlendStateDescription()
     Array.fill blendon.RenderTarget 0 8 (RenderTargetBlendDescription(IsBlendEnabled = true, SourceBlend = BlendOption.One, DestinationBlend = BlendOption.One, BlendOperation = BlendOperation.Add, SourceAlphaBlend = BlendOption.One, DestinationAlphaBlend = BlendOption.Zero, AlphaBlendOperation = BlendOperation.Add, RenderTargetWriteMask = ColorWriteMaskFlags.All))
@@ -533,7 +715,7 @@ RenderLoop.Run(form, fun () ->
         match dbgDebugTarget.Value with
         | DebugTarget.None -> None
         | DebugTarget.Depth -> Some depthBuffer
-        | DebugTarget.Shadow -> Some shadowBuffer
+        | DebugTarget.Shadow -> Some shadowAtlas
         | t -> failwithf "Unknown target value %O" t
         with
     | Some rt ->
@@ -0,0 +1,21 @@
+// clears depth in the viewport; used for regions of depth targets that have to keep the contents of other regions
+
+struct PS_IN
+{
+	float4 pos: SV_POSITION;
+};
+
+PS_IN vsMain(uint id: SV_VertexID)
+{
+    // form a full-screen triangle at the far plane
+    float2 pos = float2(id == 1 ? 2 : 0, id == 2 ? 2 : 0);
+
+    PS_IN O;
+    O.pos = float4(pos.x * 2 - 1, 1 - pos.y * 2, 1, 1);
+
+    return O;
+}
+
+void psMain()
+{
+}
@@ -1,6 +1,11 @@
 #ifndef FILL_DEFAULT_H
 #define FILL_DEFAULT_H
 
+// 1 - write material data to the G-buffer instead of shading (deferred path)
+#ifndef DEFERRED
+#define DEFERRED 0
+#endif
+
 #include <common/common.h>
 #include <common/gamma.h>
 
@@ -13,16 +18,13 @@ CBUF(MeshCompressionInfo, meshCompressionInfo);
 CBUF(Material, material);
 
 #include <lighting/integrate.h>
+#include <lighting/brdf.h>
+#include <lighting/gbuffer.h>
 
-cbuffer mesh
-{
-    float3x4 bones[2];
-}
+// instance transforms of all batches; SV_InstanceID starts from 0 for each draw, so the batch passes its first instance
+StructuredBuffer<float3x4> instanceTransforms;
 
-cbuffer transforms
-{
-    float3x4 offsets[2];
-}
+CBUF(int, instanceOffset);
 
 SamplerState defaultSampler;
 
@@ -30,11 +32,10 @@ Texture2D<float4> albedoMap;
 Texture2D<float2> normalMap;
 Texture2D<float3> specularMap;
 
+// vertices are skinned by skinning.hlsl; position is decompressed, texcoord is not
 struct VS_IN
 {
-	float4 pos: POSITION;
-    uint4 boneIndices: BONEINDICES;
-    float4 boneWeights: BONEWEIGHTS;
+	float3 pos: POSITION;
 	float2 uv0: TEXCOORD0;
 
 #if !DEPTH_ONLY
@@ -60,7 +61,12 @@ struct PS_IN
 
 struct PS_OUT
 {
-#if !DEPTH_ONLY
+#if DEPTH_ONLY
+#elif DEFERRED
+    float4 albedo: SV_Target0;
+    float2 normal: SV_Target1;
+    float4 specular: SV_Target2;
+#else
     float4 color: SV_Target0;
 #endif
 };
@@ -69,26 +75,16 @@ PS_IN vsMain(uint instance: SV_InstanceId, VS_IN I)
 {
 	PS_IN O;
 	
-    I.pos.xyz = I.pos.xyz * meshCompressionInfo.posScale + meshCompressionInfo.posOffset;
-    I.pos.w = 1;
-
-    float3x4 transform = 0;
-
-    [unroll] for (int i = 0; i < 4; ++i)
-    {
-        transform += bones[I.boneIndices[i]] * I.boneWeights[i];
-    }
-
-    float3 posLs = mul(transform, I.pos);
-    float3 posWs = mul(offsets[instance], float4(posLs, 1));
+    float3x4 transform = instanceTransforms[instanceOffset + instance];
+    float3 posWs = mul(transform, float4(I.pos, 1));
 
 	O.pos = mul(camera.viewProjection, float4(posWs, 1));
     O.uv0 = I.uv0 * meshCompressionInfo.uvScale + meshCompressionInfo.uvOffset;
 
 #if !DEPTH_ONLY
     O.position = posWs;
-    O.normal = normalize(mul((float3x3)offsets[instance], mul((float3x3)transform, I.normal * 2 - 1)));
-    O.tangent = normalize(mul((float3x3)offsets[instance], mul((float3x3)transform, I.tangent.xyz * 2 - 1)));
+    O.normal = normalize(mul((float3x3)transform, I.normal * 2 - 1));
+    O.tangent = normalize(mul((float3x3)transform, I.tangent.xyz * 2 - 1));
     O.bitangent = cross(O.normal, O.tangent) * (I.tangent.w * 2 - 1);
 #endif
 	
@@ -117,26 +113,29 @@ PS_OUT psMain(PS_IN I)
 
     float3 spec = degamma(specularMap.Sample(defaultSampler, I.uv0));
 
-    float3 view = normalize(camera.eyePosition - I.position);
-
-    float3 diffuse = 0, specular = 0;
+#if DEFERRED
+    GBufferData data;
+    data.albedo = albedo.rgb;
+    data.normal = normal;
+    data.specular = spec;
+    data.roughness = material.roughness;
 
-    integrateBRDF(I.pos, I.position,
-        float diff = saturate(dot(normal, L.direction));
+    GBufferPacked packed = packGBuffer(data);
 
-        float3 hvec = normalize(L.direction + view);
-        float cosnh = saturate(dot(hvec, normal));
+    O.albedo = packed.albedo;
+    O.normal = packed.normal;
+    O.specular = packed.specular;
+#else
+    float3 view = normalize(camera.eyePosition - I.position);
 
-        // Normalized Blinn-Phong
-        float specpower = pow(2, material.roughness * 10);
+    float3 diffuse = 0, specular = 0;
 
-        diffuse += L.color * diff;
-        specular += L.color * diff * pow(cosnh, specpower) * ((specpower + 8) / 8);
-    );
+    integrateBRDF(I.pos, I.position, evaluateBlinnPhong(L, normal, view, material.roughness, diffuse, specular););
 
     O.color = float4(albedo.rgb * diffuse + spec * specular, albedo.a);
 
     if (_Debug) O.color = _DebugResult;
+#endif
 #endif
 
 	return O;
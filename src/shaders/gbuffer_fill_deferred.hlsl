@@ -0,0 +1,4 @@
+#define DEPTH_ONLY 0
+#define DEFERRED 1
+#include "fill_default.h"
+
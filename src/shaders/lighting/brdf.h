@@ -0,0 +1,21 @@
+#ifndef LIGHTING_BRDF_H
+#define LIGHTING_BRDF_H
+
+#include <lighting/integrate.h>
+
+// accumulate light contribution using normalized Blinn-Phong
+void evaluateBlinnPhong(LightInput L, float3 normal, float3 view, float roughness, inout float3 diffuse, inout float3 specular)
+{
+    float diff = saturate(dot(normal, L.direction));
+
+    float3 hvec = normalize(L.direction + view);
+    float cosnh = saturate(dot(hvec, normal));
+
+    // Normalized Blinn-Phong
+    float specpower = pow(2, roughness * 10);
+
+    diffuse += L.color * diff;
+    specular += L.color * diff * pow(cosnh, specpower) * ((specpower + 8) / 8);
+}
+
+#endif
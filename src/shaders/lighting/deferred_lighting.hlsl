@@ -0,0 +1,52 @@
+//# compute
+#include <common/common.h>
+
+#include <auto_Camera.h>
+
+CBUF(Camera, camera);
+
+#include <lighting/integrate.h>
+#include <lighting/brdf.h>
+#include <lighting/gbuffer.h>
+
+Texture2D<float> depthBuffer;
+Texture2D<float4> gbufferAlbedo;
+Texture2D<float2> gbufferNormal;
+Texture2D<float4> gbufferSpecular;
+RWTexture2D<float4> colorUA;
+
+float3 getWorldPosition(float x, float y, float z)
+{
+    float4 r = mul(camera.viewProjectionInverse, float4(x * 2 - 1, 1 - 2 * y, z, 1));
+    return r.xyz / r.w;
+}
+
+// groups match light grid tiles, so all threads in the group read the lists of the same cells
+[numthreads(LIGHTGRID_CELLSIZE, LIGHTGRID_CELLSIZE, 1)]
+void main(uint2 dispatchThreadId: SV_DispatchThreadID)
+{
+    uint width, height;
+    depthBuffer.GetDimensions(width, height);
+
+    if (dispatchThreadId.x >= width || dispatchThreadId.y >= height)
+        return;
+
+    float depth = depthBuffer[dispatchThreadId];
+
+    // pixels at the far plane keep the clear color
+    if (depth == 1)
+        return;
+
+    float2 hpos = dispatchThreadId + 0.5;
+    float3 position = getWorldPosition(hpos.x / width, hpos.y / height, depth);
+
+    GBufferData data = unpackGBuffer(gbufferAlbedo[dispatchThreadId], gbufferNormal[dispatchThreadId], gbufferSpecular[dispatchThreadId]);
+
+    float3 view = normalize(camera.eyePosition - position);
+
+    float3 diffuse = 0, specular = 0;
+
+    integrateBRDF(hpos, position, evaluateBlinnPhong(L, data.normal, view, data.roughness, diffuse, specular););
+
+    colorUA[dispatchThreadId] = float4(data.albedo * diffuse + data.specular * specular, 1);
+}
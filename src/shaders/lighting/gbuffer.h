@@ -0,0 +1,75 @@
+#ifndef LIGHTING_GBUFFER_H
+#define LIGHTING_GBUFFER_H
+
+#include <common/gamma.h>
+
+// G-buffer layout (12 bytes per pixel):
+// 0: R8G8B8A8_UNorm - albedo (gamma space), roughness
+// 1: R16G16_UNorm - normal (octahedral encoding)
+// 2: R8G8B8A8_UNorm - specular color (gamma space), unused
+// colors are stored in gamma space so that 8 bits are enough for dark values
+struct GBufferData
+{
+    float3 albedo;
+    float3 normal;
+    float3 specular;
+    float roughness;
+};
+
+struct GBufferPacked
+{
+    float4 albedo;
+    float2 normal;
+    float4 specular;
+};
+
+// get sign of the value; unlike sign(), returns 1 for 0
+float2 signNotZero(float2 v)
+{
+    return v >= 0 ? 1 : -1;
+}
+
+// encode unit vector to [0..1]^2: project the vector on the octahedron and fold the lower half over the upper half
+float2 encodeOctahedral(float3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+
+    float2 r = n.z >= 0 ? n.xy : (1 - abs(n.yx)) * signNotZero(n.xy);
+
+    return r * 0.5 + 0.5;
+}
+
+float3 decodeOctahedral(float2 e)
+{
+    e = e * 2 - 1;
+
+    float3 n = float3(e, 1 - abs(e.x) - abs(e.y));
+
+    if (n.z < 0)
+        n.xy = (1 - abs(n.yx)) * signNotZero(n.xy);
+
+    return normalize(n);
+}
+
+GBufferPacked packGBuffer(GBufferData data)
+{
+    GBufferPacked result;
+    result.albedo = float4(gamma(data.albedo), saturate(data.roughness));
+    result.normal = encodeOctahedral(data.normal);
+    result.specular = float4(gamma(data.specular), 0);
+
+    return result;
+}
+
+GBufferData unpackGBuffer(float4 albedo, float2 normal, float4 specular)
+{
+    GBufferData result;
+    result.albedo = degamma(albedo.rgb);
+    result.normal = decodeOctahedral(normal);
+    result.specular = degamma(specular.rgb);
+    result.roughness = albedo.a;
+
+    return result;
+}
+
+#endif
@@ -2,11 +2,12 @@
 #define LIGHTING_INTEGRATE_H
 
 #include <lighting/shadowmap.h>
+#include <lighting/lightgrid.h>
 
 #include <auto_LightData.h>
-#include <auto_LightGrid.h>
 
-Buffer<uint> lightGridBuffer;
+Buffer<uint4> lightGridCells;
+Buffer<uint> lightGridIndices;
 CBUF(LightGrid, lightGrid);
 CBUF_ARRAY(LightData, lightData);
 
@@ -16,10 +17,8 @@ struct LightInput
     float3 color;
 };
 
-float getLightShadow(LightData light, float3 position)
+float getLightShadow(LightData light, float3 position, float zbias)
 {
-    if (light.type == LIGHTTYPE_POINT) return 1;
-
     float dist = distance(position, camera.eyePosition);
     bool4 mask = dist > light.shadowData.cascadeDistances;
     int cascadeIndex = dot(mask, 1);
@@ -32,12 +31,35 @@ float getLightShadow(LightData light, float3 position)
     p.xy = saturate(p.xy * float2(0.5, -0.5) + 0.5);
     p.xy = p.xy * cascade.atlasScale + cascade.atlasOffset;
 
-    float zbias = light.type == LIGHTTYPE_DIRECTIONAL ? 1e-4 : 1e-6;
+    return sampleShadowFiltered(p.xy, p.z - zbias, cascade.filter);
+}
+
+// light input functions are specialized by light category; shadowed is a literal, so unused shadow code is compiled out
+LightInput getDirectionalLightInput(LightData light, float3 position, bool shadowed)
+{
+    float shadow = shadowed ? getLightShadow(light, position, 1e-4) : 1;
+
+    LightInput result;
+    result.direction = -light.direction;
+    result.color = light.color.rgb * (light.intensity * shadow);
+
+    return result;
+}
+
+LightInput getPointLightInput(LightData light, float3 position)
+{
+    float3 lightUn = light.position - position;
+
+    float attenDist = saturate(1 - length(lightUn) / light.radius);
+
+    LightInput result;
+    result.direction = normalize(lightUn);
+    result.color = light.color.rgb * (light.intensity * attenDist);
 
-    return sampleShadowFiltered(p.xy, p.z - zbias);
+    return result;
 }
 
-LightInput getLightInput(LightData light, float3 position)
+LightInput getSpotLightInput(LightData light, float3 position, bool shadowed)
 {
     float3 lightUn = light.position - position;
     float3 L = normalize(lightUn);
@@ -45,28 +67,34 @@ LightInput getLightInput(LightData light, float3 position)
     float attenDist = saturate(1 - length(lightUn) / light.radius);
     float attenCone = pow(saturate((dot(-L, light.direction) - light.outerAngle) / (light.innerAngle - light.outerAngle)), 4);
 
-    float atten = (light.type == LIGHTTYPE_DIRECTIONAL ? 1 : attenDist) * (light.type == LIGHTTYPE_SPOT ? attenCone : 1);
-    
-    float shadow = getLightShadow(light, position);
+    float shadow = shadowed ? getLightShadow(light, position, 1e-6) : 1;
 
     LightInput result;
-    result.direction = light.type == LIGHTTYPE_DIRECTIONAL ? -light.direction : L;
-    result.color = light.color.rgb * (light.intensity * atten * shadow);
+    result.direction = L;
+    result.color = light.color.rgb * (light.intensity * attenDist * attenCone * shadow);
 
     return result;
 }
 
-#define integrateBRDF(hpos, position, brdf) { \
-    int gridOffset = (int)(hpos.y / LIGHTGRID_CELLSIZE) * lightGrid.stride + (int)(hpos.x / LIGHTGRID_CELLSIZE) * lightGrid.tileSize; \
+// integrate over the lights of one category in the cell
+#define integrateBRDFCategory(lightCell, category, input, brdf) { \
+    uint2 lightList = getLightGridList(lightCell, category); \
     \
-    for (int lightIter = 0; lightIter < lightGrid.tileSize; ++lightIter) { \
-        int lightIndex = lightGridBuffer[gridOffset + lightIter]; \
-        if (lightIndex == 0) break; \
-        \
-        LightData light = lightData[lightIndex - 1]; \
-        LightInput L = getLightInput(light, position); \
+    for (uint lightIter = 0; lightIter < lightList.y; ++lightIter) { \
+        LightData light = lightData[lightGridIndices[lightList.x + lightIter]]; \
+        LightInput L = input; \
         \
         brdf \
     } }
 
+#define integrateBRDF(hpos, position, brdf) { \
+    uint4 lightCell = lightGridCells[getLightGridCell(lightGrid, hpos.xy, mul(camera.view, float4(position, 1)).z)]; \
+    \
+    integrateBRDFCategory(lightCell, LIGHTCATEGORY_DIRECTIONAL, getDirectionalLightInput(light, position, false), brdf) \
+    integrateBRDFCategory(lightCell, LIGHTCATEGORY_DIRECTIONALSHADOWED, getDirectionalLightInput(light, position, true), brdf) \
+    integrateBRDFCategory(lightCell, LIGHTCATEGORY_POINT, getPointLightInput(light, position), brdf) \
+    integrateBRDFCategory(lightCell, LIGHTCATEGORY_SPOT, getSpotLightInput(light, position, false), brdf) \
+    integrateBRDFCategory(lightCell, LIGHTCATEGORY_SPOTSHADOWED, getSpotLightInput(light, position, true), brdf) \
+    }
+
 #endif
@@ -0,0 +1,61 @@
+#ifndef LIGHTING_LIGHTGRID_H
+#define LIGHTING_LIGHTGRID_H
+
+#include <auto_LightGrid.h>
+#include <auto_LightCategory.h>
+#include <auto_LightType.h>
+
+// get depth slice index for the view-space depth; slices are distributed logarithmically
+int getLightGridSlice(LightGrid grid, float z)
+{
+    return clamp((int)floor(log2(max(z, 1e-10)) * grid.depthScale + grid.depthBias), 0, grid.depth - 1);
+}
+
+// get index of the cell that contains the screen-space position (in pixels) and the view-space depth
+int getLightGridCell(LightGrid grid, float2 pos, float z)
+{
+    return getLightGridSlice(grid, z) * grid.sliceStride + (int)(pos.y / LIGHTGRID_CELLSIZE) * grid.stride + (int)(pos.x / LIGHTGRID_CELLSIZE);
+}
+
+// get light list category
+int getLightCategory(int type, bool shadowed)
+{
+    if (type == LIGHTTYPE_DIRECTIONAL)
+        return shadowed ? LIGHTCATEGORY_DIRECTIONALSHADOWED : LIGHTCATEGORY_DIRECTIONAL;
+    else if (type == LIGHTTYPE_SPOT)
+        return shadowed ? LIGHTCATEGORY_SPOTSHADOWED : LIGHTCATEGORY_SPOT;
+    else
+        return LIGHTCATEGORY_POINT;
+}
+
+// get light count of the category in the cell; counts are packed as 16-bit values after the offset
+uint getLightGridCount(uint4 cell, int category)
+{
+    uint packed = category < 2 ? cell.y : category < 4 ? cell.z : cell.w;
+
+    return (category & 1) ? packed >> 16 : packed & 0xffff;
+}
+
+// get light list of the category in the cell; category lists are stored one after another in category order
+uint2 getLightGridList(uint4 cell, int category)
+{
+    uint offset = cell.x;
+
+    for (int i = 0; i < category; ++i)
+        offset += getLightGridCount(cell, i);
+
+    return uint2(offset, getLightGridCount(cell, category));
+}
+
+// get total light count in the cell
+uint getLightGridTotalCount(uint4 cell)
+{
+    uint count = 0;
+
+    for (int i = 0; i < LIGHTGRID_CATEGORIES; ++i)
+        count += getLightGridCount(cell, i);
+
+    return count;
+}
+
+#endif
@@ -1,10 +1,11 @@
 #include <common/common.h>
 
-#include <auto_LightGrid.h>
+#include <lighting/lightgrid.h>
 
 SamplerState defaultSampler;
 
-Buffer<uint> lightGridBuffer;
+Buffer<uint4> lightGridCells;
+Buffer<uint> lightGridDebug;
 CBUF(LightGrid, lightGrid);
 
 struct PS_IN
@@ -33,16 +34,16 @@ float4 psMain(PS_IN I): SV_Target
     if ((uint)I.pos.y % LIGHTGRID_CELLSIZE == 0)
         return float4(0.f.xxx, 1.0);
 
-    int gridOffset = (int)(I.pos.y / LIGHTGRID_CELLSIZE) * lightGrid.stride + (int)(I.pos.x / LIGHTGRID_CELLSIZE) * lightGrid.tileSize;
+    int cell = (int)(I.pos.y / LIGHTGRID_CELLSIZE) * lightGrid.stride + (int)(I.pos.x / LIGHTGRID_CELLSIZE);
 
-    int count = 0;
+    // display the largest light count over all depth slices of the tile
+    uint count = 0;
 
-    for (int i = 0; i < lightGrid.tileSize; ++i)
-    {
-        int index = lightGridBuffer[gridOffset + i];
-        if (index == 0) break;
-        count++;
-    }
+    for (int slice = 0; slice < lightGrid.depth; ++slice)
+        count = max(count, getLightGridTotalCount(lightGridCells[cell + slice * lightGrid.sliceStride]));
 
-    return float4((count / 4.f).xxx, 1.0);
+    // display the number of lights that were rejected by the depth mask in red
+    uint rejects = lightGridDebug[cell];
+
+    return float4((count / 4.f).xxx + float3(rejects / 4.f, 0, 0), 1.0);
 }
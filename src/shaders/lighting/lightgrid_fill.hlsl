@@ -1,7 +1,8 @@
 //# compute
 #include <common/common.h>
 
-#include <auto_LightGrid.h>
+#include <lighting/lightgrid.h>
+
 #include <auto_LightCullData.h>
 #include <auto_Camera.h>
 
@@ -9,7 +10,13 @@
 // 1 - use capsule approximation for frustum
 #define CULL_METHOD 1
 
-RWBuffer<uint> lightGridBufferUA;
+// 1 - reject lights that do not overlap occupied parts of the tile depth range (2.5D culling)
+#define CULL_DEPTH_MASK 1
+
+RWBuffer<uint4> lightGridCellsUA;
+RWBuffer<uint> lightGridIndicesUA;
+RWBuffer<uint> lightGridCounterUA; // requested index count, truncated cell count
+RWBuffer<uint> lightGridDebugUA; // number of lights rejected by the depth mask per tile
 Texture2D<float> depthBuffer;
 
 CBUF(LightGrid, lightGrid);
@@ -113,9 +120,168 @@ float distancePointToConeConservative(float3 p, Cone cone)
     return d;
 }
 
+// get the range of depth slices that the light affects
+int2 getLightSlices(LightCullData light)
+{
+    if (light.type == LIGHTTYPE_DIRECTIONAL)
+        return int2(0, lightGrid.depth - 1);
+
+    float z = mul(camera.view, float4(light.position, 1)).z;
+
+    return int2(getLightGridSlice(lightGrid, z - light.radius), getLightGridSlice(lightGrid, z + light.radius));
+}
+
+// tile culling volume; computed once per thread and used by both culling passes
+#if CULL_METHOD == 0
+static float4 tilePlanes[6];
+#elif CULL_METHOD == 1
+static Cone tileCone;
+#else
+    #error Unknown cull method
+#endif
+
+// tile depth occupancy: view-space depth range of the tile pixels, split into 32 bins; a bit is set if there is a pixel
+// in the bin
+static float2 tileMaskRange;
+static uint tileMask;
+
+// get bin index for the view-space depth
+int getDepthMaskBin(float z)
+{
+    return clamp((int)((z - tileMaskRange.x) / max(tileMaskRange.y - tileMaskRange.x, 1e-6) * 32), 0, 31);
+}
+
+// check if the light depth extent overlaps occupied bins
+bool isLightInDepthMask(LightCullData light)
+{
+    float z = mul(camera.view, float4(light.position, 1)).z;
+
+    if (z + light.radius < tileMaskRange.x || z - light.radius > tileMaskRange.y)
+        return false;
+
+    uint first = getDepthMaskBin(z - light.radius);
+    uint last = getDepthMaskBin(z + light.radius);
+
+    return (tileMask & (0xffffffff >> (31 - last)) & (0xffffffff << first)) != 0;
+}
+
+bool isLightInVolume(LightCullData light)
+{
+#if CULL_METHOD == 1
+    return distancePointToConeConservative(light.position, tileCone) < light.radius;
+#else
+    return isSphereVisible(tilePlanes, light.position, light.radius);
+#endif
+}
+
+bool isLightVisible(LightCullData light)
+{
+    // +1 to change bytecode so that AMD driver works with cbuffer [2]
+    return light.type + 1 == LIGHTTYPE_DIRECTIONAL + 1 ||
+#if CULL_DEPTH_MASK
+        isLightInVolume(light) && isLightInDepthMask(light);
+#else
+        isLightInVolume(light);
+#endif
+}
+
+// lights are culled in batches, one light per thread; each batch produces a bitmask of visible lights per list
+// each cell has a list per depth slice and light category; list index is slice * LIGHTGRID_CATEGORIES + category
+#define LIGHTGRID_BATCHSIZE (LIGHTGRID_CELLSIZE * LIGHTGRID_CELLSIZE)
+#define LIGHTGRID_BATCHWORDS (LIGHTGRID_BATCHSIZE / 32)
+#define LIGHTGRID_MAXLISTS (LIGHTGRID_MAXDEPTH * LIGHTGRID_CATEGORIES)
+
+#if LIGHTGRID_MAXLISTS > LIGHTGRID_BATCHSIZE
+    #error List counters are updated with one thread per list
+#endif
+
 groupshared uint2 gsZRange;
+groupshared uint2 gsMaskRange;
+groupshared uint gsMask;
+groupshared uint gsMaskRejects;
 groupshared uint3 gsConeRange;
-groupshared uint gsLightCount;
+groupshared uint gsLightCount[LIGHTGRID_MAXLISTS];
+groupshared uint gsLightOffset[LIGHTGRID_MAXLISTS];
+groupshared uint gsLightCursor[LIGHTGRID_MAXLISTS];
+groupshared uint gsBatchLists[LIGHTGRID_BATCHSIZE]; // first slice | last slice << 8 | category << 16; culled lights have an empty range
+groupshared uint gsListMask[LIGHTGRID_MAXLISTS * LIGHTGRID_BATCHWORDS];
+groupshared uint gsListPrefix[LIGHTGRID_MAXLISTS * LIGHTGRID_BATCHWORDS];
+
+// cull the batch of lights and build list masks; after this, the position of the light in the batch part of a list is
+// the number of visible lights with smaller indices in that list, which is the exclusive prefix sum of the mask word
+// bit counts plus the bit count of the lower bits in the light's word
+void cullBatch(uint batch, uint groupIndex, bool countRejects)
+{
+    uint i = batch + groupIndex;
+    uint lists = 0xff;
+
+    if (i < (uint)lightCount)
+    {
+        LightCullData light = lightCullData[i];
+
+        if (isLightVisible(light))
+        {
+            int2 range = getLightSlices(light);
+
+            lists = range.x | (range.y << 8) | (getLightCategory(light.type, light.shadowed) << 16);
+        }
+    #if CULL_DEPTH_MASK
+        else if (countRejects && isLightInVolume(light))
+            InterlockedAdd(gsMaskRejects, 1);
+    #endif
+    }
+
+    gsBatchLists[groupIndex] = lists;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint words = lightGrid.depth * LIGHTGRID_CATEGORIES * LIGHTGRID_BATCHWORDS;
+
+    // build mask words; each thread owns a word, so there are no atomics
+    for (uint k = groupIndex; k < words; k += LIGHTGRID_BATCHSIZE)
+    {
+        uint list = k / LIGHTGRID_BATCHWORDS;
+        uint word = k % LIGHTGRID_BATCHWORDS;
+        uint slice = list / LIGHTGRID_CATEGORIES;
+        uint category = list % LIGHTGRID_CATEGORIES;
+        uint mask = 0;
+
+        for (uint b = 0; b < 32; ++b)
+        {
+            uint range = gsBatchLists[word * 32 + b];
+
+            if ((range & 0xff) <= slice && slice <= ((range >> 8) & 0xff) && (range >> 16) == category)
+                mask |= 1u << b;
+        }
+
+        gsListMask[k] = mask;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // compute exclusive prefix sums of the bit counts within each list
+    for (uint j = groupIndex; j < words; j += LIGHTGRID_BATCHSIZE)
+    {
+        uint list = j / LIGHTGRID_BATCHWORDS;
+        uint word = j % LIGHTGRID_BATCHWORDS;
+        uint sum = 0;
+
+        for (uint w = 0; w < word; ++w)
+            sum += countbits(gsListMask[list * LIGHTGRID_BATCHWORDS + w]);
+
+        gsListPrefix[j] = sum;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+}
+
+// get visible light count of the list in the current batch
+uint getBatchListCount(uint list)
+{
+    uint last = list * LIGHTGRID_BATCHWORDS + LIGHTGRID_BATCHWORDS - 1;
+
+    return gsListPrefix[last] + countbits(gsListMask[last]);
+}
 
 [numthreads(LIGHTGRID_CELLSIZE, LIGHTGRID_CELLSIZE, 1)]
 void main(
@@ -127,8 +293,16 @@ void main(
     if (groupIndex == 0)
     {
         gsZRange = uint2(0x7f7fffff, 0); // FLT_MAX, 0
+        gsMaskRange = uint2(0x7f7fffff, 0); // FLT_MAX, 0
+        gsMask = 0;
+        gsMaskRejects = 0;
         gsConeRange = uint3(0x7f7fffff, 0, 0); // FLT_MAX, 0, 0
-        gsLightCount = 0;
+    }
+
+    if (groupIndex < LIGHTGRID_MAXLISTS)
+    {
+        gsLightCount[groupIndex] = 0;
+        gsLightCursor[groupIndex] = 0;
     }
 
     GroupMemoryBarrierWithGroupSync();
@@ -147,9 +321,21 @@ void main(
                 1) - cone.origin);
 
     // compute z range
-    if (dispatchThreadId.x < width && dispatchThreadId.y < height)
+    bool inside = dispatchThreadId.x < width && dispatchThreadId.y < height;
+    float depth = inside ? depthBuffer[dispatchThreadId] : 1;
+
+    if (inside)
     {
-        float depth = depthBuffer[dispatchThreadId];
+    #if CULL_DEPTH_MASK
+        // pixels at the far plane do not receive lighting, so they are not included in the depth mask
+        if (depth < 1)
+        {
+            float viewz = getViewSpaceZ(depth);
+
+            InterlockedMin(gsMaskRange.x, asuint(viewz));
+            InterlockedMax(gsMaskRange.y, asuint(viewz));
+        }
+    #endif
 
     #if CULL_METHOD == 0
         float z = depth;
@@ -170,46 +356,115 @@ void main(
 
     GroupMemoryBarrierWithGroupSync();
 
+#if CULL_DEPTH_MASK
+    // fill depth mask
+    tileMaskRange = asfloat(gsMaskRange);
+
+    if (depth < 1)
+        InterlockedOr(gsMask, 1u << getDepthMaskBin(getViewSpaceZ(depth)));
+
+    GroupMemoryBarrierWithGroupSync();
+
+    tileMask = gsMask;
+#endif
+
 #if CULL_METHOD == 0
     // compute frustum
     float2 zrange = asfloat(gsZRange);
 
     float4x4 frustum = getTileFrustum(groupId.x, groupId.y, zrange);
 
-    float4 planes[6];
-    getFrustumPlanes(frustum, planes);
+    getFrustumPlanes(frustum, tilePlanes);
 #elif CULL_METHOD == 1
     // finalize cone construction
     cone.trange = asfloat(gsConeRange.xy);
     cone.radius = asfloat(gsConeRange.z);
+
+    tileCone = cone;
 #else
     #error Unknown cull method
 #endif
 
-    // cull lights
-    int gridOffset = groupId.y * lightGrid.stride + groupId.x * lightGrid.tileSize;
-    int gridLimit = lightGrid.tileSize - 1;
+    uint listCount = lightGrid.depth * LIGHTGRID_CATEGORIES;
 
-    for (int i = groupIndex; i < lightCount; i += LIGHTGRID_CELLSIZE * LIGHTGRID_CELLSIZE)
+    // count lights in each list
+    for (uint batch = 0; batch < (uint)lightCount; batch += LIGHTGRID_BATCHSIZE)
     {
-        LightCullData light = lightCullData[i];
+        cullBatch(batch, groupIndex, true);
 
-        // +1 to change bytecode so that AMD driver works with cbuffer [2]
-        if (light.type + 1 == LIGHTTYPE_DIRECTIONAL + 1 ||
-    #if CULL_METHOD == 1
-        distancePointToConeConservative(light.position, cone) < light.radius
-    #else
-        isSphereVisible(planes, light.position, light.radius)
-    #endif
-        )
+        if (groupIndex < listCount)
+            gsLightCount[groupIndex] += getBatchListCount(groupIndex);
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupIndex == 0)
+        lightGridDebugUA[groupId.y * lightGrid.stride + groupId.x] = gsMaskRejects;
+
+    // allocate an index range for each cell; category lists of the cell are stored one after another, and they are
+    // truncated if the index buffer is full, starting from the last category
+    int cell = groupId.y * lightGrid.stride + groupId.x;
+
+    if (groupIndex < (uint)lightGrid.depth)
+    {
+        uint first = groupIndex * LIGHTGRID_CATEGORIES;
+        uint total = 0;
+
+        for (int c = 0; c < LIGHTGRID_CATEGORIES; ++c)
+            total += gsLightCount[first + c];
+
+        uint offset;
+        InterlockedAdd(lightGridCounterUA[0], total, offset);
+
+        uint available = offset < (uint)lightGrid.indexCapacity ? (uint)lightGrid.indexCapacity - offset : 0;
+
+        if (total > available)
+            InterlockedAdd(lightGridCounterUA[1], 1);
+
+        uint4 result = uint4(offset, 0, 0, 0);
+
+        [unroll]
+        for (int category = 0; category < LIGHTGRID_CATEGORIES; ++category)
         {
-            uint idx;
-            InterlockedAdd(gsLightCount, 1, idx);
-            lightGridBufferUA[gridOffset + min(idx, gridLimit)] = i + 1;
+            uint count = min(gsLightCount[first + category], available);
+
+            gsLightCount[first + category] = count;
+            gsLightOffset[first + category] = offset;
+
+            available -= count;
+            offset += count;
+
+            result[1 + category / 2] |= count << (category % 2 * 16);
         }
+
+        lightGridCellsUA[groupIndex * lightGrid.sliceStride + cell] = result;
     }
 
     GroupMemoryBarrierWithGroupSync();
 
-    lightGridBufferUA[gridOffset + min(gsLightCount, gridLimit)] = 0;
+    // write light indices; lists are sorted by light index, so truncated lists keep the lights with smaller indices
+    for (uint next = 0; next < (uint)lightCount; next += LIGHTGRID_BATCHSIZE)
+    {
+        cullBatch(next, groupIndex, false);
+
+        uint lists = gsBatchLists[groupIndex];
+        uint category = lists >> 16;
+        uint word = groupIndex / 32;
+        uint lower = (1u << (groupIndex % 32)) - 1;
+
+        for (uint slice = lists & 0xff; slice <= ((lists >> 8) & 0xff); ++slice)
+        {
+            uint list = slice * LIGHTGRID_CATEGORIES + category;
+            uint k = list * LIGHTGRID_BATCHWORDS + word;
+            uint idx = gsLightCursor[list] + gsListPrefix[k] + countbits(gsListMask[k] & lower);
+
+            if (idx < gsLightCount[list])
+                lightGridIndicesUA[gsLightOffset[list] + idx] = next + groupIndex;
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (groupIndex < listCount)
+            gsLightCursor[groupIndex] += getBatchListCount(groupIndex);
+    }
 }
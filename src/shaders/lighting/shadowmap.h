@@ -1,6 +1,8 @@
 #ifndef LIGHTING_SHADOWMAP_H
 #define LIGHTING_SHADOWMAP_H
 
+#include <auto_ShadowFilter.h>
+
 Texture2D<float> shadowMap;
 SamplerComparisonState shadowSampler;
 
@@ -81,8 +83,21 @@ float sampleShadowFXAA(float2 uv, float depth)
     return shadowM * 0.5 + shadowD1 * 0.25 + shadowD2 * 0.25;
 }
 
-float sampleShadowFiltered(float2 uv, float depth)
+// filter is selected per cascade; it is uniform within a cascade, so the branches only diverge on cascade borders
+float sampleShadowFiltered(float2 uv, float depth, int filter)
 {
+    [branch] if (filter == SHADOWFILTER_SINGLE)
+        return sampleShadow(uv, depth);
+
+    [branch] if (filter == SHADOWFILTER_FXAA)
+        return sampleShadowFXAA(uv, depth);
+
+    [branch] if (filter == SHADOWFILTER_POISSON4)
+        return sampleShadowPoisson(uv, depth, 4);
+
+    [branch] if (filter == SHADOWFILTER_PCF3X3)
+        return sampleShadowPCF(uv, depth, 3);
+
     return sampleShadowPoisson(uv, depth, 8);
 }
 
@@ -0,0 +1,43 @@
+#ifndef POSTFX_EXPOSURE_H
+#define POSTFX_EXPOSURE_H
+
+#include <auto_Exposure.h>
+
+// average luminance is mapped to middle gray
+static const float exposureKey = 0.18;
+
+// adapted log2 luminance, exposure; written by postfx/exposure_adapt.hlsl
+Buffer<float> exposureState;
+
+float getLuminance(float3 color)
+{
+    return dot(color, float3(0.2126, 0.7152, 0.0722));
+}
+
+// get histogram bin for the color; bin 0 has pixels below the luminance range, including black ones, brighter pixels
+// go to the last bin
+uint getExposureBin(Exposure params, float3 color)
+{
+    float luminance = getLuminance(color);
+
+    if (luminance < exp2(params.minLogLuminance))
+        return 0;
+
+    float t = saturate((log2(luminance) - params.minLogLuminance) / params.logLuminanceRange);
+
+    return 1 + min((uint)(t * (EXPOSURE_BINS - 1)), EXPOSURE_BINS - 2);
+}
+
+// get log2 luminance at the bin center
+float getExposureBinLogLuminance(Exposure params, uint bin)
+{
+    return params.minLogLuminance + (bin - 0.5) / (EXPOSURE_BINS - 1) * params.logLuminanceRange;
+}
+
+// get exposure for the frame
+float getExposure()
+{
+    return exposureState[1];
+}
+
+#endif
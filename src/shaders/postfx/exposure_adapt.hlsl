@@ -0,0 +1,66 @@
+//# compute
+#include <common/common.h>
+
+#include <postfx/exposure.h>
+
+// exposure adaptation; one group with a thread per histogram bin
+// the target is the average log2 luminance of the pixels between the low and the high percentiles of the pixels in the
+// luminance range; each bin contributes the part of its pixel range [below, below + count) that overlaps the
+// percentile range, then the weighted sums are reduced over the group
+
+Buffer<uint> exposureHistogram;
+RWBuffer<float> exposureStateUA;
+
+CBUF(Exposure, exposure);
+
+groupshared float gsCount[EXPOSURE_BINS];
+groupshared float gsWeight[EXPOSURE_BINS];
+groupshared float gsSum[EXPOSURE_BINS];
+
+[numthreads(EXPOSURE_BINS, 1, 1)]
+void main(uint bin: SV_GroupIndex)
+{
+    // bin 0 is below the luminance range
+    gsCount[bin] = bin == 0 ? 0 : exposureHistogram[bin];
+
+    GroupMemoryBarrierWithGroupSync();
+
+    float below = 0, total = 0;
+
+    for (uint i = 0; i < EXPOSURE_BINS; ++i)
+    {
+        below += i < bin ? gsCount[i] : 0;
+        total += gsCount[i];
+    }
+
+    float weight = max(0, min(below + gsCount[bin], total * exposure.highPercentile) - max(below, total * exposure.lowPercentile));
+
+    gsWeight[bin] = weight;
+    gsSum[bin] = weight * getExposureBinLogLuminance(exposure, bin);
+
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint offset = EXPOSURE_BINS / 2; offset > 0; offset /= 2)
+    {
+        if (bin < offset)
+        {
+            gsWeight[bin] += gsWeight[bin + offset];
+            gsSum[bin] += gsSum[bin + offset];
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (bin == 0)
+    {
+        // the first frame has no previous state and starts at the target; if no pixels are in the luminance range,
+        // the adapted luminance is kept
+        float previous = exposure.adaptationRate < 1 ? exposureStateUA[0] : log2(exposureKey);
+        float target = gsWeight[0] > 0 ? gsSum[0] / gsWeight[0] : previous;
+        float adapted = previous + (target - previous) * exposure.adaptationRate;
+
+        exposureStateUA[0] = adapted;
+        exposureStateUA[1] = exposureKey / exp2(adapted) * exp2(exposure.compensation);
+    }
+}
@@ -0,0 +1,43 @@
+//# compute
+#include <common/common.h>
+
+#include <postfx/exposure.h>
+
+// luminance histogram of the HDR target; each group bins a tile of EXPOSURE_TILESIZE^2 pixels to group shared memory
+// and adds the non-empty bins to the global histogram, so global atomics are per group and not per pixel
+// threads step through the tile with the group size as a stride, so neighboring threads read neighboring pixels
+
+Texture2D<float4> colorMap;
+RWBuffer<uint> exposureHistogramUA;
+
+CBUF(Exposure, exposure);
+
+groupshared uint gsHistogram[EXPOSURE_BINS];
+
+[numthreads(EXPOSURE_GROUPSIZE, EXPOSURE_GROUPSIZE, 1)]
+void main(uint2 groupId: SV_GroupID, uint2 groupThreadId: SV_GroupThreadID, uint groupIndex: SV_GroupIndex)
+{
+    if (groupIndex < EXPOSURE_BINS)
+        gsHistogram[groupIndex] = 0;
+
+    GroupMemoryBarrierWithGroupSync();
+
+    uint width, height;
+    colorMap.GetDimensions(width, height);
+
+    uint2 origin = groupId * EXPOSURE_TILESIZE + groupThreadId;
+
+    for (uint y = 0; y < EXPOSURE_TILESIZE; y += EXPOSURE_GROUPSIZE)
+        for (uint x = 0; x < EXPOSURE_TILESIZE; x += EXPOSURE_GROUPSIZE)
+        {
+            uint2 pixel = origin + uint2(x, y);
+
+            if (pixel.x < width && pixel.y < height)
+                InterlockedAdd(gsHistogram[getExposureBin(exposure, colorMap[pixel].rgb)], 1);
+        }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (groupIndex < EXPOSURE_BINS && gsHistogram[groupIndex] != 0)
+        InterlockedAdd(exposureHistogramUA[groupIndex], gsHistogram[groupIndex]);
+}
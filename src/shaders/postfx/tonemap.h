@@ -0,0 +1,11 @@
+#ifndef POSTFX_TONEMAP_H
+#define POSTFX_TONEMAP_H
+
+// filmic tonemapping, approximation by J. Heil & R. Burgess-Dawson; the result is in sRGB
+float3 tonemap(float3 color)
+{
+    float3 x = max(0, color - 0.004);
+    return (x*(6.2*x+.5))/(x*(6.2*x+1.7)+0.06);
+}
+
+#endif
@@ -1,3 +1,6 @@
+#include <postfx/tonemap.h>
+#include <postfx/exposure.h>
+
 SamplerState defaultSampler;
 
 Texture2D<float4> colorMap;
@@ -23,10 +26,7 @@ PS_IN vsMain(uint id: SV_VertexID)
 float4 psMain(PS_IN I): SV_Target
 {
     float3 color = colorMap.Sample(defaultSampler, I.uv).rgb;
-    
-    // filmic tonemapping, approximation by J. Heil & R. Burgess-Dawson
-    float3 x = max(0, color - 0.004);
-    float3 srgb = (x*(6.2*x+.5))/(x*(6.2*x+1.7)+0.06);
+    float3 srgb = tonemap(color * getExposure());
 
     // store luma in alpha for fxaa
     return float4(srgb, dot(srgb, float3(0.299, 0.587, 0.114)));
@@ -0,0 +1,209 @@
+//# compute
+#include <postfx/tonemap.h>
+#include <postfx/exposure.h>
+
+// fused tonemap + FXAA 3.11 quality pass; replaces postfx/tonemap.hlsl followed by postfx/fxaa.hlsl without the LDR
+// intermediate target
+// each group tonemaps its tile with a 1-pixel apron to groupshared memory, which covers the 3x3 neighborhood and the
+// final filtered fetch; edge end searches can go outside the apron, in which case they tonemap HDR texels directly
+// all positions are in pixels instead of texture coordinates, and filtering is done manually with clamp addressing;
+// tonemapped colors are not quantized to 8 bits before FXAA, which is the only difference from the two-pass version
+
+#define TONEMAP_FXAA_TILE 16
+#define TONEMAP_FXAA_APRON 1
+#define TONEMAP_FXAA_CACHE (TONEMAP_FXAA_TILE + 2 * TONEMAP_FXAA_APRON)
+
+// FXAA settings; same as postfx/fxaa.hlsl with FXAA_QUALITY__PRESET 12 and FXAA_GREEN_AS_LUMA
+static const float fxaaSubpix = 0.75;
+static const float fxaaEdgeThreshold = 0.166;
+static const float fxaaEdgeThresholdMin = 0.0833;
+static const float fxaaSteps[5] = { 1.0, 1.5, 2.0, 4.0, 12.0 };
+
+Texture2D<float4> colorMap;
+RWTexture2D<float4> outputUA;
+
+groupshared float3 gsColor[TONEMAP_FXAA_CACHE * TONEMAP_FXAA_CACHE];
+
+static int2 gSize;
+static int2 gTileOrigin;
+static float gExposure;
+
+float3 loadTonemapped(int2 pos)
+{
+    return tonemap(colorMap[clamp(pos, 0, gSize - 1)].rgb * gExposure);
+}
+
+// get tonemapped color; uses the group tile if possible
+float3 getColor(int2 pos)
+{
+    int2 local = pos - gTileOrigin + TONEMAP_FXAA_APRON;
+
+    [branch]
+    if (all(local >= 0) && all(local < TONEMAP_FXAA_CACHE))
+        return gsColor[local.y * TONEMAP_FXAA_CACHE + local.x];
+    else
+        return loadTonemapped(pos);
+}
+
+// bilinear filtering of tonemapped colors; pixel centers are at .5
+float3 sampleColor(float2 pos)
+{
+    float2 p = pos - 0.5;
+    int2 i = (int2)floor(p);
+    float2 f = p - i;
+
+    float3 c00 = getColor(i);
+    float3 c10 = getColor(i + int2(1, 0));
+    float3 c01 = getColor(i + int2(0, 1));
+    float3 c11 = getColor(i + int2(1, 1));
+
+    return lerp(lerp(c00, c10, f.x), lerp(c01, c11, f.x), f.y);
+}
+
+float sampleLuma(float2 pos)
+{
+    return sampleColor(pos).g;
+}
+
+// FxaaPixelShader quality path from fxaa3.h
+float4 fxaa(int2 pixel)
+{
+    float2 posM = pixel + 0.5;
+
+    float3 rgbM = getColor(pixel);
+    float lumaM = rgbM.g;
+    float lumaS = getColor(pixel + int2(0, 1)).g;
+    float lumaE = getColor(pixel + int2(1, 0)).g;
+    float lumaN = getColor(pixel + int2(0, -1)).g;
+    float lumaW = getColor(pixel + int2(-1, 0)).g;
+
+    float rangeMax = max(max(lumaN, lumaW), max(lumaE, max(lumaS, lumaM)));
+    float rangeMin = min(min(lumaN, lumaW), min(lumaE, min(lumaS, lumaM)));
+    float range = rangeMax - rangeMin;
+
+    if (range < max(fxaaEdgeThresholdMin, rangeMax * fxaaEdgeThreshold))
+        return float4(rgbM, lumaM);
+
+    float lumaNW = getColor(pixel + int2(-1, -1)).g;
+    float lumaSE = getColor(pixel + int2(1, 1)).g;
+    float lumaNE = getColor(pixel + int2(1, -1)).g;
+    float lumaSW = getColor(pixel + int2(-1, 1)).g;
+
+    float lumaNS = lumaN + lumaS;
+    float lumaWE = lumaW + lumaE;
+    float subpixRcpRange = 1.0 / range;
+    float subpixNSWE = lumaNS + lumaWE;
+    float edgeHorz1 = (-2.0 * lumaM) + lumaNS;
+    float edgeVert1 = (-2.0 * lumaM) + lumaWE;
+
+    float lumaNESE = lumaNE + lumaSE;
+    float lumaNWNE = lumaNW + lumaNE;
+    float edgeHorz2 = (-2.0 * lumaE) + lumaNESE;
+    float edgeVert2 = (-2.0 * lumaN) + lumaNWNE;
+
+    float lumaNWSW = lumaNW + lumaSW;
+    float lumaSWSE = lumaSW + lumaSE;
+    float edgeHorz4 = (abs(edgeHorz1) * 2.0) + abs(edgeHorz2);
+    float edgeVert4 = (abs(edgeVert1) * 2.0) + abs(edgeVert2);
+    float edgeHorz3 = (-2.0 * lumaW) + lumaNWSW;
+    float edgeVert3 = (-2.0 * lumaS) + lumaSWSE;
+    float edgeHorz = abs(edgeHorz3) + edgeHorz4;
+    float edgeVert = abs(edgeVert3) + edgeVert4;
+
+    float subpixNWSWNESE = lumaNWSW + lumaNESE;
+    float lengthSign = 1;
+    bool horzSpan = edgeHorz >= edgeVert;
+    float subpixA = subpixNSWE * 2.0 + subpixNWSWNESE;
+
+    if (!horzSpan) lumaN = lumaW;
+    if (!horzSpan) lumaS = lumaE;
+    float subpixB = (subpixA * (1.0 / 12.0)) - lumaM;
+
+    float gradientN = lumaN - lumaM;
+    float gradientS = lumaS - lumaM;
+    float lumaNN = lumaN + lumaM;
+    float lumaSS = lumaS + lumaM;
+    bool pairN = abs(gradientN) >= abs(gradientS);
+    float gradient = max(abs(gradientN), abs(gradientS));
+    if (pairN) lengthSign = -lengthSign;
+    float subpixC = saturate(abs(subpixB) * subpixRcpRange);
+
+    // search for the edge ends along the edge, half a pixel towards the steeper neighbor
+    float2 offNP = horzSpan ? float2(1, 0) : float2(0, 1);
+    float2 posB = posM + (horzSpan ? float2(0, lengthSign * 0.5) : float2(lengthSign * 0.5, 0));
+
+    float2 posN = posB - offNP * fxaaSteps[0];
+    float2 posP = posB + offNP * fxaaSteps[0];
+    float subpixD = ((-2.0) * subpixC) + 3.0;
+    float lumaEndN = sampleLuma(posN);
+    float subpixE = subpixC * subpixC;
+    float lumaEndP = sampleLuma(posP);
+
+    if (!pairN) lumaNN = lumaSS;
+    float gradientScaled = gradient * 1.0 / 4.0;
+    float lumaMM = lumaM - lumaNN * 0.5;
+    float subpixF = subpixD * subpixE;
+    bool lumaMLTZero = lumaMM < 0.0;
+
+    lumaEndN -= lumaNN * 0.5;
+    lumaEndP -= lumaNN * 0.5;
+    bool doneN = abs(lumaEndN) >= gradientScaled;
+    bool doneP = abs(lumaEndP) >= gradientScaled;
+    if (!doneN) posN -= offNP * fxaaSteps[1];
+    if (!doneP) posP += offNP * fxaaSteps[1];
+
+    [loop]
+    for (uint search = 2; search < 5 && !(doneN && doneP); ++search)
+    {
+        if (!doneN) lumaEndN = sampleLuma(posN) - lumaNN * 0.5;
+        if (!doneP) lumaEndP = sampleLuma(posP) - lumaNN * 0.5;
+        doneN = abs(lumaEndN) >= gradientScaled;
+        doneP = abs(lumaEndP) >= gradientScaled;
+        if (!doneN) posN -= offNP * fxaaSteps[search];
+        if (!doneP) posP += offNP * fxaaSteps[search];
+    }
+
+    float dstN = horzSpan ? posM.x - posN.x : posM.y - posN.y;
+    float dstP = horzSpan ? posP.x - posM.x : posP.y - posM.y;
+
+    bool goodSpanN = (lumaEndN < 0.0) != lumaMLTZero;
+    float spanLength = (dstP + dstN);
+    bool goodSpanP = (lumaEndP < 0.0) != lumaMLTZero;
+    float spanLengthRcp = 1.0 / spanLength;
+
+    bool directionN = dstN < dstP;
+    float dst = min(dstN, dstP);
+    bool goodSpan = directionN ? goodSpanN : goodSpanP;
+    float subpixG = subpixF * subpixF;
+    float pixelOffset = (dst * (-spanLengthRcp)) + 0.5;
+    float subpixH = subpixG * fxaaSubpix;
+
+    float pixelOffsetGood = goodSpan ? pixelOffset : 0.0;
+    float pixelOffsetSubpix = max(pixelOffsetGood, subpixH);
+    if (!horzSpan) posM.x += pixelOffsetSubpix * lengthSign;
+    if ( horzSpan) posM.y += pixelOffsetSubpix * lengthSign;
+
+    return float4(sampleColor(posM), lumaM);
+}
+
+[numthreads(TONEMAP_FXAA_TILE, TONEMAP_FXAA_TILE, 1)]
+void main(uint2 groupId: SV_GroupID, uint2 groupThreadId: SV_GroupThreadID, uint groupIndex: SV_GroupIndex)
+{
+    uint width, height;
+    colorMap.GetDimensions(width, height);
+
+    gSize = int2(width, height);
+    gTileOrigin = groupId * TONEMAP_FXAA_TILE;
+    gExposure = getExposure();
+
+    // tonemap the tile and the apron
+    for (uint index = groupIndex; index < TONEMAP_FXAA_CACHE * TONEMAP_FXAA_CACHE; index += TONEMAP_FXAA_TILE * TONEMAP_FXAA_TILE)
+        gsColor[index] = loadTonemapped(gTileOrigin - TONEMAP_FXAA_APRON + int2(index % TONEMAP_FXAA_CACHE, index / TONEMAP_FXAA_CACHE));
+
+    GroupMemoryBarrierWithGroupSync();
+
+    int2 pixel = gTileOrigin + groupThreadId;
+
+    if (all(pixel < gSize))
+        outputUA[pixel] = fxaa(pixel);
+}
@@ -0,0 +1,72 @@
+//# compute
+#include <common/common.h>
+
+#include <auto_MeshCompressionInfo.h>
+
+// skinning pre-pass; decodes Pos_TBN_Tex1_Bone4_Packed vertices of a mesh fragment, blends 4 bones and writes
+// Pos_TBN_Tex1_Skinned vertices for the fill shaders, so meshes are skinned once per frame instead of once per pass
+// vertices keep their indices, so the fragment vertex range is the same in both buffers
+
+#define SKINNING_GROUPSIZE 64
+
+// vertex sizes; match VertexLayouts
+#define SKINNING_SOURCE_STRIDE 28
+#define SKINNING_OUTPUT_STRIDE 24
+
+ByteAddressBuffer skinningSource;
+RWByteAddressBuffer skinningOutputUA;
+
+CBUF(MeshCompressionInfo, meshCompressionInfo);
+CBUF(int, skinningFirstVertex);
+CBUF(int, skinningVertexCount);
+
+cbuffer mesh
+{
+    float3x4 bones[2];
+}
+
+float3 unpackUNorm10(uint value)
+{
+    return float3(value & 1023, (value >> 10) & 1023, (value >> 20) & 1023) / 1023.0;
+}
+
+uint packUNorm10(float3 value)
+{
+    uint3 q = (uint3)(saturate(value) * 1023 + 0.5);
+    return q.x | (q.y << 10) | (q.z << 20);
+}
+
+[numthreads(SKINNING_GROUPSIZE, 1, 1)]
+void main(uint id: SV_DispatchThreadID)
+{
+    if (id >= (uint)skinningVertexCount) return;
+
+    uint vertex = skinningFirstVertex + id;
+
+    // position xy, position z, normal, tangent + bitangent sign; texcoord, bone indices, bone weights
+    uint4 data0 = skinningSource.Load4(vertex * SKINNING_SOURCE_STRIDE);
+    uint3 data1 = skinningSource.Load3(vertex * SKINNING_SOURCE_STRIDE + 16);
+
+    float3 pos = float3(data0.x & 0xffff, data0.x >> 16, data0.y & 0xffff) / 65535.0;
+    pos = pos * meshCompressionInfo.posScale + meshCompressionInfo.posOffset;
+
+    uint4 boneIndices = uint4(data1.y & 0xff, (data1.y >> 8) & 0xff, (data1.y >> 16) & 0xff, data1.y >> 24);
+    float4 boneWeights = float4(data1.z & 0xff, (data1.z >> 8) & 0xff, (data1.z >> 16) & 0xff, data1.z >> 24) / 255.0;
+
+    float3x4 transform = 0;
+
+    [unroll] for (int i = 0; i < 4; ++i)
+    {
+        transform += bones[boneIndices[i]] * boneWeights[i];
+    }
+
+    float3 posSkinned = mul(transform, float4(pos, 1));
+    float3 normal = normalize(mul((float3x3)transform, unpackUNorm10(data0.z) * 2 - 1));
+    float3 tangent = normalize(mul((float3x3)transform, unpackUNorm10(data0.w) * 2 - 1));
+
+    // bitangent sign and texcoord are copied
+    uint offset = vertex * SKINNING_OUTPUT_STRIDE;
+
+    skinningOutputUA.Store3(offset, asuint(posSkinned));
+    skinningOutputUA.Store3(offset + 12, uint3(packUNorm10(normal * 0.5 + 0.5), packUNorm10(tangent * 0.5 + 0.5) | (data0.w & 0xc0000000), data1.x));
+}
@@ -1,7 +1,14 @@
-let timer = System.Diagnostics.Stopwatch.StartNew()
-let passed, total = Core.Test.run ()
+// tests in the build assembly are found via reflection, so load it explicitly
+System.Reflection.Assembly.Load("fungine.build") |> ignore
 
-if passed = total then
-    printfn "Success: %d tests passed in %.2f sec." passed timer.Elapsed.TotalSeconds
+// tests.exe -benchmark runs benchmarks instead of tests
+if System.Environment.GetCommandLineArgs() |> Array.exists (fun arg -> arg = "-benchmark") then
+    Core.Test.benchmark ()
 else
-    printfn "FAILURE: %d out of %d tests failed." (total - passed) total
\ No newline at end of file
+    let timer = System.Diagnostics.Stopwatch.StartNew()
+    let passed, total = Core.Test.run ()
+
+    if passed = total then
+        printfn "Success: %d tests passed in %.2f sec." passed timer.Elapsed.TotalSeconds
+    else
+        printfn "FAILURE: %d out of %d tests failed." (total - passed) total
\ No newline at end of file